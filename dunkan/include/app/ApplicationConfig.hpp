@@ -26,12 +26,42 @@ struct ApplicationConfig {
 
   // SSAO Configuration
   bool enableSSAO = false; // Disabled by default
-  float ssaoRadius = 0.5f;
+  float ssaoRadius = 16.0f; // World units (pixels at zoom 1)
   float ssaoBias = 0.025f;
   float ssaoPower = 1.0f;
+  int ssaoKernelSize = 64; // Samples per pixel, one SSAO pipeline per size
+  int ssaoDownscale = 2;   // 1 = full resolution, 2 = half, 4 = quarter (compute)
+  bool ssaoTemporal = false; // Spread the kernel over frames (half/quarter only)
 
   // Rendering Configuration
   float gammaCorrection = 0.8f; // Gamma for final output (stylized)
+  bool compactGBuffer = true;   // RG16F normals + R16F depth (14 bytes/pixel instead of 20), read at startup
+  bool mergedGBufferPass = true; // G-buffer + composition in one render pass while SSAO is off, read at startup
+
+  // Internal Resolution (G-buffer, SSAO and lighting; composition and UI stay at window size)
+  float renderScale = 1.0f;       // Per axis, relative to the window
+  bool dynamicResolution = false; // Adjust renderScale from GPU frame time to hold targetFrameRate
+  float targetFrameRate = 60.0f;
+  float minRenderScale = 0.5f;
+  bool upscaling = true;         // Below full scale: compose at the internal resolution, then EASU + RCAS
+  float upscaleSharpness = 0.8f; // RCAS strength, 0-1
+
+  // Frame Pacing
+  enum class PresentMode {
+    FIFO = 0,         // V-sync, queues frames: steady, most latency
+    FIFO_RELAXED = 1, // V-sync unless a frame is late, then it tears
+    MAILBOX = 2,      // V-sync, newest frame wins: renders flat out
+    IMMEDIATE = 3     // No v-sync, tears: least latency
+  };
+
+  int framesInFlight = 2; // 1-3: fewer is less input latency, less CPU/GPU overlap
+  PresentMode presentMode = PresentMode::MAILBOX; // FIFO where unsupported
+  float frameRateLimit = 0.0f;  // Frames per second, 0 = unlimited
+  bool lateInputSampling = true; // Poll input after the fence and acquire, right before recording
+
+  // Profiling
+  bool gpuPipelineStatistics = false; // Per-pass pipeline statistics queries (GPU Profiler panel)
+  int cpuCaptureFrames = 60; // Frames per CPU profiler capture (F11 or the CPU Profiler panel)
 
   // Depth Configuration
   float globalDepthMultiplier = 0.01f;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "app/ApplicationConfig.hpp"
+#include "app/FramePacing.hpp"
 #include "app/LightingManager.hpp"
 #include "app/GizmoManager.hpp"
 #include "app/Camera.hpp"
@@ -13,9 +14,12 @@
 // Forward declarations - we only need pointers
 struct RenderComponent;
 struct PhysicsComponent;
+class VulkanMemoryAllocator;
 
 namespace dunkan {
 
+class GpuProfileLog;
+
 /**
  * @brief Entity data for editing in ImGui
  * Simple POD struct to avoid template complexity
@@ -55,11 +59,58 @@ public:
    */
   Camera& getCamera() { return camera; }
 
+  /**
+   * @brief Set the allocator whose pool statistics the Memory panel shows
+   */
+  void setMemoryAllocator(const VulkanMemoryAllocator *allocator) {
+    memoryAllocator = allocator;
+  }
+
+  /**
+   * @brief Set the per-pass GPU timings the GPU Profiler panel shows
+   * @param statisticsSupported Whether the device has pipeline statistics
+   */
+  void setGpuProfileLog(GpuProfileLog *log, bool statisticsSupported) {
+    gpuProfileLog = log;
+    pipelineStatisticsSupported = statisticsSupported;
+  }
+
+  /**
+   * @brief Set the GPU frame time and internal resolution the Rendering panel
+   * shows (gpuMilliseconds < 0: no GPU timing)
+   */
+  void setFrameStats(float gpuMilliseconds, int renderWidth, int renderHeight) {
+    gpuFrameTime = gpuMilliseconds;
+    renderSize[0] = renderWidth;
+    renderSize[1] = renderHeight;
+  }
+
+  /**
+   * @brief Set the present modes and input latency the Frame Pacing panel
+   * shows
+   */
+  void setFramePacingStats(const FramePacingStats &stats) {
+    framePacingStats = stats;
+  }
+
+  /**
+   * @brief Match the camera used for gizmo picking to the window size
+   */
+  void setViewportSize(float width, float height) {
+    camera.setViewportSize(width, height);
+  }
+
 private:
   ApplicationConfig &config;
   LightingManager &lightingMgr;
   Camera camera;
   GizmoManager gizmoManager;
+  const VulkanMemoryAllocator *memoryAllocator = nullptr;
+  GpuProfileLog *gpuProfileLog = nullptr;
+  bool pipelineStatisticsSupported = false;
+  float gpuFrameTime = -1.0f;
+  int renderSize[2] = {0, 0};
+  FramePacingStats framePacingStats;
   
   // Panel visibility flags
   bool showGBufferPanel = true;
@@ -68,9 +119,13 @@ private:
   bool showDepthDebugPanel = false;
   bool showEntityEditorPanel = true;
   bool showRenderingPanel = false;
+  bool showFramePacingPanel = false;
   bool showGizmoPanel = false;
   bool showCameraPanel = false;
   bool showStatsPanel = true;
+  bool showMemoryPanel = false;
+  bool showProfilerPanel = false;
+  bool showCpuProfilerPanel = false;
   
   // Main UI methods
   void renderMainMenuBar(int fps, int entityCount);
@@ -82,8 +137,12 @@ private:
   void renderDepthDebug();
   void renderEntityEditor(const std::vector<EntityEditData> &entityCache);
   void renderRenderingSettings();
+  void renderFramePacingPanel();
   void renderGizmoPanel();
   void renderCameraPanel();
+  void renderMemoryPanel();
+  void renderProfilerPanel();
+  void renderCpuProfilerPanel();
   
   // Sub-panel rendering methods (modular)
   void renderLightControl(size_t index, LightConfig &light);
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace dunkan {
+
+/**
+ * @brief Picks the internal render scale that holds a target frame rate
+ *
+ * Fed the GPU time of every finished frame. The G-buffer, SSAO and lighting
+ * cost scales with their pixel count, so the scale moves by the square root
+ * of budget / time. The time is smoothed, and the scale only changes outside
+ * a dead band and once the frames rendered at the previous scale have been
+ * measured, so it settles instead of oscillating.
+ */
+class DynamicResolution {
+public:
+  /**
+   * @brief Feed one frame's GPU time
+   * @param gpuMilliseconds GPU time of a finished frame
+   * @param targetFrameRate Frame rate to hold
+   * @param minScale Lowest scale allowed (the highest is 1)
+   * @return true when the scale changed
+   */
+  bool update(float gpuMilliseconds, float targetFrameRate, float minScale);
+
+  /**
+   * @brief Start over at scale (controller switched on, or settings changed)
+   */
+  void reset(float scale);
+
+  float getScale() const { return scale; }
+  float getSmoothedGpuTime() const { return smoothedTime; }
+
+private:
+  float scale = 1.0f;
+  float smoothedTime = 0.0f;
+  int framesSinceChange = 0;
+};
+
+} // namespace dunkan
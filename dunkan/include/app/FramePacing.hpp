@@ -0,0 +1,113 @@
+#pragma once
+
+#include "app/ApplicationConfig.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace dunkan {
+
+/**
+ * @brief Holds the frame rate to a limit without drifting
+ *
+ * Sleeps until a spin margin before the frame's start, then spins for the
+ * rest. The margin follows how far sleeps have been overshooting (quicker to
+ * grow than to shrink), and on Windows the system timer runs at 1 ms while a
+ * limit is set instead of its default ~15.6 ms. Frame starts advance by whole
+ * periods from the previous one, so an early or late frame doesn't shift the
+ * ones after it; more than a period behind, the schedule starts again instead
+ * of rushing frames to catch up.
+ */
+class FrameLimiter {
+public:
+  static constexpr float INITIAL_SPIN_MILLISECONDS = 2.0f;
+  static constexpr float MIN_SPIN_MILLISECONDS = 0.25f;
+  static constexpr float MAX_SPIN_MILLISECONDS = 16.0f;
+
+  FrameLimiter() = default;
+  ~FrameLimiter();
+  FrameLimiter(const FrameLimiter &) = delete;
+  FrameLimiter &operator=(const FrameLimiter &) = delete;
+
+  /**
+   * @brief Block until the next frame may start
+   * @param frameRate Frames per second, <= 0 returns right away
+   */
+  void wait(float frameRate);
+
+  /**
+   * @brief Time the last wait() blocked for, in milliseconds
+   */
+  float getLastWait() const { return lastWait; }
+
+  /**
+   * @brief Time wait() currently spins for instead of sleeping, in
+   * milliseconds
+   */
+  float getSpinMargin() const {
+    return std::chrono::duration<float, std::milli>(spinMargin).count();
+  }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Raises the system timer resolution while a limit is set (Windows only)
+  void setFineTimer(bool fine);
+
+  Clock::time_point nextFrame;
+  Clock::duration spinMargin = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<float, std::milli>(INITIAL_SPIN_MILLISECONDS));
+  bool running = false;
+  bool fineTimer = false;
+  float lastWait = 0.0f;
+};
+
+/**
+ * @brief Time from sampling input to submitting the frame that used it
+ *
+ * Averages cover the last AVERAGE_FRAMES submitted frames that sampled input.
+ */
+class InputLatency {
+public:
+  static constexpr uint32_t AVERAGE_FRAMES = 120;
+
+  /**
+   * @brief Input was just polled for the frame being built
+   */
+  void markInputSampled();
+
+  /**
+   * @brief The frame was just submitted; ignored when it sampled no input
+   */
+  void markSubmitted();
+
+  float getLast() const { return last; }
+  float getAverage() const { return average; }
+  float getMax() const { return max; }
+
+private:
+  std::chrono::steady_clock::time_point sampleTime;
+  bool sampled = false;
+
+  std::vector<float> history; // Ring of the last AVERAGE_FRAMES latencies
+  uint32_t nextSample = 0;
+  float last = 0.0f;
+  float average = 0.0f;
+  float max = 0.0f;
+};
+
+/**
+ * @brief What the Frame Pacing panel shows about the running frame pacing
+ */
+struct FramePacingStats {
+  bool presentModeSupported[4] = {true, false, false, false}; // By PresentMode
+  ApplicationConfig::PresentMode presentMode =
+      ApplicationConfig::PresentMode::FIFO; // In use
+  float inputLatency = 0.0f;        // Milliseconds, last frame
+  float averageInputLatency = 0.0f; // Milliseconds
+  float maxInputLatency = 0.0f;     // Milliseconds
+  float limiterWait = 0.0f;         // Milliseconds the last frame was held back
+};
+
+} // namespace dunkan
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vulkan/VulkanGpuProfiler.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dunkan {
+
+/**
+ * @brief Rolling averages of the GPU profiler's per-pass results, and a CSV log
+ *
+ * Fed one VulkanGpuProfiler frame result at a time (a couple of frames after
+ * it was rendered). Averages cover the last AVERAGE_FRAMES frames and restart
+ * when the set of passes changes (settings toggling passes on or off). The CSV
+ * has one row per pass per frame, plus a "frame" row with the whole frame.
+ */
+class GpuProfileLog {
+public:
+  static constexpr uint32_t AVERAGE_FRAMES = 120;
+
+  struct PassAverage {
+    std::string name;
+    float milliseconds = 0.0f;
+    bool hasStatistics = false;
+    double clippingPrimitives = 0.0;
+    double fragmentInvocations = 0.0;
+    double computeInvocations = 0.0;
+  };
+
+  void addFrame(const VulkanGpuProfiler::FrameResult &frame);
+
+  float getAverageFrameTime() const { return averageFrameTime; }
+  const std::vector<PassAverage> &getPassAverages() const { return averages; }
+  uint32_t getSampleCount() const { return sampleCount; }
+
+  /**
+   * @brief Start writing every frame added from now on to path (truncated)
+   * @return false when the file can't be opened
+   */
+  bool startCsv(const std::string &path);
+  void stopCsv();
+  bool isWritingCsv() const { return csv.is_open(); }
+  const std::string &getCsvPath() const { return csvPath; }
+
+private:
+  void recomputeAverages();
+
+  // Ring of the last AVERAGE_FRAMES frames, all with the same passes
+  std::vector<VulkanGpuProfiler::FrameResult> history;
+  uint32_t nextSample = 0;
+  uint32_t sampleCount = 0;
+
+  float averageFrameTime = 0.0f;
+  std::vector<PassAverage> averages;
+
+  std::ofstream csv;
+  std::string csvPath;
+  uint64_t frameNumber = 0;
+};
+
+} // namespace dunkan
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <vector>
 
 
-// Forward declaration - VulkanBuffer is in global namespace
-class VulkanBuffer;
+// Forward declaration - VulkanFrameAllocator is in global namespace
+class VulkanFrameAllocator;
 
 namespace dunkan {
 
@@ -33,24 +35,49 @@ struct LightConfig {
 };
 
 /**
- * @brief Light structure matching shader UBO layout
+ * @brief Light structure matching the shaders' light buffer layout (std430)
+ *
+ * Everything the shaders can derive once per light is precomputed by
+ * LightingManager, so shading is multiply-adds only. The buffer holds the
+ * directional lights first, then point lights, then spot lights.
  */
 struct Light {
-  glm::vec4 position;  // w = type (0=directional, 1=point, 2=spot)
-  glm::vec4 direction; // w = radius
-  glm::vec4 color;     // w = intensity
-  glm::vec4 params;    // x=cutoffAngle, y=outerCutoff, z=attenuation, w=unused
+  glm::vec4 position;  // xyz = position, w = range (0 for directional)
+  glm::vec4 direction; // xyz = normalised direction towards the light, w = 1 / radius^2
+  glm::vec4 color;     // rgb = color * intensity, w = unused
+  glm::vec4 params;    // x = cone scale, y = cone offset, z = 1 / range^2, w = unused
 };
 
+/**
+ * @brief Number of light types (LightConfig::type: 0=directional, 1=point, 2=spot)
+ */
+inline constexpr size_t LIGHT_TYPE_COUNT = 3;
+
+/**
+ * @brief Spot lights fade from their cutoff angle to this many degrees past it
+ */
+inline constexpr float SPOT_SOFT_EDGE_DEGREES = 5.0f;
+
+/**
+ * @brief Point and spot lights fade out completely at radius * LIGHT_RANGE_SCALE
+ *
+ * The falloff 1 / (1 + (d / radius)^2) never reaches zero on its own; the
+ * range bounds each light so tiled culling can skip it (about 6% of full
+ * strength remains at the range before the fade).
+ */
+inline constexpr float LIGHT_RANGE_SCALE = 4.0f;
+
 /**
  * @brief Lighting UBO matching shader layout
+ *
+ * The lights themselves go to a storage buffer (see getPackedLights()).
  */
 struct LightingUBO {
   alignas(16) glm::vec4 ambientLight;
   alignas(16) glm::vec3 viewPos;
-  alignas(4) int numLights;
-  alignas(16) glm::vec4 viewOffsetPadded;  // xy = viewOffset, zw = padding
-  Light lights[10];
+  alignas(16) glm::vec4 viewRect;    // xy = viewOffset, zw = world units the screen covers
+  alignas(16) glm::vec4 renderArea;  // xy = rendered area / G-buffer size, zw = rendered area in pixels
+  alignas(16) glm::uvec4 lightCounts; // x = directional, y = point, z = spot
 };
 
 /**
@@ -73,10 +100,20 @@ public:
   const std::vector<LightConfig> &getLights() const { return lights; }
   size_t getLightCount() const { return lights.size(); }
 
-  // UBO updates
-  void updateLightingUBO(VulkanBuffer *lightingUBO,
-                         const glm::vec3 &ambientLight,
-                         const glm::vec3 &viewPos);
+  // UBO updates - writes this frame's UBO and returns its dynamic offset.
+  // Also packs the enabled lights that reach the view (viewPos.xy to
+  // viewPos.xy + viewSize) for the light buffer, grouped by type.
+  // renderArea: see LightingUBO, composition reads the G-buffer through it
+  uint32_t updateLightingUBO(VulkanFrameAllocator &frameAllocator,
+                             const glm::vec3 &ambientLight,
+                             const glm::vec3 &viewPos,
+                             const glm::vec2 &viewSize,
+                             const glm::vec4 &renderArea);
+  const std::vector<Light> &getPackedLights() const { return packedLights; }
+  // Packed lights of each type, indexed by LightConfig::type
+  const std::array<uint32_t, LIGHT_TYPE_COUNT> &getPackedLightCounts() const {
+    return packedLightCounts;
+  }
   
   // Animation
   void updateAnimatedLights(float deltaTime);
@@ -86,6 +123,10 @@ public:
 
 private:
   std::vector<LightConfig> lights;
+  std::vector<Light> packedLights; // Enabled lights in shader layout, reused every frame
+  std::array<uint32_t, LIGHT_TYPE_COUNT> packedLightCounts{};
+
+  static Light packLight(const LightConfig &config);
 };
 
 } // namespace dunkan
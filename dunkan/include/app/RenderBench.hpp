@@ -0,0 +1,101 @@
+#pragma once
+
+#include "app/LightingManager.hpp"
+#include "game/types.hpp"
+#include "vulkan/VulkanGpuProfiler.hpp"
+#include "vulkan/VulkanMemoryAllocator.hpp"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+namespace dunkan {
+
+/**
+ * @brief Stress scene rendered by render_bench
+ *
+ * The same seed gives the same scene on every platform: the generator draws
+ * from std::mt19937 directly instead of the standard distributions, whose
+ * output is implementation-defined.
+ */
+struct BenchSceneConfig {
+  uint32_t seed = 1;
+  uint32_t spriteCount = 1000;
+  uint32_t pointLights = 16;
+  uint32_t spotLights = 4;
+  uint32_t directionalLights = 1;
+  bool ssao = false;
+};
+
+/**
+ * @brief Frame pacing of a render_bench run, recorded in its report
+ */
+struct BenchPacingConfig {
+  uint32_t framesInFlight = 2;
+  const char *presentMode = "none"; // In use, by its command line name
+  float frameRateLimit = 0.0f;      // 0: unlimited
+  bool lateInputSampling = true;
+};
+
+/**
+ * @brief Spawn the bench scene's sprites and lights
+ *
+ * Sprites use the materials of data/ (loaded by the caller) and are scattered
+ * over worldSize, shrinking as the count grows so overdraw stays roughly the
+ * same from 1k to 1M sprites. Replaces every light of lightingManager.
+ */
+void generateBenchScene(const BenchSceneConfig &scene, const glm::vec2 &worldSize,
+                        EntityManager &entityManager,
+                        LightingManager &lightingManager);
+
+/**
+ * @brief Per-frame measurements of a render_bench run, written as JSON
+ *
+ * CPU frame time excludes the wait for the frame slot's fence, so it is the
+ * time spent recording and submitting; the whole frame time includes it but
+ * not the frame limiter's wait, which is reported apart with the input to
+ * submit latency. GPU results come from VulkanGpuProfiler and are averaged
+ * per pass.
+ */
+class BenchReport {
+public:
+  void addFrame(float frameMilliseconds, float cpuMilliseconds,
+                uint32_t drawCalls, float inputLatencyMilliseconds,
+                float limiterWaitMilliseconds);
+  void addGpuFrame(const VulkanGpuProfiler::FrameResult &frame);
+
+  uint32_t getFrameCount() const {
+    return static_cast<uint32_t>(frameTimes.size());
+  }
+
+  /**
+   * @brief Write the report to path
+   * @return false when the file can't be written
+   */
+  bool write(const std::string &path, const BenchSceneConfig &scene,
+             uint32_t width, uint32_t height, bool headless,
+             const BenchPacingConfig &pacing,
+             const VulkanMemoryAllocator::Stats &memory,
+             uint64_t frameAllocatorPeakBytes) const;
+
+private:
+  struct PassTotal {
+    std::string name;
+    double milliseconds = 0.0;
+    float minMilliseconds = 0.0f;
+    float maxMilliseconds = 0.0f;
+    uint32_t samples = 0;
+  };
+
+  std::vector<float> frameTimes;
+  std::vector<float> cpuTimes;
+  std::vector<float> gpuTimes;
+  std::vector<float> inputLatencies;
+  std::vector<float> limiterWaits;
+  uint64_t drawCallTotal = 0;
+  uint32_t maxDrawCalls = 0;
+  std::vector<PassTotal> passes; // In the order they were first recorded
+};
+
+} // namespace dunkan
@@ -94,6 +94,7 @@ struct RenderComponent {
     glm::vec2 position{0.0f, 0.0f};
     glm::vec2 scaleVec{1.0f, 1.0f};
     glm::vec4 textureRect{0, 0, 0, 0};  // x, y, width, height
+    glm::vec4 uvRect{0, 0, 1, 1};       // u0, v0, u1, v1 of the image to draw; mapped into the sprite's atlas rect when packed
     
     float height {10.0f};
     float scale {1.0f};
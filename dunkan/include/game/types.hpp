@@ -17,6 +17,12 @@
 using Components            = ADE::META_TYPES::Typelist<LightComponent, PhysicsComponent, RenderComponent, ShadowComponent>;
 using SingletonComponents   = ADE::META_TYPES::Typelist<CameraComponent, ConfigurationComponent>;
 using Tags                  = ADE::META_TYPES::Typelist<>;
-using EntityManager         = ADE::EntityManager<Components, SingletonComponents, Tags, 1024>;
+// Components of each type the entity manager holds (fixed arrays); render_bench raises it for
+// its stress scenes
+#ifndef DUNKAN_MAX_ENTITIES
+#define DUNKAN_MAX_ENTITIES 1024
+#endif
+
+using EntityManager         = ADE::EntityManager<Components, SingletonComponents, Tags, DUNKAN_MAX_ENTITIES>;
 using Entity                = EntityManager::Entity;
 using ResourceManager       = VulkanResourceManager;
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Texture atlas packing shared by the runtime atlas builder (VulkanTextureAtlas) and the
+// offline one (texture_cooker --atlas). Vulkan-free; everything here is thread-safe.
+//
+// Sprites are packed with a skyline bottom-left packer. Each sprite cell is surrounded by
+// `padding` texels of extruded edge and starts on a multiple of `padding`, so the first
+// log2(padding) + 1 mip levels never mix texels from neighbouring sprites (see mipLevels()).
+namespace Atlas {
+
+struct Rect {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+struct Sprite {
+    std::string name;       // Lookup name, e.g. "tree_albedo"
+    std::string source;     // Material base path, e.g. "data/tree" (maps are <source>_albedo.png, ...)
+    uint32_t width = 0;     // Content size in texels
+    uint32_t height = 0;
+    uint32_t page = 0;
+    Rect rect;              // Content placement in the page, padding excluded
+};
+
+struct Layout {
+    uint32_t pageSize = 2048;
+    uint32_t padding = 8;
+    uint32_t pageCount = 0;
+    std::vector<Sprite> sprites;
+};
+
+// Raw 8-bit pixels, tightly packed
+struct Image {
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 4;
+
+    bool isValid() const { return !pixels.empty(); }
+};
+
+// Mip levels a page can have before sprites bleed into each other
+inline uint32_t mipLevels(uint32_t padding) {
+    uint32_t levels = 1;
+    while (padding > 1) {
+        padding >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+// u0, v0, u1, v1 of a sprite's content in normalized page coordinates
+inline void uvRect(const Sprite& sprite, uint32_t pageSize, float out[4]) {
+    float scale = 1.0f / static_cast<float>(pageSize);
+    out[0] = sprite.rect.x * scale;
+    out[1] = sprite.rect.y * scale;
+    out[2] = (sprite.rect.x + sprite.rect.width) * scale;
+    out[3] = (sprite.rect.y + sprite.rect.height) * scale;
+}
+
+class SkylinePacker {
+public:
+    SkylinePacker(uint32_t width, uint32_t height) : m_width(width), m_height(height) {
+        m_skyline.push_back({0, 0, width});
+    }
+
+    // Bottom-left heuristic: lowest resulting top edge, then leftmost
+    bool insert(uint32_t width, uint32_t height, Rect& rect) {
+        size_t bestIndex = SIZE_MAX;
+        uint32_t bestTop = UINT32_MAX;
+        uint32_t bestY = 0;
+
+        for (size_t i = 0; i < m_skyline.size(); i++) {
+            uint32_t y;
+            if (!fit(i, width, height, y)) {
+                continue;
+            }
+            if (y + height < bestTop) {
+                bestTop = y + height;
+                bestIndex = i;
+                bestY = y;
+            }
+        }
+
+        if (bestIndex == SIZE_MAX) {
+            return false;
+        }
+
+        rect = {m_skyline[bestIndex].x, bestY, width, height};
+        place(bestIndex, rect);
+        return true;
+    }
+
+private:
+    struct Segment {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+    // Height at which a rect starting at segment `index` rests on the skyline
+    bool fit(size_t index, uint32_t width, uint32_t height, uint32_t& y) const {
+        uint32_t x = m_skyline[index].x;
+        if (x + width > m_width) {
+            return false;
+        }
+
+        y = 0;
+        uint32_t remaining = width;
+        for (size_t i = index; remaining > 0; i++) {
+            y = std::max(y, m_skyline[i].y);
+            if (y + height > m_height) {
+                return false;
+            }
+            remaining -= std::min(remaining, m_skyline[i].width);
+        }
+        return true;
+    }
+
+    void place(size_t index, const Rect& rect) {
+        m_skyline.insert(m_skyline.begin() + index, {rect.x, rect.y + rect.height, rect.width});
+
+        // Trim the segments now covered by the new one
+        uint32_t right = rect.x + rect.width;
+        for (size_t i = index + 1; i < m_skyline.size();) {
+            Segment& segment = m_skyline[i];
+            if (segment.x >= right) {
+                break;
+            }
+            uint32_t overlap = right - segment.x;
+            if (overlap >= segment.width) {
+                m_skyline.erase(m_skyline.begin() + i);
+                continue;
+            }
+            segment.x += overlap;
+            segment.width -= overlap;
+            break;
+        }
+
+        // Merge neighbours at the same height
+        for (size_t i = 0; i + 1 < m_skyline.size();) {
+            if (m_skyline[i].y == m_skyline[i + 1].y) {
+                m_skyline[i].width += m_skyline[i + 1].width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<Segment> m_skyline;
+};
+
+namespace detail {
+
+inline bool packPages(Layout& layout, std::string& error) {
+    uint32_t padding = layout.padding;
+    auto cellSize = [padding](uint32_t size) {
+        uint32_t cell = size + 2 * padding;
+        return padding > 0 ? (cell + padding - 1) / padding * padding : cell;
+    };
+
+    std::vector<size_t> order(layout.sprites.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&layout](size_t a, size_t b) {
+        return layout.sprites[a].height > layout.sprites[b].height;
+    });
+
+    std::vector<SkylinePacker> pages;
+    for (size_t index : order) {
+        Sprite& sprite = layout.sprites[index];
+        uint32_t cellWidth = cellSize(sprite.width);
+        uint32_t cellHeight = cellSize(sprite.height);
+        if (cellWidth > layout.pageSize || cellHeight > layout.pageSize) {
+            error = "sprite '" + sprite.name + "' does not fit in a " + std::to_string(layout.pageSize) + " page";
+            return false;
+        }
+
+        Rect cell;
+        uint32_t page = 0;
+        for (; page < pages.size(); page++) {
+            if (pages[page].insert(cellWidth, cellHeight, cell)) {
+                break;
+            }
+        }
+        if (page == pages.size()) {
+            pages.emplace_back(layout.pageSize, layout.pageSize);
+            pages.back().insert(cellWidth, cellHeight, cell);
+        }
+
+        sprite.page = page;
+        sprite.rect = {cell.x + padding, cell.y + padding, sprite.width, sprite.height};
+    }
+
+    layout.pageCount = static_cast<uint32_t>(pages.size());
+    return true;
+}
+
+} // namespace detail
+
+// Assigns a page and rect to every sprite in layout.sprites (width/height must be set).
+// Tallest sprites go first; ties keep their input order, so the result is deterministic.
+// When everything fits on one page, layout.pageSize shrinks to the smallest power of two
+// that still holds it. Returns false if a sprite cannot fit on an empty page.
+inline bool pack(Layout& layout, std::string& error) {
+    if (!detail::packPages(layout, error)) {
+        return false;
+    }
+
+    while (layout.pageCount == 1 && layout.pageSize > 1) {
+        Layout smaller = layout;
+        smaller.pageSize /= 2;
+        std::string ignored;
+        if (!detail::packPages(smaller, ignored) || smaller.pageCount != 1) {
+            break;
+        }
+        layout = std::move(smaller);
+    }
+    return true;
+}
+
+// Copies src into page at rect (bilinear resample if the sizes differ) and extrudes its
+// edges `padding` texels outwards. src and page must have the same channel count
+inline void blitPadded(const Image& src, Image& page, const Rect& rect, uint32_t padding) {
+    uint32_t channels = page.channels;
+    float scaleX = static_cast<float>(src.width) / rect.width;
+    float scaleY = static_cast<float>(src.height) / rect.height;
+
+    uint32_t x0 = rect.x >= padding ? rect.x - padding : 0;
+    uint32_t y0 = rect.y >= padding ? rect.y - padding : 0;
+    uint32_t x1 = std::min(page.width, rect.x + rect.width + padding);
+    uint32_t y1 = std::min(page.height, rect.y + rect.height + padding);
+
+    for (uint32_t y = y0; y < y1; y++) {
+        // Texel centre mapped into the source, clamped so the padding repeats the edge
+        int32_t localY = std::clamp(static_cast<int32_t>(y) - static_cast<int32_t>(rect.y),
+                                    0, static_cast<int32_t>(rect.height) - 1);
+        float sy = std::max(0.0f, (localY + 0.5f) * scaleY - 0.5f);
+        uint32_t sy0 = std::min(static_cast<uint32_t>(sy), src.height - 1);
+        uint32_t sy1 = std::min(sy0 + 1, src.height - 1);
+        float fy = sy - sy0;
+
+        for (uint32_t x = x0; x < x1; x++) {
+            int32_t localX = std::clamp(static_cast<int32_t>(x) - static_cast<int32_t>(rect.x),
+                                        0, static_cast<int32_t>(rect.width) - 1);
+            float sx = std::max(0.0f, (localX + 0.5f) * scaleX - 0.5f);
+            uint32_t sx0 = std::min(static_cast<uint32_t>(sx), src.width - 1);
+            uint32_t sx1 = std::min(sx0 + 1, src.width - 1);
+            float fx = sx - sx0;
+
+            const uint8_t* t00 = src.pixels.data() + (static_cast<size_t>(sy0) * src.width + sx0) * channels;
+            const uint8_t* t10 = src.pixels.data() + (static_cast<size_t>(sy0) * src.width + sx1) * channels;
+            const uint8_t* t01 = src.pixels.data() + (static_cast<size_t>(sy1) * src.width + sx0) * channels;
+            const uint8_t* t11 = src.pixels.data() + (static_cast<size_t>(sy1) * src.width + sx1) * channels;
+            uint8_t* out = page.pixels.data() + (static_cast<size_t>(y) * page.width + x) * channels;
+
+            for (uint32_t c = 0; c < channels; c++) {
+                float top = t00[c] + (t10[c] - t00[c]) * fx;
+                float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+                out[c] = static_cast<uint8_t>(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+// Builds one page of one map. images[i] belongs to layout.sprites[i]; sprites without an
+// image for this map (null or invalid) keep the neutral fill
+inline Image composePage(const Layout& layout, uint32_t page, const std::vector<const Image*>& images,
+                         uint32_t channels, const uint8_t* neutral) {
+    Image result;
+    result.width = layout.pageSize;
+    result.height = layout.pageSize;
+    result.channels = channels;
+    result.pixels.resize(static_cast<size_t>(layout.pageSize) * layout.pageSize * channels);
+    for (size_t i = 0; i < result.pixels.size(); i += channels) {
+        std::copy(neutral, neutral + channels, result.pixels.begin() + i);
+    }
+
+    for (size_t i = 0; i < layout.sprites.size(); i++) {
+        if (layout.sprites[i].page == page && images[i] && images[i]->isValid()) {
+            blitPadded(*images[i], result, layout.sprites[i].rect, layout.padding);
+        }
+    }
+    return result;
+}
+
+// Text manifest:
+//   atlas <pageSize> <padding> <pageCount>
+//   sprite <name> <source> <page> <x> <y> <width> <height>
+inline bool writeManifest(const std::string& filepath, const Layout& layout) {
+    std::ofstream file(filepath);
+    if (!file) {
+        return false;
+    }
+    file << "atlas " << layout.pageSize << " " << layout.padding << " " << layout.pageCount << "\n";
+    for (const Sprite& sprite : layout.sprites) {
+        file << "sprite " << sprite.name << " " << (sprite.source.empty() ? "-" : sprite.source) << " "
+             << sprite.page << " " << sprite.rect.x << " " << sprite.rect.y << " "
+             << sprite.rect.width << " " << sprite.rect.height << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+inline bool readManifest(const std::string& filepath, Layout& layout) {
+    std::ifstream file(filepath);
+    std::string line;
+    if (!file || !std::getline(file, line)) {
+        return false;
+    }
+
+    std::istringstream header(line);
+    std::string tag;
+    if (!(header >> tag >> layout.pageSize >> layout.padding >> layout.pageCount) || tag != "atlas") {
+        return false;
+    }
+
+    layout.sprites.clear();
+    while (std::getline(file, line)) {
+        std::istringstream entry(line);
+        Sprite sprite;
+        if (!(entry >> tag >> sprite.name >> sprite.source >> sprite.page >>
+              sprite.rect.x >> sprite.rect.y >> sprite.rect.width >> sprite.rect.height)) {
+            continue;
+        }
+        if (sprite.source == "-") {
+            sprite.source.clear();
+        }
+        sprite.width = sprite.rect.width;
+        sprite.height = sprite.rect.height;
+        layout.sprites.push_back(sprite);
+    }
+    return true;
+}
+
+// Conventional page file for a cooked atlas: <base>_<page><suffix>.ktx2
+inline std::string pagePath(const std::string& manifestPath, uint32_t page, const std::string& suffix) {
+    std::string base = manifestPath;
+    size_t dot = base.find_last_of('.');
+    size_t slash = base.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        base.resize(dot);
+    }
+    return base + "_" + std::to_string(page) + suffix + ".ktx2";
+}
+
+} // namespace Atlas
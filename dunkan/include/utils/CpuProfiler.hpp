@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Scoped CPU markers are compiled in for debug builds; configure with -DDUNKAN_CPU_PROFILER=ON to
+// keep them in release builds. Without them the macros expand to nothing and captures do nothing
+#if !defined(NDEBUG) || defined(DUNKAN_CPU_PROFILER)
+#define DUNKAN_CPU_PROFILING 1
+#else
+#define DUNKAN_CPU_PROFILING 0
+#endif
+
+// Captures CPU time spent in named scopes on every thread and writes them as a Chrome trace (JSON
+// loadable by chrome://tracing or ui.perfetto.dev). Each thread records into its own fixed-size
+// ring, created the first time the thread records, so a marker never allocates or locks. Nothing
+// is recorded outside a capture; a capture spans whole frames, delimited by frameBoundary()
+class CpuProfiler {
+public:
+    static constexpr uint32_t RING_SIZE = 16384;   // Events per thread, older ones are overwritten
+
+    // Scope names must outlive the capture (string literals)
+    struct Scope {
+#if DUNKAN_CPU_PROFILING
+        explicit Scope(const char* name) : m_name(name), m_begin(isRecording() ? now() : 0) {}
+        ~Scope() {
+            if (m_begin != 0) {
+                record(m_name, m_begin, now());
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_begin;   // 0 when not recording at the start of the scope
+#endif
+    };
+
+    static constexpr bool isCompiledIn() { return DUNKAN_CPU_PROFILING != 0; }
+
+    // Name shown for the calling thread's track in the trace
+    static void setThreadName(const char* name);
+
+    // Records the next frameCount frames and writes them to path. Returns false when profiling is
+    // compiled out or a capture is already running
+    static bool requestCapture(uint32_t frameCount, const std::string& path);
+    // Call on the main thread between frames: starts a requested capture, and ends and writes the
+    // running one once its frames are done
+    static void frameBoundary();
+
+    static bool isCapturing();
+    // Result of the last finished capture: its file (empty when it couldn't be written), the
+    // number of events written and of events lost to full rings
+    static const std::string& getLastCapturePath();
+    static uint64_t getLastCaptureEvents();
+    static uint64_t getLastCaptureDropped();
+
+#if DUNKAN_CPU_PROFILING
+private:
+    static bool isRecording();
+    static uint64_t now();   // Nanoseconds, never 0
+    static void record(const char* name, uint64_t begin, uint64_t end);
+#endif
+};
+
+#define DUNKAN_PROFILE_CONCAT_INNER(a, b) a##b
+#define DUNKAN_PROFILE_CONCAT(a, b) DUNKAN_PROFILE_CONCAT_INNER(a, b)
+
+#if DUNKAN_CPU_PROFILING
+#define PROFILE_SCOPE(name) CpuProfiler::Scope DUNKAN_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD(name) CpuProfiler::setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal KTX2 container support: single 2D image (no layers, faces or supercompression)
+// with a full mip chain. Written by tools/texture_cooker, read by VulkanImage::decodeKtx2.
+// Vulkan-free so the cooker doesn't need the SDK; formats are raw VkFormat values.
+namespace Ktx2 {
+
+constexpr uint32_t FORMAT_R8G8B8A8_UNORM = 37;   // VK_FORMAT_R8G8B8A8_UNORM
+constexpr uint32_t FORMAT_R8G8B8A8_SRGB = 43;    // VK_FORMAT_R8G8B8A8_SRGB
+constexpr uint32_t FORMAT_BC4_UNORM = 139;       // VK_FORMAT_BC4_UNORM_BLOCK
+constexpr uint32_t FORMAT_BC5_UNORM = 141;       // VK_FORMAT_BC5_UNORM_BLOCK
+constexpr uint32_t FORMAT_BC7_UNORM = 145;       // VK_FORMAT_BC7_UNORM_BLOCK
+constexpr uint32_t FORMAT_BC7_SRGB = 146;        // VK_FORMAT_BC7_SRGB_BLOCK
+
+struct Image {
+    uint32_t vkFormat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;   // levels[0] is the full-size image
+};
+
+inline const uint8_t* identifier() {
+    static const uint8_t IDENTIFIER[12] = {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+    return IDENTIFIER;
+}
+
+inline bool isBlockCompressed(uint32_t vkFormat) {
+    return vkFormat >= 131 && vkFormat <= 146;   // BC1..BC7
+}
+
+// Bytes per 4x4 block, or per texel for uncompressed formats
+inline uint32_t blockBytes(uint32_t vkFormat) {
+    switch (vkFormat) {
+        case FORMAT_BC4_UNORM: return 8;
+        case FORMAT_BC5_UNORM:
+        case FORMAT_BC7_UNORM:
+        case FORMAT_BC7_SRGB: return 16;
+        default: return 4;
+    }
+}
+
+namespace detail {
+
+constexpr size_t HEADER_SIZE = 80;
+constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+inline void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+inline void put64(std::vector<uint8_t>& out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+}
+
+inline uint32_t get32(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+inline uint64_t get64(const uint8_t* data) {
+    return get32(data) | (static_cast<uint64_t>(get32(data + 4)) << 32);
+}
+
+// Basic data format descriptor (Khronos Data Format spec, section 5)
+inline std::vector<uint8_t> dataFormatDescriptor(uint32_t vkFormat) {
+    struct Sample { uint16_t bitOffset; uint8_t bitLength; uint8_t channel; };
+
+    uint8_t colorModel = 1;                 // KHR_DF_MODEL_RGBSDA
+    uint8_t transfer = 1;                   // KHR_DF_TRANSFER_LINEAR
+    uint8_t blockDimension = 0;             // 1x1 texels
+    std::vector<Sample> samples;
+
+    switch (vkFormat) {
+        case FORMAT_BC4_UNORM:
+            colorModel = 131;
+            blockDimension = 3;
+            samples = {{0, 63, 0}};
+            break;
+        case FORMAT_BC5_UNORM:
+            colorModel = 132;
+            blockDimension = 3;
+            samples = {{0, 63, 0}, {64, 63, 1}};
+            break;
+        case FORMAT_BC7_SRGB:
+            transfer = 2;                   // KHR_DF_TRANSFER_SRGB
+            [[fallthrough]];
+        case FORMAT_BC7_UNORM:
+            colorModel = 134;
+            blockDimension = 3;
+            samples = {{0, 127, 0}};
+            break;
+        case FORMAT_R8G8B8A8_SRGB:
+            transfer = 2;
+            [[fallthrough]];
+        default:
+            samples = {{0, 7, 0}, {8, 7, 1}, {16, 7, 2}, {24, 7, 15}};
+            break;
+    }
+
+    std::vector<uint8_t> out;
+    uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    put32(out, 4 + blockSize);              // dfdTotalSize
+    put32(out, 0);                          // vendorId = Khronos, descriptorType = basic
+    put32(out, 2 | (blockSize << 16));      // versionNumber, descriptorBlockSize
+    out.push_back(colorModel);
+    out.push_back(1);                       // KHR_DF_PRIMARIES_BT709
+    out.push_back(transfer);
+    out.push_back(0);                       // Straight alpha
+    out.push_back(blockDimension);
+    out.push_back(blockDimension);
+    out.push_back(0);
+    out.push_back(0);
+    put32(out, blockBytes(vkFormat));       // bytesPlane0..3
+    put32(out, 0);                          // bytesPlane4..7
+
+    for (const Sample& sample : samples) {
+        out.push_back(static_cast<uint8_t>(sample.bitOffset));
+        out.push_back(static_cast<uint8_t>(sample.bitOffset >> 8));
+        out.push_back(sample.bitLength);
+        // Alpha is never sRGB-encoded: KHR_DF_SAMPLE_DATATYPE_LINEAR
+        out.push_back(sample.channel == 15 && transfer == 2 ? sample.channel | 0x10 : sample.channel);
+        put32(out, 0);                      // samplePosition0..3
+        put32(out, 0);                      // sampleLower
+        put32(out, sample.bitLength == 7 ? 255u : 0xFFFFFFFFu);
+    }
+    return out;
+}
+
+} // namespace detail
+
+inline bool write(const std::string& filepath, const Image& image) {
+    using namespace detail;
+
+    uint32_t levelCount = static_cast<uint32_t>(image.levels.size());
+    std::vector<uint8_t> dfd = dataFormatDescriptor(image.vkFormat);
+
+    // Level data is aligned to lcm(block size, 4) and stored smallest mip first
+    size_t alignment = isBlockCompressed(image.vkFormat) ? blockBytes(image.vkFormat) : 4;
+    size_t dfdOffset = HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * levelCount;
+    size_t dataOffset = dfdOffset + dfd.size();
+
+    std::vector<uint64_t> levelOffsets(levelCount);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        dataOffset = (dataOffset + alignment - 1) / alignment * alignment;
+        levelOffsets[level] = dataOffset;
+        dataOffset += image.levels[level].size();
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(dataOffset);
+    out.insert(out.end(), identifier(), identifier() + 12);
+    put32(out, image.vkFormat);
+    put32(out, 1);                          // typeSize
+    put32(out, image.width);
+    put32(out, image.height);
+    put32(out, 0);                          // pixelDepth
+    put32(out, 0);                          // layerCount
+    put32(out, 1);                          // faceCount
+    put32(out, levelCount);
+    put32(out, 0);                          // supercompressionScheme
+    put32(out, static_cast<uint32_t>(dfdOffset));
+    put32(out, static_cast<uint32_t>(dfd.size()));
+    put32(out, 0);                          // kvdByteOffset
+    put32(out, 0);                          // kvdByteLength
+    put64(out, 0);                          // sgdByteOffset
+    put64(out, 0);                          // sgdByteLength
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        put64(out, levelOffsets[level]);
+        put64(out, image.levels[level].size());
+        put64(out, image.levels[level].size());
+    }
+    out.insert(out.end(), dfd.begin(), dfd.end());
+
+    for (uint32_t level = levelCount; level-- > 0;) {
+        out.resize(levelOffsets[level], 0);
+        out.insert(out.end(), image.levels[level].begin(), image.levels[level].end());
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
+
+inline bool read(const std::string& filepath, Image& image) {
+    using namespace detail;
+
+    std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file || bytes.size() < HEADER_SIZE || memcmp(bytes.data(), identifier(), 12) != 0) {
+        return false;
+    }
+
+    const uint8_t* header = bytes.data() + 12;
+    image.vkFormat = get32(header);
+    image.width = get32(header + 8);
+    image.height = get32(header + 12);
+    uint32_t pixelDepth = get32(header + 16);
+    uint32_t layerCount = get32(header + 20);
+    uint32_t faceCount = get32(header + 24);
+    uint32_t levelCount = std::max(1u, get32(header + 28));
+    uint32_t supercompression = get32(header + 32);
+
+    // Only what the cooker produces
+    if (pixelDepth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0 ||
+        bytes.size() < HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * levelCount) {
+        return false;
+    }
+
+    image.levels.assign(levelCount, {});
+    for (uint32_t level = 0; level < levelCount; level++) {
+        const uint8_t* entry = bytes.data() + HEADER_SIZE + LEVEL_INDEX_ENTRY_SIZE * level;
+        uint64_t offset = get64(entry);
+        uint64_t length = get64(entry + 8);
+        if (offset + length > bytes.size()) {
+            return false;
+        }
+        image.levels[level].assign(bytes.begin() + offset, bytes.begin() + offset + length);
+    }
+    return true;
+}
+
+} // namespace Ktx2
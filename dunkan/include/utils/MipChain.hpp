@@ -0,0 +1,82 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// CPU mip generation for 8-bit images, shared by the engine's loader threads and the
+// offline texture cooker. Pure functions, safe to call from any thread.
+namespace MipChain {
+
+inline uint32_t levelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+inline uint32_t levelSize(uint32_t size, uint32_t level) {
+    return std::max(1u, size >> level);
+}
+
+inline float srgbToLinear(float value) {
+    return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+inline uint8_t linearToSrgb8(float value) {
+    value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// 2x2 box filter from src (srcWidth x srcHeight) into dst (half size, at least 1x1).
+// With srgb set, the first three channels are averaged in linear space; alpha and
+// single/dual-channel data are always averaged as stored
+inline void downsample(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight,
+                       uint32_t channels, bool srgb, uint8_t* dst) {
+    static const std::array<float, 256> SRGB_TO_LINEAR = [] {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; i++) {
+            table[i] = srgbToLinear(i / 255.0f);
+        }
+        return table;
+    }();
+
+    uint32_t dstWidth = std::max(1u, srcWidth / 2);
+    uint32_t dstHeight = std::max(1u, srcHeight / 2);
+    uint32_t srgbChannels = srgb ? std::min(channels, 3u) : 0;
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        // Odd sizes clamp the second tap to the edge
+        uint32_t y0 = std::min(y * 2, srcHeight - 1);
+        uint32_t y1 = std::min(y * 2 + 1, srcHeight - 1);
+
+        for (uint32_t x = 0; x < dstWidth; x++) {
+            uint32_t x0 = std::min(x * 2, srcWidth - 1);
+            uint32_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+
+            const uint8_t* taps[4] = {
+                src + (static_cast<size_t>(y0) * srcWidth + x0) * channels,
+                src + (static_cast<size_t>(y0) * srcWidth + x1) * channels,
+                src + (static_cast<size_t>(y1) * srcWidth + x0) * channels,
+                src + (static_cast<size_t>(y1) * srcWidth + x1) * channels
+            };
+            uint8_t* out = dst + (static_cast<size_t>(y) * dstWidth + x) * channels;
+
+            for (uint32_t c = 0; c < channels; c++) {
+                if (c < srgbChannels) {
+                    float sum = SRGB_TO_LINEAR[taps[0][c]] + SRGB_TO_LINEAR[taps[1][c]] +
+                                SRGB_TO_LINEAR[taps[2][c]] + SRGB_TO_LINEAR[taps[3][c]];
+                    out[c] = linearToSrgb8(sum * 0.25f);
+                } else {
+                    uint32_t sum = taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c];
+                    out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+} // namespace MipChain
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size worker pool for CPU work that must stay off the main thread (image decoding,
+// mip generation). Jobs run in FIFO order; results come back through std::future.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t threadCount = defaultThreadCount()) {
+        threadCount = std::max(1u, threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename F>
+    auto submit(F&& job) -> std::future<std::invoke_result_t<F>> {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.emplace([task] { (*task)(); });
+        }
+        m_condition.notify_one();
+        return result;
+    }
+
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // Leave one core for the main thread
+    static uint32_t defaultThreadCount() {
+        uint32_t cores = std::thread::hardware_concurrency();
+        return cores > 1 ? cores - 1 : 1;
+    }
+
+private:
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+                if (m_stopping && m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
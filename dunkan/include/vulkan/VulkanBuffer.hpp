@@ -2,28 +2,34 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanContext.hpp"
+#include "VulkanMemoryAllocator.hpp"
 
 class VulkanBuffer {
 public:
     VulkanBuffer(VulkanContext& context);
     ~VulkanBuffer();
     
-    void create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+    // Staging and other short-lived buffers should use AllocationStrategy::Linear
+    void create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                AllocationStrategy strategy = AllocationStrategy::Buddy);
     void cleanup();
     
     void copyFrom(const void* data, VkDeviceSize size);
     void copyTo(VulkanBuffer& dst, VkDeviceSize size);
     
     VkBuffer getBuffer() const { return m_buffer; }
-    VkDeviceMemory getMemory() const { return m_memory; }
+    VkDeviceMemory getMemory() const { return m_allocation.memory; }
+    VkDeviceSize getMemoryOffset() const { return m_allocation.offset; }
     VkDeviceSize getSize() const { return m_size; }
     
+    // Host-visible memory is persistently mapped by the allocator; unmap() is a no-op
     void* map();
     void unmap();
+    void* getMapped() const { return m_allocation.mapped; }
     
 private:
     VulkanContext& m_context;
     VkBuffer m_buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    VulkanAllocation m_allocation;
     VkDeviceSize m_size = 0;
 };
@@ -4,11 +4,18 @@
 #include <vector>
 #include <string>
 #include <optional>
+#include <memory>
 #include <GLFW/glfw3.h>
 
+class VulkanMemoryAllocator;
+class VulkanPipelineCache;
+class VulkanSamplerCache;
+class VulkanUploadManager;
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily;  // Transfer-only family, if the device exposes one
     
     bool isComplete() const {
         return graphicsFamily.has_value() && presentFamily.has_value();
@@ -20,22 +27,38 @@ public:
     VulkanContext();
     ~VulkanContext();
     
+    // Without a window (nullptr) the context is headless: no surface, no surface or swapchain
+    // extensions, and the present queue is the graphics queue (render into VulkanOffscreenTarget)
     void init(GLFWwindow* window);
     void cleanup();
     
+    bool isHeadless() const { return m_headless; }
+    
     VkInstance getInstance() const { return m_instance; }
     VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
     VkDevice getDevice() const { return m_device; }
     VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
     VkQueue getPresentQueue() const { return m_presentQueue; }
+    VkQueue getTransferQueue() const { return m_transferQueue; }
     VkCommandPool getCommandPool() const { return m_commandPool; }
     VkSurfaceKHR getSurface() const { return m_surface; }
     QueueFamilyIndices getQueueFamilies() const { return m_queueFamilies; }
+    const VkPhysicalDeviceProperties& getDeviceProperties() const { return m_deviceProperties; }
+    // BC1-7 sampling is enabled on the device when the hardware supports it
+    bool supportsBlockCompression() const { return m_deviceFeatures.textureCompressionBC == VK_TRUE; }
+    // Pipeline statistics queries are enabled on the device when the hardware supports them
+    bool supportsPipelineStatistics() const { return m_deviceFeatures.pipelineStatisticsQuery == VK_TRUE; }
+    VulkanMemoryAllocator& getAllocator() { return *m_allocator; }
+    VulkanUploadManager& getUploadManager() { return *m_uploadManager; }
+    VulkanSamplerCache& getSamplerCache() { return *m_samplerCache; }
+    VulkanPipelineCache& getPipelineCache() { return *m_pipelineCache; }
     
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
     
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    // Like findMemoryType, without throwing when nothing matches
+    bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     VkFormat findDepthFormat();
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
     
@@ -49,24 +72,34 @@ private:
     
     bool checkValidationLayerSupport();
     std::vector<const char*> getRequiredExtensions();
+    std::vector<const char*> getDeviceExtensions() const;
     bool isDeviceSuitable(VkPhysicalDevice device);
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     
     VkInstance m_instance;
     VkDebugUtilsMessengerEXT m_debugMessenger;
     VkSurfaceKHR m_surface;
+    bool m_headless = false;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_deviceProperties{};
+    VkPhysicalDeviceFeatures m_deviceFeatures{};   // Supported, not necessarily enabled
     VkDevice m_device;
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
+    VkQueue m_transferQueue;
     VkCommandPool m_commandPool;
     QueueFamilyIndices m_queueFamilies;
+    std::unique_ptr<VulkanMemoryAllocator> m_allocator;
+    std::unique_ptr<VulkanUploadManager> m_uploadManager;
+    std::unique_ptr<VulkanSamplerCache> m_samplerCache;
+    std::unique_ptr<VulkanPipelineCache> m_pipelineCache;
     
     const std::vector<const char*> m_validationLayers = {
         "VK_LAYER_KHRONOS_validation"
     };
     
-    const std::vector<const char*> m_deviceExtensions = {
+    // Only with a surface
+    const std::vector<const char*> m_swapchainExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
     
@@ -14,8 +14,13 @@ public:
     VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout);
     void updateTextureDescriptor(VkDescriptorSet descriptorSet, uint32_t binding,
                                   VkImageView imageView, VkSampler sampler);
+    // Subpass input read in place (no sampler), in SHADER_READ_ONLY_OPTIMAL
+    void updateInputAttachmentDescriptor(VkDescriptorSet descriptorSet, uint32_t binding,
+                                         VkImageView imageView);
     void updateUniformBuffer(VkDescriptorSet descriptorSet, uint32_t binding,
                              VkBuffer buffer, VkDeviceSize size);
+    void updateDynamicUniformBuffer(VkDescriptorSet descriptorSet, uint32_t binding,
+                                    VkBuffer buffer, VkDeviceSize range);
     
     void cleanup();
     
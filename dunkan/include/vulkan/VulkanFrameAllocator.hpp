@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanBuffer.hpp"
+#include <cstdint>
+
+// Persistently mapped ring buffer for per-frame dynamic data (UBOs, instance data, staging).
+// The buffer is split into one partition per frame in flight; allocations are pointer bumps
+// inside the current frame's partition, so the CPU never overwrites data the GPU may still read.
+class VulkanFrameAllocator {
+public:
+    struct Allocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        void* data = nullptr;
+    };
+
+    VulkanFrameAllocator(VulkanContext& context);
+    ~VulkanFrameAllocator();
+
+    void create(VkDeviceSize frameSize, uint32_t frameCount);
+    void cleanup();
+
+    // Call once per frame after the frame's fence has been waited on
+    void beginFrame(uint32_t frameIndex);
+
+    Allocation allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+    // Copies data into the current partition and returns its dynamic descriptor offset
+    uint32_t push(const void* data, VkDeviceSize size);
+
+    template <typename T>
+    uint32_t push(const T& value) { return push(&value, sizeof(T)); }
+
+    VkBuffer getBuffer() const { return m_buffer.getBuffer(); }
+    VkDeviceSize getFrameSize() const { return m_frameSize; }
+    uint32_t getFrameCount() const { return m_frameCount; }
+    VkDeviceSize getUsedBytes() const { return m_head - m_frameBase; }
+
+private:
+    VulkanContext& m_context;
+    VulkanBuffer m_buffer;
+    uint8_t* m_mapped = nullptr;
+
+    VkDeviceSize m_frameSize = 0;
+    uint32_t m_frameCount = 0;
+    VkDeviceSize m_minAlignment = 1;
+
+    VkDeviceSize m_frameBase = 0;
+    VkDeviceSize m_head = 0;
+};
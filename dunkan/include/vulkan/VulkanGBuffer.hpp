@@ -4,12 +4,31 @@
 #include "vulkan/VulkanImage.hpp"
 #include <vulkan/vulkan.h>
 
+// Both layouts store the same encoding (see color.frag), only the precision differs:
+//   color    - albedo RGB, alpha
+//   normal   - octahedral-encoded world-space normal in RG
+//   depth    - linear depth / DEPTH_RANGE in R
+//   material - roughness, metalness, AO, translucency
+enum class GBufferLayout {
+    Standard,   // RGBA8 + RGBA16F + R32F + RGBA8 = 20 bytes per pixel
+    Compact     // RGBA8 + RG16F + R16F + RGBA8 = 14 bytes per pixel
+};
+
+struct GBufferFormats {
+    VkFormat color;
+    VkFormat normal;
+    VkFormat depth;
+    VkFormat material;
+};
+
+GBufferFormats getGBufferFormats(GBufferLayout layout);
+
 // G-Buffer: 4 render targets for deferred rendering
 struct GBuffer {
-    VulkanImage* colorRT = nullptr;      // RGBA8 - Albedo texture
-    VulkanImage* normalRT = nullptr;     // RGBA16F - World-space normals + roughness
-    VulkanImage* depthRT = nullptr;      // R32F - Parallax height encoding
-    VulkanImage* materialRT = nullptr;   // RGBA8 - Roughness, metalness, translucency, AO
+    VulkanImage* colorRT = nullptr;      // Albedo texture
+    VulkanImage* normalRT = nullptr;     // Octahedral world-space normals
+    VulkanImage* depthRT = nullptr;      // Linear depth (height + z position)
+    VulkanImage* materialRT = nullptr;   // Roughness, metalness, AO, translucency
     VulkanImage* depthStencilImage = nullptr; // Actual depth buffer for Z-testing
     
     VkFramebuffer framebuffer = VK_NULL_HANDLE;
@@ -17,8 +36,19 @@ struct GBuffer {
     
     uint32_t width = 0;
     uint32_t height = 0;
+    GBufferLayout layout = GBufferLayout::Compact;
+    bool transient = false;
+    bool ownsDepthStencil = true;
     
-    void create(VulkanContext& context, uint32_t w, uint32_t h);
+    // transientTargets: the targets only live inside the merged render pass (written by its
+    // G-buffer subpass, read as input attachments by its composition subpass) and are never
+    // sampled or stored; they get lazily allocated memory where the device has it.
+    // depthStencil: depth buffer owned by someone else (a render graph transient image, with a
+    // view); the G-buffer creates its own when null
+    void create(VulkanContext& context, uint32_t w, uint32_t h, GBufferLayout gbufferLayout,
+                bool transientTargets = false, VulkanImage* depthStencil = nullptr);
     void cleanup(VulkanContext& context);
-    void recreate(VulkanContext& context, uint32_t w, uint32_t h);
+    // Same layout and kind at a new size. depthStencil as in create(): a borrowed depth buffer
+    // has to be passed again, it changes size too. Leaves the framebuffer to the owner
+    void recreate(VulkanContext& context, uint32_t w, uint32_t h, VulkanImage* depthStencil = nullptr);
 };
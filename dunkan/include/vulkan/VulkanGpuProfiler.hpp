@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU timestamps around each frame and around scopes recorded in it (the render graph's passes,
+// ImGui), optionally with pipeline statistics per scope. Each frame slot has its own queries; a
+// frame's results are read after its fence has signaled, the next time that frame slot is
+// recorded, so reading never waits on the GPU
+class VulkanGpuProfiler {
+public:
+    static constexpr uint32_t MAX_SCOPES = 32;   // Per frame, further scopes aren't measured
+
+    struct ScopeResult {
+        std::string name;
+        float milliseconds = 0.0f;
+        bool hasStatistics = false;         // Statistics were enabled and supported
+        uint64_t clippingPrimitives = 0;    // Primitives leaving the clipping stage
+        uint64_t fragmentInvocations = 0;
+        uint64_t computeInvocations = 0;
+    };
+
+    struct FrameResult {
+        float milliseconds = 0.0f;          // Whole command buffer
+        std::vector<ScopeResult> scopes;    // In recording order
+    };
+
+    VulkanGpuProfiler(VulkanContext& context);
+    ~VulkanGpuProfiler();
+
+    void init(uint32_t frameCount);
+    void cleanup();
+
+    // False when the graphics queue has no timestamps; nothing is recorded then
+    bool isSupported() const { return m_timestampPool != VK_NULL_HANDLE; }
+    bool supportsStatistics() const { return m_statisticsPool != VK_NULL_HANDLE; }
+    // Applies from the next beginFrame()
+    void setStatisticsEnabled(bool enabled) { m_statisticsRequested = enabled; }
+
+    // Collects the results of the last frame recorded in frameIndex's slot; its fence must have
+    // been waited on. Returns false while there are none, getLastFrame() keeps the previous ones
+    bool readResults(uint32_t frameIndex);
+    const FrameResult& getLastFrame() const { return m_lastFrame; }
+
+    // First and last commands of the frame's command buffer, outside any render pass
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void endFrame(VkCommandBuffer commandBuffer);
+
+    // Scopes nest and may sit inside render passes. Statistics are only gathered for scopes that
+    // ask for them, which must not nest and must begin and end outside render passes (queries of
+    // one type can't overlap). Returns the id to end the scope with
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name, bool statistics = false);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+private:
+    struct FrameSlot {
+        bool pending = false;                 // Queries written and not read yet
+        bool statistics = false;              // Statistics queries were reset and used
+        std::vector<std::string> scopeNames;
+        std::vector<bool> scopeStatistics;
+    };
+
+    uint32_t timestampQuery(uint32_t scope, uint32_t end) const;   // Query index within the pool
+
+    VulkanContext& m_context;
+    VkQueryPool m_timestampPool = VK_NULL_HANDLE;   // Per slot: frame begin/end, then two per scope
+    VkQueryPool m_statisticsPool = VK_NULL_HANDLE;  // Per slot: one per scope
+    std::vector<FrameSlot> m_slots;
+    uint32_t m_frameIndex = 0;                      // Slot being recorded
+    bool m_statisticsRequested = false;
+    float m_timestampPeriod = 0.0f;  // Nanoseconds per tick
+    uint64_t m_timestampMask = 0;    // Valid bits of a timestamp
+    FrameResult m_lastFrame;
+    std::vector<uint64_t> m_timestampScratch;
+    std::vector<uint64_t> m_statisticsScratch;
+};
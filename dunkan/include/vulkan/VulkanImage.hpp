@@ -2,24 +2,62 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanContext.hpp"
+#include "VulkanMemoryAllocator.hpp"
+#include "VulkanSamplerCache.hpp"
 #include <string>
+#include <vector>
 
 class VulkanImage {
 public:
+    // Decoded pixels; produced on worker threads, consumed by createFromPixels()
+    struct ImageData {
+        std::vector<uint8_t> pixels;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<VkDeviceSize> mipOffsets;   // Byte offset of each level in pixels; empty = level 0 only
+        uint32_t channels = 4;                  // Bytes per texel of raw 8-bit pixels
+        VkFormat format = VK_FORMAT_UNDEFINED;  // Set for pre-encoded data (KTX2); UNDEFINED = raw pixels
+        
+        bool isValid() const { return !pixels.empty(); }
+        uint32_t getMipLevels() const { return mipOffsets.empty() ? 1 : static_cast<uint32_t>(mipOffsets.size()); }
+    };
+    
     VulkanImage(VulkanContext& context);
     ~VulkanImage();
     
     void createImage(uint32_t width, uint32_t height, VkFormat format, 
                      VkImageTiling tiling, VkImageUsageFlags usage, 
-                     VkMemoryPropertyFlags properties);
+                     VkMemoryPropertyFlags properties, uint32_t mipLevels = 1);
     
     void createRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage);
+    // Render target without memory, bound later with bindMemory() (aliased by the render graph)
+    void createUnboundRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage);
+    void bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+    VkMemoryRequirements getMemoryRequirements() const;
     void createImageView(VkFormat format, VkImageAspectFlags aspectFlags);
-    void createSampler();
+    // Shared sampler from the context's cache; the image doesn't own it
+    void createSampler(const SamplerDesc& desc = {});
     void transitionLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
     void copyFromBuffer(VkBuffer buffer, uint32_t width, uint32_t height);
     void loadFromFile(const std::string& filepath);
     
+    // Thread-safe, touch no Vulkan state
+    // Keeps the first `channels` channels (R, RG, RGB or RGBA) of whatever the file holds
+    static bool decodeFile(const std::string& filepath, ImageData& data, uint32_t channels = 4);
+    // Cooked textures (tools/texture_cooker): block-compressed, mips included
+    static bool decodeKtx2(const std::string& filepath, ImageData& data);
+    // Appends a 2x2 box-filtered mip chain to raw pixel data; with srgb set, colour channels
+    // are averaged in linear space. Thread-safe, meant for the loader threads.
+    // maxLevels caps the chain (atlas pages stop before neighbouring sprites bleed together)
+    static void generateMips(ImageData& data, bool srgb, uint32_t maxLevels = UINT32_MAX);
+    static bool isSrgbFormat(VkFormat format);
+    // Stages and accesses that use an image in the given layout
+    static void getLayoutUsage(VkImageLayout layout, VkPipelineStageFlags& stages, VkAccessFlags& access);
+    
+    // Creates the image, queues its upload and creates view + sampler. Uses the mips in data
+    // if it has any, otherwise blits them on the GPU (or builds them here if the format/queue can't blit)
+    void createFromPixels(const ImageData& data, VkFormat format);
+    
     void cleanup();
     
     VkImage getImage() const { return m_image; }
@@ -27,15 +65,15 @@ public:
     VkSampler getSampler() const { return m_sampler; }
     uint32_t getWidth() const { return m_width; }
     uint32_t getHeight() const { return m_height; }
+    uint32_t getMipLevels() const { return m_mipLevels; }
     
 private:
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-    
     VulkanContext& m_context;
     VkImage m_image = VK_NULL_HANDLE;
-    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    VulkanAllocation m_allocation;
     VkImageView m_imageView = VK_NULL_HANDLE;
     VkSampler m_sampler = VK_NULL_HANDLE;
     uint32_t m_width = 0;
     uint32_t m_height = 0;
+    uint32_t m_mipLevels = 1;
 };
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanBuffer.hpp"
+#include "VulkanDescriptorManager.hpp"
+#include "VulkanImage.hpp"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// Tiled light culling. All lights live in a storage buffer with no fixed count, grouped by type
+// (directional, point, spot); a compute pass run after the G-buffer bins the point and spot lights
+// into TILE_SIZE x TILE_SIZE screen tiles, testing each light's range against the tile's bounds
+// (depth range read from the G-buffer), so composition only shades the lights listed for its tile.
+// Directional lights reach every pixel and are not binned
+class VulkanLightCulling {
+public:
+    static constexpr uint32_t TILE_SIZE = 16;              // Matches light_cull.comp and composite.frag
+    static constexpr uint32_t TILE_STRIDE = 256;           // Per tile: point count, spot count, then indices
+    static constexpr uint32_t MAX_LIGHTS_PER_TILE = TILE_STRIDE - 2;
+    static constexpr VkDeviceSize LIGHT_SIZE = 64;         // Four vec4s per light (std430)
+
+    VulkanLightCulling(VulkanContext& context, VulkanDescriptorManager& descriptorManager);
+    ~VulkanLightCulling();
+
+    // extent: size of the depth target, the largest area that can be binned
+    void init(VulkanImage* depth, VkExtent2D extent, uint32_t frameCount);
+    // Resizes the tile lists for new targets; the GPU must be done with the old ones
+    void resize(VulkanImage* depth, VkExtent2D extent);
+    void cleanup();
+
+    // Area of the depth target rendered this frame (its top-left part), binned into tiles from
+    // the next dispatch() on. Starts out as the whole target
+    void setRenderExtent(VkExtent2D extent);
+
+    // Copies this frame's lights (LIGHT_SIZE bytes each, directional then point then spot lights),
+    // growing the frame's buffer as needed. Call once the frame's fence has been waited on
+    void updateLights(uint32_t frameIndex, const void* lights,
+                      uint32_t directionalCount, uint32_t pointCount, uint32_t spotCount);
+
+    // Records the binning pass; call after the G-buffer pass and before composition. Records no
+    // barriers: the render graph orders it after the G-buffer writes (the depth it samples) and
+    // last frame's reads of the tile lists, and before composition reads them.
+    // viewOffset/viewSize map screen UVs to the world positions composite.frag shades.
+    // Without useTileDepth the G-buffer isn't read and tiles cover all depths, for the merged
+    // render pass where the G-buffer is only written after this has run
+    void dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                  const glm::vec2& viewOffset, const glm::vec2& viewSize, bool useTileDepth = true);
+
+    // Bound as set 1 of the composition pipeline: lights (binding 0), tile lists (binding 1)
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+    VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const { return m_frames[frameIndex].descriptorSet; }
+    uint32_t getLightCount(uint32_t frameIndex) const {
+        const FrameLights& frame = m_frames[frameIndex];
+        return frame.directionalCount + frame.pointCount + frame.spotCount;
+    }
+    uint32_t getTileCount() const { return m_tileCountX * m_tileCountY; }
+    uint32_t getTileCountX() const { return m_tileCountX; }
+
+private:
+    struct FrameLights {
+        std::unique_ptr<VulkanBuffer> buffer;   // Host visible, persistently mapped
+        uint32_t capacity = 0;
+        uint32_t directionalCount = 0;
+        uint32_t pointCount = 0;
+        uint32_t spotCount = 0;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+
+    void createPipeline();
+    void createTileBuffer(VkExtent2D extent);
+    void createLightBuffer(FrameLights& frame, uint32_t capacity);
+    void writeDescriptorSet(FrameLights& frame);
+
+    VulkanContext& m_context;
+    VulkanDescriptorManager& m_descriptorManager;
+    VulkanImage* m_depth = nullptr;
+
+    VkExtent2D m_extent{};          // Depth target size, the tile buffer holds its tiles
+    VkExtent2D m_renderExtent{};
+    uint32_t m_tileCountX = 0;      // Tiles of the render extent
+    uint32_t m_tileCountY = 0;
+    VulkanBuffer m_tileBuffer;
+    std::vector<FrameLights> m_frames;
+
+    VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
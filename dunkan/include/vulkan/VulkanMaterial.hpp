@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// The four maps every sprite material is made of, in descriptor binding order (binding 1 + map)
+enum MaterialMap { ALBEDO_MAP = 0, DEPTH_MAP, NORMAL_MAP, MATERIAL_MAP, MATERIAL_MAP_COUNT };
+
+// Upload format per material map. Only albedo is colour; height, normal and material maps
+// hold data and must not be sRGB-decoded, and height/normals don't need four channels
+inline constexpr VkFormat MATERIAL_MAP_FORMATS[MATERIAL_MAP_COUNT] = {
+    VK_FORMAT_R8G8B8A8_SRGB,    // ALBEDO_MAP
+    VK_FORMAT_R8_UNORM,         // DEPTH_MAP (height)
+    VK_FORMAT_R8G8_UNORM,       // NORMAL_MAP (X/Y, Z rebuilt in color.frag)
+    VK_FORMAT_R8G8B8A8_UNORM    // MATERIAL_MAP (roughness, metalness, AO)
+};
+inline constexpr uint32_t MATERIAL_MAP_CHANNELS[MATERIAL_MAP_COUNT] = {4, 1, 2, 4};
+
+// File name suffix of each map ("data/tree" -> "data/tree_albedo.png", ...)
+inline constexpr const char* MATERIAL_MAP_SUFFIXES[MATERIAL_MAP_COUNT] = {
+    "_albedo", "_height", "_normal", "_material"
+};
+
+// Texel value where a map has no data: transparent albedo (discarded), zero height,
+// flat normal (read as "no normal map" by color.frag), default roughness/metalness/AO
+inline constexpr uint8_t MATERIAL_MAP_NEUTRAL[MATERIAL_MAP_COUNT][4] = {
+    {0, 0, 0, 0},
+    {0, 0, 0, 0},
+    {128, 128, 0, 0},
+    {128, 0, 255, 255}
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+class VulkanContext;
+
+// Buddy: general purpose, power-of-two blocks that merge back on free.
+// Linear: bump allocation for short-lived data (staging); a block rewinds once
+// every allocation in it has been freed.
+enum class AllocationStrategy {
+    Buddy,
+    Linear
+};
+
+// Buffers and images live in separate pools so bufferImageGranularity never applies
+enum class AllocationKind {
+    Buffer,
+    Image
+};
+
+struct VulkanAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mapped = nullptr;   // Non-null for host-visible memory (persistently mapped)
+
+    // Bookkeeping for free()
+    uint32_t poolIndex = UINT32_MAX;   // UINT32_MAX = dedicated allocation
+    uint32_t blockIndex = 0;
+    uint32_t order = 0;
+
+    bool isValid() const { return memory != VK_NULL_HANDLE; }
+};
+
+// Sub-allocates VkDeviceMemory blocks so resources don't each cost a vkAllocateMemory call
+// (and a slot in maxMemoryAllocationCount). Pools are keyed by memory type, resource kind
+// and strategy; large or explicitly requested resources get a dedicated allocation.
+class VulkanMemoryAllocator {
+public:
+    struct PoolStats {
+        uint32_t memoryTypeIndex = 0;
+        AllocationKind kind = AllocationKind::Buffer;
+        AllocationStrategy strategy = AllocationStrategy::Buddy;
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize blockBytes = 0;        // Device memory reserved by the pool
+        VkDeviceSize usedBytes = 0;         // Bytes requested by live allocations
+        VkDeviceSize largestFreeRange = 0;
+        float fragmentation = 0.0f;         // 1 - largestFreeRange / freeBytes
+    };
+
+    struct Stats {
+        std::vector<PoolStats> pools;
+        uint32_t dedicatedCount = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        uint32_t deviceMemoryCount = 0;     // Live vkAllocateMemory calls
+    };
+
+    VulkanMemoryAllocator(VulkanContext& context);
+    ~VulkanMemoryAllocator();
+
+    void init();
+    void cleanup();
+
+    // Allocate and bind memory for a resource
+    VulkanAllocation allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                                    AllocationStrategy strategy = AllocationStrategy::Buddy);
+    VulkanAllocation allocateImage(VkImage image, VkMemoryPropertyFlags properties,
+                                   bool dedicated = false);
+    // Own VkDeviceMemory for images the caller binds itself (several aliased render graph images)
+    VulkanAllocation allocateImageMemory(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties);
+    void free(VulkanAllocation& allocation);
+
+    Stats getStats() const;
+
+    static const char* kindName(AllocationKind kind);
+    static const char* strategyName(AllocationStrategy strategy);
+
+private:
+    static constexpr VkDeviceSize MIN_BLOCK_SIZE = 1024 * 1024;
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+    static constexpr VkDeviceSize MIN_BUDDY_SIZE = 256;
+
+    struct Block {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint8_t* mapped = nullptr;
+
+        std::vector<std::set<VkDeviceSize>> freeLists;   // Buddy: free offsets per order
+        VkDeviceSize head = 0;                           // Linear: bump pointer
+
+        VkDeviceSize usedBytes = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    struct Pool {
+        uint32_t memoryTypeIndex = 0;
+        AllocationKind kind = AllocationKind::Buffer;
+        AllocationStrategy strategy = AllocationStrategy::Buddy;
+        VkDeviceSize blockSize = 0;
+        std::vector<std::unique_ptr<Block>> blocks;      // Null slots are reused
+    };
+
+    VulkanAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+                              AllocationKind kind, AllocationStrategy strategy,
+                              bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+    VulkanAllocation allocateDedicated(const VkMemoryRequirements& requirements, uint32_t memoryTypeIndex,
+                                       VkBuffer buffer, VkImage image);
+
+    uint32_t getPool(uint32_t memoryTypeIndex, AllocationKind kind, AllocationStrategy strategy);
+    uint32_t createBlock(Pool& pool);
+    bool allocateFromBlock(Pool& pool, uint32_t blockIndex, VkDeviceSize size,
+                           VkDeviceSize alignment, VulkanAllocation& allocation);
+    void releaseBlock(Block& block);
+
+    VkDeviceSize chooseBlockSize(uint32_t memoryTypeIndex) const;
+    uint32_t buddyOrderCount(VkDeviceSize blockSize) const;
+
+    VulkanContext& m_context;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+    VkDeviceSize m_nonCoherentAtomSize = 1;
+
+    std::vector<std::unique_ptr<Pool>> m_pools;
+    uint32_t m_dedicatedCount = 0;
+    VkDeviceSize m_dedicatedBytes = 0;
+
+    mutable std::mutex m_mutex;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanDescriptorManager.hpp"
+#include "VulkanGBuffer.hpp"
+#include "VulkanPipeline.hpp"
+#include <memory>
+#include <vector>
+
+// Deferred rendering in one render pass: subpass 0 fills a transient G-buffer, subpass 1 composes
+// it into the swapchain image reading the G-buffer through input attachments. On tile-based GPUs the
+// G-buffer stays in tile memory (never stored, lazily allocated), elsewhere it saves the barriers
+// and render pass switch between the two passes. Only usable while nothing outside the pass reads
+// the G-buffer, so SSAO keeps the separate G-buffer and composition passes
+class VulkanMergedPass {
+public:
+    VulkanMergedPass(VulkanContext& context, VulkanDescriptorManager& descriptorManager);
+    ~VulkanMergedPass();
+
+    // renderPass from VulkanRenderPass::createMergedRenderPass(layout). Composition binds set 1
+    // from lightingSetLayout and the lighting UBO from uniformBuffer, like the separate pass
+    void init(VkRenderPass renderPass, VkExtent2D extent, GBufferLayout layout,
+              VkDescriptorSetLayout lightingSetLayout, VkBuffer uniformBuffer, VkDeviceSize uniformRange);
+    // One framebuffer per output image (swapchain or offscreen target) of the given size; call
+    // again whenever the output is recreated
+    void createFramebuffers(const std::vector<VkImageView>& imageViews, VkExtent2D extent);
+    // Recreates the G-buffer at the output's size, then the framebuffers. The GPU must be
+    // done with the old targets
+    void resize(const std::vector<VkImageView>& imageViews, VkExtent2D extent);
+    void cleanup();
+
+    // Begins the pass in the G-buffer subpass; draw the sprites with getGBufferPipeline()
+    void begin(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    // Moves to the composition subpass and draws the full screen triangle. permutation
+    // is composite_subpass.frag's (debug view); tilesPerRow is the light culling grid's
+    void compose(VkCommandBuffer commandBuffer, const ShaderPermutation& permutation,
+                 uint32_t lightingUBOOffset, VkDescriptorSet lightSet, float gamma, uint32_t tilesPerRow);
+    void end(VkCommandBuffer commandBuffer);
+
+    VulkanPipeline& getGBufferPipeline() { return *m_gbufferPipeline; }
+    const GBuffer& getGBuffer() const { return m_gbuffer; }
+
+private:
+    void destroyFramebuffers();
+    void writeDescriptorSet();
+
+    VulkanContext& m_context;
+    VulkanDescriptorManager& m_descriptorManager;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    GBuffer m_gbuffer;
+
+    std::unique_ptr<VulkanPipeline> m_gbufferPipeline;
+    std::unique_ptr<VulkanPipeline> m_compositionPipeline;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+    VkBuffer m_uniformBuffer = VK_NULL_HANDLE;
+    VkDeviceSize m_uniformRange = 0;
+
+    std::vector<VkFramebuffer> m_framebuffers;
+    VkExtent2D m_framebufferExtent{};
+};
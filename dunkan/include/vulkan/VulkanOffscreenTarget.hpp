@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanBuffer.hpp"
+#include "VulkanContext.hpp"
+#include "VulkanImage.hpp"
+#include "utils/ThreadPool.hpp"
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Stands in for VulkanSwapchain in headless mode (no surface): a ring of colour images the final
+// passes render into, each with a host-visible buffer its frame is copied into. The copy is
+// recorded at the end of the frame's command buffer and read once the frame's fence has signaled,
+// so reading back never stalls the GPU; PNG encoding runs on a worker thread
+class VulkanOffscreenTarget {
+public:
+    static constexpr size_t MAX_QUEUED_WRITES = 4;   // writePng() waits beyond this many
+
+    VulkanOffscreenTarget(VulkanContext& context);
+    ~VulkanOffscreenTarget();
+
+    // Any 8-bit RGBA format can be written out with writePng()
+    void create(VkExtent2D extent, uint32_t imageCount, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+    void cleanup();
+
+    VkFormat getImageFormat() const { return m_format; }
+    VkExtent2D getExtent() const { return m_extent; }
+    const std::vector<VkImage>& getImages() const { return m_images; }
+    const std::vector<VkImageView>& getImageViews() const { return m_imageViews; }
+    const std::vector<VkFramebuffer>& getFramebuffers() const { return m_framebuffers; }
+
+    void createFramebuffers(VkRenderPass renderPass);
+
+    // Copies image index into its readback buffer. The image must be in TRANSFER_SRC_OPTIMAL with
+    // its writes available to transfers (the render graph leaves it so as its final layout)
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t index);
+    // Once the submission that read index back has finished: takes a copy of its pixels and
+    // queues them to be written to path
+    void writePng(uint32_t index, const std::string& path);
+    // Waits for every queued PNG; returns how many couldn't be written
+    uint32_t waitForWrites();
+
+private:
+    void destroyFramebuffers();
+    void finishOldestWrite();
+
+    VulkanContext& m_context;
+    std::vector<std::unique_ptr<VulkanImage>> m_targets;
+    std::vector<std::unique_ptr<VulkanBuffer>> m_readbacks;
+    std::vector<VkImage> m_images;
+    std::vector<VkImageView> m_imageViews;
+    std::vector<VkFramebuffer> m_framebuffers;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    VkExtent2D m_extent{};
+
+    ThreadPool m_writer{1};
+    std::deque<std::future<bool>> m_writes;
+    uint32_t m_failedWrites = 0;
+};
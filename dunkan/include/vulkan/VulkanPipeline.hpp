@@ -3,9 +3,16 @@
 #include <vulkan/vulkan.h>
 #include "VulkanContext.hpp"
 #include "VulkanTypes.hpp"
+#include <array>
+#include <map>
 #include <vector>
 #include <string>
 
+// Values of a fragment shader's specialization constants, constant_id = index.
+// Shaders declaring fewer constants ignore the remaining slots
+constexpr uint32_t SPECIALIZATION_CONSTANT_COUNT = 4;
+using ShaderPermutation = std::array<uint32_t, SPECIALIZATION_CONSTANT_COUNT>;
+
 class VulkanPipeline {
 public:
     VulkanPipeline(VulkanContext& context);
@@ -15,27 +22,57 @@ public:
         VkRenderPass renderPass,
         const std::string& vertShaderPath,
         const std::string& fragShaderPath,
-        VkExtent2D extent,
         uint32_t attachmentCount = 1);
         
+    // lightingSetLayout is bound as set 1 (light buffer and tile light lists)
     void createCompositionPipeline(
         VkRenderPass renderPass,
         const std::string& vertShaderPath,
         const std::string& fragShaderPath,
-        VkExtent2D extent);
+        VkDescriptorSetLayout lightingSetLayout);
+        
+    // Composition as a later subpass of the merged render pass: bindings 0-3 are the G-buffer as
+    // input attachments (no SSAO binding), the rest matches createCompositionPipeline
+    void createSubpassCompositionPipeline(
+        VkRenderPass renderPass,
+        uint32_t subpass,
+        const std::string& vertShaderPath,
+        const std::string& fragShaderPath,
+        VkDescriptorSetLayout lightingSetLayout);
         
     void cleanup();
+    
+    // Viewport and scissor are dynamic state, so pipelines don't depend on the target size:
+    // set both to cover extent after binding a pipeline from this class
+    static void setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent);
         
     VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
-    VkPipeline getPipeline() const { return m_pipeline; }
+    VkPipeline getPipeline() const { return m_pipeline; }   // Default permutation (all constants 0)
     VkPipelineLayout getLayout() const { return m_pipelineLayout; }
     
+    // Compiled on first use and kept until cleanup(); all permutations share the layout
+    VkPipeline getPipeline(const ShaderPermutation& permutation);
+    size_t getPermutationCount() const { return m_permutations.size(); }
+    
 private:
-    VkShaderModule createShaderModule(const std::vector<char>& code);
-    std::vector<char> readFile(const std::string& filename);
+    enum class PipelineKind { GBuffer, Composition };
+    
+    VkPipeline compileGraphicsPipeline(const VkSpecializationInfo& specialization);
+    VkPipeline compileCompositionPipeline(const VkSpecializationInfo& specialization);
+    void createCompositionLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount,
+                                 VkDescriptorSetLayout lightingSetLayout);
     
     VulkanContext& m_context;
     VkPipeline m_pipeline = VK_NULL_HANDLE;
+    std::map<ShaderPermutation, VkPipeline> m_permutations;
+    
+    // Creation parameters, kept to compile further permutations
+    PipelineKind m_kind = PipelineKind::GBuffer;
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    uint32_t m_subpass = 0;
+    std::string m_vertShaderPath;
+    std::string m_fragShaderPath;
+    uint32_t m_attachmentCount = 1;
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
 };
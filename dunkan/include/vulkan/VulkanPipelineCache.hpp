@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class VulkanContext;
+
+// Everything pipeline creation shares across pipelines:
+// - a VkPipelineCache persisted to disk, so later runs skip most shader compilation.
+//   The file is only trusted if vendor, device, driver version and pipelineCacheUUID
+//   match the current device and its checksum is intact; otherwise it starts empty.
+// - SPIR-V modules, loaded once per path and kept until cleanup().
+class VulkanPipelineCache {
+public:
+    VulkanPipelineCache(VulkanContext& context);
+    ~VulkanPipelineCache();
+
+    void init(const std::string& filepath);
+    void cleanup();   // Saves, then destroys the cache and all shader modules
+
+    // Writes the cache to disk (through a temporary file, so a crash never leaves a torn one)
+    bool save();
+
+    VkPipelineCache getCache() const { return m_cache; }
+
+    // Thread-safe; throws if the file can't be read
+    VkShaderModule loadShaderModule(const std::string& filepath);
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+
+    FileHeader makeHeader() const;
+    std::vector<uint8_t> loadFromDisk() const;
+
+    VulkanContext& m_context;
+    std::string m_filepath;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+
+    std::mutex m_moduleMutex;
+    std::unordered_map<std::string, VkShaderModule> m_shaderModules;
+};
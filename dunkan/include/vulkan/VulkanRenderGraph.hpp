@@ -0,0 +1,196 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanImage.hpp"
+#include "VulkanMemoryAllocator.hpp"
+#include "VulkanSamplerCache.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+using RenderGraphResource = uint32_t;
+
+class VulkanGpuProfiler;
+
+// How a pass uses a resource. Each maps to the stages, accesses and (for images) layout the
+// graph synchronizes; a pass may declare several uses of the same resource
+enum class RenderGraphUsage {
+    ColorAttachment,    // Render pass color attachment (image)
+    DepthAttachment,    // Render pass depth/stencil attachment (image)
+    SampledFragment,    // Sampled in a fragment shader (image)
+    SampledCompute,     // Sampled in a compute shader (image)
+    General,            // Storage image in GENERAL, read/written/sampled by compute and fragment shaders
+    StorageRead,        // Storage buffer read by fragment shaders
+    StorageWrite        // Storage buffer written by compute shaders
+};
+
+// Frame render graph. Passes declare the resources they read and write and the graph derives
+// everything between them: layout transitions and barriers, passes whose outputs nothing uses
+// (culled), and memory for transient images, aliased between images that are never alive in the
+// same frame. Passes keep recording their own render passes and draws, but leave attachments in
+// the layout the graph gave them (render passes use them with matching initial/final layouts).
+//
+// Declare the resources once, then the passes in execution order and compile(); compile again
+// after reset() whenever the set of passes changes, execute() every frame. Transient images are
+// placed by the first compile() from the lifetimes of all the passes declared then (culled or not),
+// later compiles check that no two images sharing memory end up alive at the same time
+class VulkanRenderGraph {
+public:
+    struct ImageDesc {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkImageUsageFlags usage = 0;
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        bool sampled = false;       // Gets a sampler (samplerDesc) for descriptor writes
+        SamplerDesc samplerDesc{};
+    };
+
+    class PassBuilder {
+    public:
+        PassBuilder& read(RenderGraphResource resource, RenderGraphUsage usage);
+        PassBuilder& write(RenderGraphResource resource, RenderGraphUsage usage);
+        // Read-modify-write (attachments loaded and drawn over, history images)
+        PassBuilder& readWrite(RenderGraphResource resource, RenderGraphUsage usage);
+
+    private:
+        friend class VulkanRenderGraph;
+        PassBuilder(VulkanRenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+        VulkanRenderGraph& m_graph;
+        uint32_t m_pass;
+    };
+
+    explicit VulkanRenderGraph(VulkanContext& context);
+    ~VulkanRenderGraph();
+
+    // Image owned by the graph whose contents don't outlive the frame; available from
+    // getImage() after the first compile()
+    RenderGraphResource createImage(const std::string& name, const ImageDesc& desc);
+    // Image owned elsewhere (setImage() before the first execute()), in restingLayout before and
+    // after every frame: the layout its descriptors were written with. Contents are kept unless
+    // a frame's first use only writes it
+    RenderGraphResource importImage(const std::string& name, VkImageLayout restingLayout,
+                                    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    // Presentable image, setImage() with the acquired image every frame. Starts undefined (its
+    // first use waits on the acquire semaphore's stage) and ends in finalLayout, made available
+    // to that layout's stages (none for PRESENT_SRC_KHR, a copy for TRANSFER_SRC_OPTIMAL).
+    // Always an output of the frame
+    RenderGraphResource importSwapchainImage(const std::string& name,
+                                             VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    // Buffers are synchronized with global memory barriers, so the graph never needs the handle
+    RenderGraphResource importBuffer(const std::string& name);
+    // Keeps the passes producing resource alive even if no pass reads it
+    void markOutput(RenderGraphResource resource);
+
+    void setImage(RenderGraphResource resource, VkImage image);
+    // Transient image; its memory, view and sampler exist after the first compile()
+    VulkanImage* getImage(RenderGraphResource resource) const;
+
+    // Passes run in the order they are added; record is called with the frame's command buffer
+    PassBuilder addPass(const std::string& name, std::function<void(VkCommandBuffer)> record);
+    // Drops the passes (resources and transient memory stay)
+    void reset();
+
+    void compile();
+    void execute(VkCommandBuffer commandBuffer);
+    // Measures every pass execute() records as a profiler scope (with pipeline statistics when
+    // the profiler gathers them); nullptr stops measuring
+    void setProfiler(VulkanGpuProfiler* profiler) { m_profiler = profiler; }
+    void cleanup();
+
+    bool isPassCulled(const std::string& name) const;
+    VkDeviceSize getTransientBytes() const { return m_transientBytes; }         // Allocated
+    VkDeviceSize getTransientUnaliasedBytes() const { return m_unaliasedBytes; } // Without aliasing
+
+private:
+    enum class ResourceType { Transient, Imported, Swapchain, Buffer };
+
+    // What has touched a resource (or a transient memory slot) since its last write
+    struct SyncState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;     // Read it since, the next write waits for them
+        VkPipelineStageFlags visibleStages = 0;  // The write was made visible to
+    };
+
+    struct Resource {
+        std::string name;
+        ResourceType type = ResourceType::Transient;
+        ImageDesc desc{};
+        VulkanImage* transientImage = nullptr; // Owned
+        VkImage image = VK_NULL_HANDLE;        // Imported and swapchain images
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+        VkImageLayout restingLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool output = false;
+
+        SyncState resting{};                   // Where the last compiled frame left it
+        uint32_t slot = UINT32_MAX;            // Transient: memory slot
+        uint32_t firstPass = UINT32_MAX;       // Transient: lifetime the slot was chosen for
+        uint32_t lastPass = 0;
+    };
+
+    // All of a pass's uses of one resource, merged
+    struct Use {
+        RenderGraphResource resource;
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        VkImageLayout layout;
+        bool read;
+        bool write;
+    };
+
+    struct Pass {
+        std::string name;
+        std::function<void(VkCommandBuffer)> record;
+        std::vector<Use> uses;
+        bool culled = false;
+    };
+
+    struct Slot {
+        VkMemoryRequirements requirements{};
+        VulkanAllocation allocation;
+        std::vector<RenderGraphResource> images;
+        SyncState resting{};
+    };
+
+    struct Barrier {
+        RenderGraphResource resource;
+        VkImageMemoryBarrier barrier;
+    };
+
+    struct Step {
+        uint32_t pass = UINT32_MAX;            // UINT32_MAX: the frame's closing transitions
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkMemoryBarrier memoryBarrier{};       // Buffers
+        std::vector<Barrier> imageBarriers;
+    };
+
+    RenderGraphResource addResource(Resource resource);
+    void addUse(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage, bool read, bool write);
+    void cull();
+    void placeTransientImages();
+    void checkAliasing() const;
+    void buildSteps();
+    void simulate(std::vector<SyncState>& states, std::vector<SyncState>& slotStates, std::vector<Step>& steps);
+    void synchronize(Step& step, const Use& use, SyncState& state);
+    static void merge(SyncState& state, const SyncState& other);
+    VkImage getVkImage(const Resource& resource) const;
+
+    VulkanContext& m_context;
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<Slot> m_slots;
+    std::vector<Step> m_steps;
+    std::vector<VkImageMemoryBarrier> m_barrierScratch;
+    VulkanGpuProfiler* m_profiler = nullptr;
+    bool m_placed = false;
+    bool m_compiled = false;
+    VkDeviceSize m_transientBytes = 0;
+    VkDeviceSize m_unaliasedBytes = 0;
+};
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanContext.hpp"
+#include "VulkanGBuffer.hpp"
 #include <vector>
 
 class VulkanRenderPass {
@@ -10,13 +11,19 @@ public:
     ~VulkanRenderPass();
     
     void create();
-    void createGBufferRenderPass();
+    void createGBufferRenderPass(GBufferLayout layout);
     void createSSAORenderPass();
+    // G-buffer subpass + composition subpass into the swapchain image (VulkanMergedPass)
+    void createMergedRenderPass(GBufferLayout layout);
+    // Draws over what the merged pass composed (ImGui); compatible with the final render pass
+    void createOverlayRenderPass();
     void cleanup();
     
     VkRenderPass getFinalRenderPass() const { return m_finalRenderPass; }
     VkRenderPass getGBufferRenderPass() const { return m_gbufferRenderPass; }
     VkRenderPass getSSAORenderPass() const { return m_ssaoRenderPass; }
+    VkRenderPass getMergedRenderPass() const { return m_mergedRenderPass; }
+    VkRenderPass getOverlayRenderPass() const { return m_overlayRenderPass; }
     
 private:
     VulkanContext& m_context;
@@ -24,4 +31,6 @@ private:
     VkRenderPass m_finalRenderPass = VK_NULL_HANDLE;
     VkRenderPass m_gbufferRenderPass = VK_NULL_HANDLE;
     VkRenderPass m_ssaoRenderPass = VK_NULL_HANDLE;
+    VkRenderPass m_mergedRenderPass = VK_NULL_HANDLE;
+    VkRenderPass m_overlayRenderPass = VK_NULL_HANDLE;
 };
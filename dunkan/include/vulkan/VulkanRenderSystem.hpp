@@ -1,40 +1,79 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <array>
+#include <functional>
+#include <future>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include "vulkan/VulkanContext.hpp"
 #include "vulkan/VulkanBuffer.hpp"
 #include "vulkan/VulkanDescriptorManager.hpp"
+#include "vulkan/VulkanFrameAllocator.hpp"
 #include "vulkan/VulkanPipeline.hpp"
 #include "vulkan/VulkanImage.hpp"
 #include "vulkan/VulkanGBuffer.hpp"
+#include "vulkan/VulkanMaterial.hpp"
+#include "vulkan/VulkanTextureAtlas.hpp"
 #include "game/types.hpp"
+#include "utils/ThreadPool.hpp"
 
 class VulkanRenderSystem {
 public:
     VulkanRenderSystem(VulkanContext& context, VulkanDescriptorManager& descriptorManager,
-                       VulkanPipeline& pipeline, EntityManager& entityManager);
+                       VulkanPipeline& pipeline, EntityManager& entityManager,
+                       VulkanFrameAllocator& frameAllocator);
     ~VulkanRenderSystem();
     
-    void prepareFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
-    void renderEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    // viewSize: world units covered by the screen, mapped onto whatever area is rendered
+    void prepareFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::vec2& viewSize);
+    // Fills the top-left renderExtent of the G-buffer (at most its size)
+    void renderEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D renderExtent);
+    // Sprite draws into the G-buffer subpass of an already begun merged render pass
+    // (VulkanMergedPass), using the pipelines given to setSubpassPipeline(); the pass sets the viewport
+    void drawEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    // G-buffer pipelines compatible with the merged render pass; material permutations are
+    // compiled for it as well as for the separate G-buffer pass
+    void setSubpassPipeline(VulkanPipeline* pipeline);
     
-    void initGBuffer(VkRenderPass renderPass, VkExtent2D extent);
+    // layout must match the one renderPass was created with. depthStencil: depth buffer owned
+    // elsewhere (the render graph's), the G-buffer creates its own when null
+    void initGBuffer(VkRenderPass renderPass, VkExtent2D extent, GBufferLayout layout,
+                     VulkanImage* depthStencil = nullptr);
+    // New targets at extent (the GPU must be done with the old ones); descriptors reading them
+    // have to be written again
+    void resizeGBuffer(VkExtent2D extent, VulkanImage* depthStencil = nullptr);
     const GBuffer& getGBuffer() const { return m_gbuffer; }
-    VulkanBuffer* getLightingUBO() { return m_lightingUBO; }
     
     void createDefaultTexture();
     VulkanImage* getDefaultTexture() { return m_defaultTexture; }
     
     // Texture management
+    // Decoding runs on worker threads; entities using the material render with the
+    // default texture until all of its maps are resident
     void loadTexture(const std::string& name, const std::string& filepath, 
                     const std::string& depthFilepath = "",
                     const std::string& normalFilepath = "",
                     const std::string& materialFilepath = "");
     VulkanImage* getTexture(const std::string& name);
     
+    // Atlas management
+    // Packs the maps of each material ("data/tree" -> data/tree_albedo.png, ...) into shared
+    // pages on the loader threads. Sprites keep their albedo name ("tree_albedo"), so entities
+    // switch to the atlas page and rect without changes and batch into one draw per page
+    void buildAtlas(const std::string& name, const std::vector<std::string>& materialPaths);
+    // Atlas cooked by `texture_cooker --atlas`; rebuilt from its manifest if the pages can't be used
+    void loadAtlas(const std::string& manifestPath);
+    
+    // Call once per frame, before the upload manager's update()
+    void updateStreaming();
+    size_t getPendingTextureCount() const { return m_pendingMaterials.size() + m_pendingAtlases.size(); }
+    
+    // Instanced sprite draws recorded by the last renderEntities()/drawEntities()
+    uint32_t getDrawCallCount() const { return m_drawCallCount; }
+    
 private:
     struct SpriteData {
         std::vector<Vertex> vertices;
@@ -44,21 +83,64 @@ private:
         glm::vec2 size;
     };
     
+    struct PendingMaterial {
+        std::string name;
+        std::array<std::string, MATERIAL_MAP_COUNT> filepaths;
+        std::array<std::future<VulkanImage::ImageData>, MATERIAL_MAP_COUNT> decoded;
+        std::array<VulkanImage*, MATERIAL_MAP_COUNT> images{};
+        uint64_t uploadTicket = 0;
+        bool uploading = false;
+    };
+    
+    struct PendingAtlas {
+        std::string name;
+        std::future<VulkanTextureAtlas::PageSet> pageSet;
+        std::unique_ptr<VulkanTextureAtlas> atlas;
+        uint64_t uploadTicket = 0;
+        bool uploading = false;
+    };
+    
+    struct DrawItem {
+        VkPipeline pipeline;
+        VkDescriptorSet descriptorSet;
+        SpriteInstance instance;
+    };
+    
+    void createGBufferFramebuffer();
     void createQuadVertices(std::vector<Vertex>& vertices, glm::vec2 size);
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, VulkanPipeline& pipeline);
+    bool beginMaterialUpload(PendingMaterial& material);
+    void finishMaterial(PendingMaterial& material);
+    void queueAtlas(const std::string& name, std::function<VulkanTextureAtlas::PageSet()> job);
+    void finishAtlas(PendingAtlas& pending);
+    VkDescriptorSet createMaterialDescriptorSet(const std::array<VulkanImage*, MATERIAL_MAP_COUNT>& images);
+    // G-buffer permutation enabling the maps present in images (nullptr = missing); compiled right away
+    ShaderPermutation selectPermutation(const std::array<VulkanImage*, MATERIAL_MAP_COUNT>& images);
     
     VulkanContext& m_context;
     VulkanDescriptorManager& m_descriptorManager;
     GBuffer m_gbuffer;
     VulkanPipeline& m_pipeline;
+    VulkanPipeline* m_subpassPipeline = nullptr;
     EntityManager& m_entityManager;
+    VulkanFrameAllocator& m_frameAllocator;
     
     VulkanImage* m_defaultTexture = nullptr;
     VulkanBuffer* m_quadVertexBuffer = nullptr;
     std::vector<VkDescriptorSet> m_descriptorSets;
-    VulkanBuffer* m_uniformBuffer = nullptr;
-    VulkanBuffer* m_lightingUBO = nullptr;  // Lighting uniform buffer
+    uint32_t m_uboOffset = 0;  // View/projection UBO offset in the frame allocator
     std::unordered_map<std::string, VulkanImage*> m_textures;
     std::unordered_map<std::string, VkDescriptorSet> m_textureDescriptorSets; // One descriptor set per texture
+    std::unordered_map<std::string, ShaderPermutation> m_texturePermutations;  // Maps each texture's material has
+    std::vector<std::unique_ptr<PendingMaterial>> m_pendingMaterials;
+    std::vector<std::unique_ptr<VulkanTextureAtlas>> m_atlases;
+    std::unordered_map<std::string, glm::vec4> m_spriteRects;   // Atlas UV rect per sprite name
+    std::vector<std::unique_ptr<PendingAtlas>> m_pendingAtlases;
+    std::vector<DrawItem> m_drawItems;                          // Reused every frame
+    uint32_t m_drawCallCount = 0;
+    
+    static constexpr int MAX_FRAMES = 3;   // Most frames in flight the application runs with
     
-    static constexpr int MAX_FRAMES = 2;
+    // Declared last so workers are joined before anything they could touch goes away
+    ThreadPool m_loaderPool;
 };
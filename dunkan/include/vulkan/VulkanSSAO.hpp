@@ -3,45 +3,141 @@
 #include "VulkanContext.hpp"
 #include "VulkanImage.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanFrameAllocator.hpp"
+#include "VulkanDescriptorManager.hpp"
+#include "VulkanRenderGraph.hpp"
 #include <glm/glm.hpp>
+#include <map>
 #include <random>
+#include <utility>
 #include <vector>
 
+// Screen-space ambient occlusion, written to ssaoOutput at full resolution.
+// With a downscale of 1 a fragment pass evaluates every pixel. With 2 or 4 a compute pass evaluates
+// one pixel per 2x2 (4x4) block, a separable depth-aware blur cleans up the interleaved noise and a
+// bilateral upsample writes the result into ssaoOutput, for a quarter (sixteenth) of the samples.
+// The reduced path can also run temporally: each frame evaluates every TEMPORAL_FRAMES-th kernel
+// sample, rotating through the kernel, and accumulates into a history target reprojected by the
+// camera offset (a translation in the orthographic view)
 class VulkanSSAO {
 public:
-    VulkanSSAO(VulkanContext& context);
+    static constexpr uint32_t MAX_DOWNSCALE = 4;
+    static constexpr uint32_t TEMPORAL_FRAMES = 8;   // Matches HISTORY_BLEND in ssao_temporal.comp
+
+    VulkanSSAO(VulkanContext& context, VulkanFrameAllocator& frameAllocator);
     ~VulkanSSAO();
 
+    // extent: size of the G-buffer, the largest area SSAO is evaluated for
     void init(VkRenderPass renderPass, VkExtent2D extent);
+    // Recreates ssaoOutput and the history at a new G-buffer size (the GPU must be done with the
+    // old ones); write the descriptor sets again afterwards
+    void resize(VkExtent2D extent);
     void cleanup();
     
-    void update(VkCommandBuffer commandBuffer, const glm::mat4& projection);
-    void updateParameters(float radius, float bias, float power);
-    void updateDescriptorSet(VkDescriptorSet descriptorSet, VulkanImage* depth, VulkanImage* normal);
+    // Pushes this frame's kernel UBO; call before binding descriptorSet with getKernelOffset()
+    void update(const glm::mat4& projection);
+    // A new kernel size regenerates the kernel and switches to that size's pipelines.
+    // downscale: 1 = full-resolution fragment pass, 2 or 4 = reduced-resolution compute pass.
+    // temporal only applies to the reduced-resolution pass
+    void updateParameters(float radius, float bias, float power, int kernelSize, int downscale = 1,
+                          bool temporal = false);
+    // Writes the descriptor sets of both paths, allocated on the first call. work0/work1: the
+    // reduced path's scratch images (getWorkImageDesc()), only alive during record() so they can
+    // live in render graph memory shared with other passes; the SSAO doesn't own them
+    void updateDescriptorSets(VulkanDescriptorManager& descriptorManager, VulkanImage* depth, VulkanImage* normal,
+                              VulkanImage* work0, VulkanImage* work1);
+    // Available after init()
+    VulkanRenderGraph::ImageDesc getWorkImageDesc() const;
+    // Temporal history, in GENERAL between frames
+    VulkanImage* getHistoryImage(uint32_t index) const { return m_historyImages[index]; }
+    uint32_t getKernelOffset() const { return m_kernelOffset; }
+    uint32_t getDownscale() const { return m_downscale; }
+    // The next record() starts the temporal history over, e.g. after frames without the SSAO pass
+    void invalidateHistory() { m_historyValid = false; }
+
+    // Records the whole SSAO pass for the current path (after the G-buffer pass). Barriers between
+    // its own stages only: the render graph orders it against the passes around it.
+    // viewOffset/viewSize: world position of the screen's top-left corner and the world units it
+    // covers, used to reproject the temporal history. renderExtent: area of the G-buffer rendered
+    // this frame (its top-left part), the area of ssaoOutput written
+    void record(VkCommandBuffer commandBuffer, const glm::mat4& projection,
+                const glm::vec2& viewOffset, const glm::vec2& viewSize, VkExtent2D renderExtent);
 
-    VkFramebuffer framebuffer;
-    VulkanImage* ssaoOutput;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VulkanImage* ssaoOutput = nullptr;
     
-    VkDescriptorSet descriptorSet;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
     VkDescriptorSetLayout descriptorSetLayout;
-    VkPipeline pipeline;
+    VkPipeline pipeline = VK_NULL_HANDLE;   // Pipeline for the current kernel size
     VkPipelineLayout pipelineLayout;
 
 private:
     void createNoiseTexture();
     void createKernel();
-    void createPipeline(VkRenderPass renderPass, VkExtent2D extent);
+    void createPipeline();
+    VkPipeline getPipeline(uint32_t kernelSize);   // Compiled on first use
+    
+    // ssaoOutput, its framebuffer and the history, sized for m_extent
+    void createTargets();
+    void destroyTargets();
+    
+    // Reduced-resolution path
+    void createComputePipelines();
+    // Evaluates sampleCount kernel samples sampleStride apart; compiled on first use
+    VkPipeline getComputePipeline(uint32_t sampleCount, uint32_t sampleStride);
+    VkPipeline createFullscreenPipeline(const char* fragShaderPath, VkPipelineLayout layout,
+                                        const VkSpecializationInfo* specialization);
+    void writeComputeDescriptorSet(VkDescriptorSet set, VulkanImage* depth, VulkanImage* normal,
+                                   VulkanImage* input, VulkanImage* output, VulkanImage* history);
+    void recordFullResolution(VkCommandBuffer commandBuffer);
+    void recordReducedResolution(VkCommandBuffer commandBuffer);
+    
+    static constexpr int MAX_KERNEL_SIZE = 64;
     
     VulkanContext& m_context;
+    VulkanFrameAllocator& m_frameAllocator;
     VulkanImage* m_noiseTexture;
-    VulkanBuffer* m_kernelBuffer;
+    uint32_t m_kernelOffset = 0;
+    uint32_t m_kernelSize = MAX_KERNEL_SIZE;
+    
+    VkRenderPass m_renderPass = VK_NULL_HANDLE;
+    VkExtent2D m_extent{};          // G-buffer size
+    VkExtent2D m_renderExtent{};    // Area rendered this frame
+    std::map<uint32_t, VkPipeline> m_pipelines;     // One per kernel size
+    
+    // Reduced-resolution path: AO and blur ping-pong between two RGBA16F storage images
+    // (r = occlusion, g = depth), sized for a downscale of 2 and used partially at 4
+    uint32_t m_downscale = 1;
+    VulkanImage* m_aoImages[2] = {nullptr, nullptr};   // Not owned, see updateDescriptorSets()
+    VkDescriptorSetLayout m_computeSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout m_computePipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet m_aoSet = VK_NULL_HANDLE;        // Writes image 0
+    VkDescriptorSet m_blurXSet = VK_NULL_HANDLE;     // Image 0 -> image 1, also the upsample's input
+    VkDescriptorSet m_blurYSet = VK_NULL_HANDLE;     // Image 1 -> image 0
+    std::map<std::pair<uint32_t, uint32_t>, VkPipeline> m_computePipelines;  // By sample count and stride
+    VkPipeline m_blurPipeline = VK_NULL_HANDLE;
+    VkPipeline m_upsamplePipeline = VK_NULL_HANDLE;
+    
+    // Temporal accumulation: history ping-pongs between two images, one read and one written per frame
+    bool m_temporal = false;
+    bool m_historyValid = false;
+    uint32_t m_historyIndex = 0;        // History image written this frame
+    uint32_t m_temporalFrame = 0;       // Selects the kernel subset
+    glm::vec2 m_previousViewOffset{0.0f};
+    glm::vec2 m_historyOffset{0.0f};    // This frame's reprojection, in low-resolution pixels
+    VulkanImage* m_historyImages[2] = {nullptr, nullptr};
+    VkDescriptorSet m_temporalSets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};   // Image 0 + history -> history[i]
+    VkDescriptorSet m_temporalBlurSets[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE}; // history[i] -> image 1
+    VkPipeline m_temporalPipeline = VK_NULL_HANDLE;
     
     struct SSAOKernel {
         glm::mat4 projection;
-        glm::vec4 samples[64];
+        glm::vec4 samples[MAX_KERNEL_SIZE];
         float radius;
         float bias;
         float power;
         float _padding;
+        glm::vec2 uvScale;      // m_renderExtent / m_extent
+        glm::vec2 renderSize;   // m_renderExtent
     } m_uboData;
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class VulkanContext;
+
+// Sampler state; images with equal descriptions share one VkSampler
+struct SamplerDesc {
+    VkFilter magFilter = VK_FILTER_LINEAR;
+    VkFilter minFilter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;   // U, V and W
+    float maxAnisotropy = 16.0f;        // <= 1 disables anisotropic filtering
+    float minLod = 0.0f;
+    float maxLod = VK_LOD_CLAMP_NONE;   // The image view already limits the mip range
+    float mipLodBias = 0.0f;
+
+    bool operator==(const SamplerDesc& other) const {
+        return magFilter == other.magFilter && minFilter == other.minFilter &&
+               mipmapMode == other.mipmapMode && addressMode == other.addressMode &&
+               maxAnisotropy == other.maxAnisotropy && minLod == other.minLod &&
+               maxLod == other.maxLod && mipLodBias == other.mipLodBias;
+    }
+};
+
+// Creates each distinct sampler once and hands out the same handle afterwards. Drivers
+// cap the number of live samplers (maxSamplerAllocationCount, 4000 on many GPUs), so
+// per-image samplers would run into it long before memory does. Samplers live until
+// cleanup(); images never destroy the handles they get from here.
+class VulkanSamplerCache {
+public:
+    VulkanSamplerCache(VulkanContext& context);
+    ~VulkanSamplerCache();
+
+    void cleanup();
+
+    // Thread-safe. Anisotropy is clamped to the device limit
+    VkSampler get(const SamplerDesc& desc = {});
+
+    size_t getSamplerCount() const;
+
+private:
+    VulkanContext& m_context;
+    mutable std::mutex m_mutex;
+    std::vector<std::pair<SamplerDesc, VkSampler>> m_samplers;   // A handful at most; linear lookup
+};
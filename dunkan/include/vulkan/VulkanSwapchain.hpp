@@ -29,6 +29,12 @@ public:
     
     void createFramebuffers(VkRenderPass renderPass);
     
+    // Applies from the next create()/recreate(); falls back to FIFO, which every surface supports
+    void setPresentMode(VkPresentModeKHR mode) { m_requestedPresentMode = mode; }
+    VkPresentModeKHR getRequestedPresentMode() const { return m_requestedPresentMode; }
+    VkPresentModeKHR getPresentMode() const { return m_presentMode; }   // In use
+    bool supportsPresentMode(VkPresentModeKHR mode) const;
+    
     static SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
     
 private:
@@ -44,4 +50,7 @@ private:
     std::vector<VkFramebuffer> m_framebuffers;
     VkFormat m_imageFormat;
     VkExtent2D m_extent;
+    VkPresentModeKHR m_requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    std::vector<VkPresentModeKHR> m_supportedPresentModes;   // By the surface, as of the last create()
 };
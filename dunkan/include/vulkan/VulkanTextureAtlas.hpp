@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanImage.hpp"
+#include "VulkanMaterial.hpp"
+#include "utils/Atlas.hpp"
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sprite atlas: the albedo, height, normal and material maps of many sprites packed into
+// shared pages, so different sprite kinds share one descriptor set per page and batch into
+// the same draws. Pages are built at runtime from the source PNGs (build) or cooked offline
+// with `texture_cooker --atlas` and read back through their manifest (load).
+class VulkanTextureAtlas {
+public:
+    // CPU side of an atlas; produced on loader threads, consumed by create()
+    struct PageSet {
+        Atlas::Layout layout;
+        std::vector<std::array<VulkanImage::ImageData, MATERIAL_MAP_COUNT>> pages;  // Invalid = no sprite has the map
+        std::string error;
+
+        bool isValid() const { return !pages.empty(); }
+    };
+
+    static constexpr uint32_t DEFAULT_PAGE_SIZE = 2048;
+    static constexpr uint32_t DEFAULT_PADDING = 8;
+
+    // Thread-safe, touch no Vulkan state
+    // materialPaths are base paths ("data/tree" for data/tree_albedo.png, ...); sprites are
+    // named after their albedo map ("tree_albedo") like the textures of loadTexture()
+    static PageSet build(const std::vector<std::string>& materialPaths,
+                         uint32_t pageSize = DEFAULT_PAGE_SIZE, uint32_t padding = DEFAULT_PADDING);
+    // Uses the cooked pages next to the manifest when useCooked is set and they exist,
+    // otherwise recomposes the manifest's layout from the source PNGs
+    static PageSet load(const std::string& manifestPath, bool useCooked);
+
+    VulkanTextureAtlas(VulkanContext& context);
+    ~VulkanTextureAtlas();
+
+    // Creates the page images and queues their uploads; usable once the upload batch completes
+    void create(const PageSet& pageSet);
+    void cleanup();
+
+    const Atlas::Sprite* findSprite(const std::string& name) const;
+    const std::vector<Atlas::Sprite>& getSprites() const { return m_layout.sprites; }
+    uint32_t getPageCount() const { return static_cast<uint32_t>(m_pages.size()); }
+    uint32_t getPageSize() const { return m_layout.pageSize; }
+    // Null where no sprite on the page has that map
+    VulkanImage* getImage(uint32_t page, MaterialMap map) const { return m_pages[page][map]; }
+
+private:
+    VulkanContext& m_context;
+    Atlas::Layout m_layout;
+    std::unordered_map<std::string, size_t> m_spriteIndex;
+    std::vector<std::array<VulkanImage*, MATERIAL_MAP_COUNT>> m_pages;
+};
@@ -76,6 +76,37 @@ struct Vertex {
     }
 };
 
+// Per-sprite data for the G-buffer pass, read from vertex binding 1 once per instance so
+// every sprite sharing a descriptor set goes out in a single draw
+struct SpriteInstance {
+    glm::mat4 model;
+    glm::vec4 uvRect;   // u0, v0, u1, v1 of the sprite in its texture (atlas page or whole image)
+    glm::vec4 params;   // z position, height, roughness, metalness
+    glm::vec4 flags;    // translucency, use height map, use material map, unused
+
+    static VkVertexInputBindingDescription getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(SpriteInstance);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescription;
+    }
+
+    // Locations 4-10, after Vertex's; a mat4 takes one location per column
+    static std::array<VkVertexInputAttributeDescription, 7> getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions{};
+
+        for (uint32_t i = 0; i < 7; i++) {
+            attributeDescriptions[i].binding = 1;
+            attributeDescriptions[i].location = 4 + i;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[i].offset = static_cast<uint32_t>(i * sizeof(glm::vec4));
+        }
+
+        return attributeDescriptions;
+    }
+};
+
 // Matrix 3x3 structure
 struct Mat3x3 {
     float values[9];
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanBuffer.hpp"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class VulkanContext;
+
+// Batches staging copies and layout transitions into a single command buffer per flush.
+// Submissions go to a transfer-only queue when the device has one; completion is tracked
+// with fences and polled, so nothing here blocks unless wait() is called explicitly.
+//
+// When the transfer queue belongs to a different family, resources are released by the
+// transfer queue and must be acquired on the graphics queue: recordAcquireBarriers()
+// emits those barriers for every batch that has completed since the last call.
+class VulkanUploadManager {
+public:
+    VulkanUploadManager(VulkanContext& context);
+    ~VulkanUploadManager();
+
+    void init();
+    void cleanup();
+
+    // Copies data into staging memory and records the upload; the image ends up in
+    // SHADER_READ_ONLY_OPTIMAL once the batch completes (and has been acquired).
+    // mipOffsets holds the byte offset of each prebuilt level in data (empty = level 0 only)
+    void uploadImage(VkImage image, const void* data, VkDeviceSize size,
+                     uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& mipOffsets = {});
+    // Uploads level 0 and fills the remaining levels with linear blits; requires canBlitMips()
+    // and an image created with TRANSFER_SRC usage
+    void uploadImageWithBlitMips(VkImage image, const void* data, VkDeviceSize size,
+                                 uint32_t width, uint32_t height, uint32_t mipLevels);
+    void uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+    // Submits the batch being recorded (no-op if empty); returns its ticket
+    uint64_t flush();
+    // Polls fences, recycling completed batches; call once per frame
+    void update();
+    bool isComplete(uint64_t ticket) const { return ticket <= m_completedTicket; }
+    void wait(uint64_t ticket);
+    void waitIdle();
+
+    // Queue-family ownership acquires for completed uploads; record at the start of
+    // the frame's graphics command buffer, before anything samples them
+    void recordAcquireBarriers(VkCommandBuffer commandBuffer);
+
+    uint64_t getRecordingTicket() const { return m_nextTicket; }
+    bool hasDedicatedTransferQueue() const { return m_transferFamily != m_graphicsFamily; }
+    // Blits need a graphics-capable queue and linear filtering support for the format
+    bool canBlitMips(VkFormat format) const;
+
+private:
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        uint64_t ticket = 0;
+        std::vector<std::unique_ptr<VulkanBuffer>> stagingBuffers;
+        std::vector<VkImageMemoryBarrier> imageAcquires;
+        std::vector<VkBufferMemoryBarrier> bufferAcquires;
+    };
+
+    Batch& getRecordingBatch();
+    VulkanBuffer* createStaging(Batch& batch, const void* data, VkDeviceSize size);
+    void beginImageUpload(Batch& batch, VkImage image, uint32_t mipLevels);
+    // Moves the given levels to SHADER_READ_ONLY_OPTIMAL, releasing them to the graphics queue if needed
+    void finishImageUpload(Batch& batch, VkImage image, uint32_t baseMipLevel, uint32_t mipLevels,
+                           VkImageLayout oldLayout, VkAccessFlags srcAccessMask);
+    void retire(Batch& batch);
+
+    VulkanContext& m_context;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkCommandPool m_commandPool = VK_NULL_HANDLE;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_graphicsFamily = 0;
+
+    std::unique_ptr<Batch> m_recording;
+    std::deque<std::unique_ptr<Batch>> m_inFlight;
+    std::vector<std::unique_ptr<Batch>> m_freeBatches;
+
+    std::vector<VkImageMemoryBarrier> m_pendingImageAcquires;
+    std::vector<VkBufferMemoryBarrier> m_pendingBufferAcquires;
+
+    uint64_t m_nextTicket = 1;
+    uint64_t m_completedTicket = 0;
+};
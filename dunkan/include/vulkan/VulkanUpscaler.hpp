@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "VulkanContext.hpp"
+#include "VulkanDescriptorManager.hpp"
+#include "VulkanImage.hpp"
+#include "VulkanRenderGraph.hpp"
+
+// Spatial upscaling for internal resolutions below the window's. Composition renders the lit scene
+// into the top-left part of a window-sized scene color target (through the final render pass, whose
+// attachment has the swapchain format), easu.comp upscales it to the window size with an
+// edge-adaptive filter, and rcas.frag sharpens the result while writing the swapchain image.
+// Swapchain images can't be storage images in an sRGB format, so sharpening runs as a fragment pass
+// rather than compute, which also lets ImGui draw in the same render pass
+class VulkanUpscaler {
+public:
+    VulkanUpscaler(VulkanContext& context, VulkanDescriptorManager& descriptorManager);
+    ~VulkanUpscaler();
+
+    // outputRenderPass: the final render pass, used for the scene color framebuffer and the
+    // sharpen pass. extent: window size
+    void init(VkRenderPass outputRenderPass, VkFormat colorFormat, VkExtent2D extent);
+    // New window size for the image descriptions; the GPU must be done with the old images.
+    // setTargets() again once the graph placed the new ones
+    void resize(VkExtent2D extent);
+    void cleanup();
+
+    // Render graph transients: the composed scene and the upscaled image, only alive from
+    // composition to the sharpen pass
+    VulkanRenderGraph::ImageDesc getSceneColorDesc() const;
+    VulkanRenderGraph::ImageDesc getUpscaledDesc() const;
+    // Takes the graph's images: creates the scene framebuffer and writes the descriptor set
+    // (allocated on the first call)
+    void setTargets(VulkanImage* sceneColor, VulkanImage* upscaled);
+
+    VkFramebuffer getSceneFramebuffer() const { return m_sceneFramebuffer; }
+
+    // EASU from the renderExtent part of the scene color to the whole upscaled image (compute,
+    // outside a render pass)
+    void upscale(VkCommandBuffer commandBuffer, VkExtent2D renderExtent);
+    // RCAS into the bound output render pass; sharpness in [0, 1]
+    void sharpen(VkCommandBuffer commandBuffer, float sharpness);
+
+private:
+    void createPipelines();
+    void destroyFramebuffer();
+
+    VulkanContext& m_context;
+    VulkanDescriptorManager& m_descriptorManager;
+    VkRenderPass m_outputRenderPass = VK_NULL_HANDLE;
+    VkFormat m_colorFormat = VK_FORMAT_UNDEFINED;
+    VkExtent2D m_extent{};
+    VkExtent2D m_renderExtent{};    // Input area of the last upscale()
+
+    VkFramebuffer m_sceneFramebuffer = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;   // Shared by both stages
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+    VkPipeline m_easuPipeline = VK_NULL_HANDLE;
+    VkPipeline m_rcasPipeline = VK_NULL_HANDLE;
+};
@@ -0,0 +1,256 @@
+#include "utils/CpuProfiler.hpp"
+
+#if DUNKAN_CPU_PROFILING
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace {
+
+std::string g_lastPath;
+uint64_t g_lastEvents = 0;
+uint64_t g_lastDropped = 0;
+
+#if DUNKAN_CPU_PROFILING
+
+struct Event {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// Written only by its thread; the capture reads it from the main thread. Rings are never freed,
+// so events of threads that have exited can still be written out
+struct ThreadRing {
+    std::array<Event, CpuProfiler::RING_SIZE> events;
+    std::atomic<uint64_t> written{0};               // Events ever recorded, the next one's index
+    std::atomic<const char*> name{nullptr};
+    uint32_t id = 0;
+    uint64_t captureFirst = 0;                      // written when the capture started (main thread)
+};
+
+std::mutex g_ringsMutex;
+std::vector<std::unique_ptr<ThreadRing>> g_rings;
+thread_local ThreadRing* t_ring = nullptr;
+
+std::atomic<bool> g_recording{false};
+
+// Capture state, main thread only
+uint32_t g_requestedFrames = 0;
+std::string g_requestedPath;
+uint32_t g_framesLeft = 0;
+std::string g_capturePath;
+uint64_t g_captureBegin = 0;
+
+ThreadRing& threadRing() {
+    if (t_ring == nullptr) {
+        auto ring = std::make_unique<ThreadRing>();
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        ring->id = static_cast<uint32_t>(g_rings.size()) + 1;
+        t_ring = ring.get();
+        g_rings.push_back(std::move(ring));
+    }
+    return *t_ring;
+}
+
+// Names are literals or __func__; escape anyway so the file stays valid JSON
+void writeString(std::ofstream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\' << *c;
+        } else if (static_cast<unsigned char>(*c) >= 0x20) {
+            out << *c;
+        }
+    }
+    out << '"';
+}
+
+void writeMicroseconds(std::ofstream& out, uint64_t nanoseconds) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", static_cast<double>(nanoseconds) / 1000.0);
+    out << buffer;
+}
+
+// Copies the ring's events of the capture. A thread may still finish a scope it began during the
+// capture and overwrite the oldest slot while it is copied, so the count is read again afterwards
+// and events the writer could have reached are dropped
+void collectEvents(ThreadRing& ring, std::vector<Event>& events, uint64_t& dropped) {
+    uint64_t end = ring.written.load(std::memory_order_acquire);
+    uint64_t oldest = end > CpuProfiler::RING_SIZE ? end - CpuProfiler::RING_SIZE : 0;
+    uint64_t first = std::max(ring.captureFirst, oldest);
+
+    events.clear();
+    for (uint64_t i = first; i < end; i++) {
+        events.push_back(ring.events[i % CpuProfiler::RING_SIZE]);
+    }
+
+    uint64_t endAfter = ring.written.load(std::memory_order_acquire);
+    uint64_t overwritten = endAfter > CpuProfiler::RING_SIZE ? endAfter - CpuProfiler::RING_SIZE : 0;
+    if (overwritten > first) {
+        uint64_t lost = std::min<uint64_t>(overwritten - first, events.size());
+        events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(lost));
+        first += lost;
+    }
+    dropped += first - ring.captureFirst;
+}
+
+void writeCapture() {
+    g_lastPath.clear();
+    g_lastEvents = 0;
+    g_lastDropped = 0;
+
+    std::ofstream out(g_capturePath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open CPU capture file: " << g_capturePath << std::endl;
+        return;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool firstEvent = true;
+    auto separator = [&] {
+        if (!firstEvent) {
+            out << ",\n";
+        }
+        firstEvent = false;
+    };
+
+    std::vector<Event> events;
+    events.reserve(CpuProfiler::RING_SIZE);
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    for (auto& ring : g_rings) {
+        collectEvents(*ring, events, g_lastDropped);
+
+        const char* name = ring->name.load(std::memory_order_relaxed);
+        separator();
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->id << ",\"args\":{\"name\":";
+        if (name != nullptr) {
+            writeString(out, name);
+        } else {
+            out << "\"thread " << ring->id << '"';
+        }
+        out << "}}";
+
+        for (const Event& event : events) {
+            // Scopes that began before the capture weren't timed; later ones belong to no capture
+            if (event.begin < g_captureBegin) {
+                continue;
+            }
+            separator();
+            out << "{\"name\":";
+            writeString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->id << ",\"ts\":";
+            writeMicroseconds(out, event.begin - g_captureBegin);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end - event.begin);
+            out << '}';
+            g_lastEvents++;
+        }
+    }
+    out << "\n]}\n";
+
+    if (out.good()) {
+        g_lastPath = g_capturePath;
+        std::cout << "CPU capture written: " << g_capturePath << " (" << g_lastEvents << " events)" << std::endl;
+    }
+}
+
+#endif
+
+} // namespace
+
+#if DUNKAN_CPU_PROFILING
+
+bool CpuProfiler::isRecording() {
+    return g_recording.load(std::memory_order_relaxed);
+}
+
+uint64_t CpuProfiler::now() {
+    auto time = std::chrono::steady_clock::now().time_since_epoch();
+    uint64_t nanoseconds = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count());
+    return nanoseconds != 0 ? nanoseconds : 1;
+}
+
+void CpuProfiler::record(const char* name, uint64_t begin, uint64_t end) {
+    ThreadRing& ring = threadRing();
+    uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.events[index % RING_SIZE] = {name, begin, end};
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const char* name) {
+    threadRing().name.store(name, std::memory_order_relaxed);
+}
+
+bool CpuProfiler::requestCapture(uint32_t frameCount, const std::string& path) {
+    if (frameCount == 0 || isCapturing()) {
+        return false;
+    }
+    g_requestedFrames = frameCount;
+    g_requestedPath = path;
+    return true;
+}
+
+void CpuProfiler::frameBoundary() {
+    if (g_framesLeft > 0 && --g_framesLeft == 0) {
+        g_recording.store(false, std::memory_order_relaxed);
+        writeCapture();
+    }
+
+    if (g_requestedFrames > 0) {
+        {
+            std::lock_guard<std::mutex> lock(g_ringsMutex);
+            for (auto& ring : g_rings) {
+                ring->captureFirst = ring->written.load(std::memory_order_acquire);
+            }
+        }
+        g_framesLeft = g_requestedFrames;
+        g_capturePath = g_requestedPath;
+        g_requestedFrames = 0;
+        g_captureBegin = now();
+        g_recording.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool CpuProfiler::isCapturing() {
+    return g_framesLeft > 0 || g_requestedFrames > 0;
+}
+
+#else
+
+void CpuProfiler::setThreadName(const char*) {
+}
+
+bool CpuProfiler::requestCapture(uint32_t, const std::string&) {
+    return false;
+}
+
+void CpuProfiler::frameBoundary() {
+}
+
+bool CpuProfiler::isCapturing() {
+    return false;
+}
+
+#endif
+
+const std::string& CpuProfiler::getLastCapturePath() {
+    return g_lastPath;
+}
+
+uint64_t CpuProfiler::getLastCaptureEvents() {
+    return g_lastEvents;
+}
+
+uint64_t CpuProfiler::getLastCaptureDropped() {
+    return g_lastDropped;
+}
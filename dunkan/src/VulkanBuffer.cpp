@@ -9,7 +9,8 @@ VulkanBuffer::~VulkanBuffer() {
     cleanup();
 }
 
-void VulkanBuffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+void VulkanBuffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                          AllocationStrategy strategy) {
     m_size = size;
     
     VkBufferCreateInfo bufferInfo{};
@@ -22,19 +23,7 @@ void VulkanBuffer::create(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryP
         throw std::runtime_error("failed to create buffer!");
     }
     
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_context.getDevice(), m_buffer, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = m_context.findMemoryType(memRequirements.memoryTypeBits, properties);
-    
-    if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
-    
-    vkBindBufferMemory(m_context.getDevice(), m_buffer, m_memory, 0);
+    m_allocation = m_context.getAllocator().allocateBuffer(m_buffer, properties, strategy);
 }
 
 void VulkanBuffer::cleanup() {
@@ -42,16 +31,15 @@ void VulkanBuffer::cleanup() {
         vkDestroyBuffer(m_context.getDevice(), m_buffer, nullptr);
         m_buffer = VK_NULL_HANDLE;
     }
-    if (m_memory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_context.getDevice(), m_memory, nullptr);
-        m_memory = VK_NULL_HANDLE;
+    if (m_allocation.isValid()) {
+        m_context.getAllocator().free(m_allocation);
     }
 }
 
 void VulkanBuffer::copyFrom(const void* data, VkDeviceSize size) {
+    // Memory is persistently mapped and HOST_COHERENT, no flush needed
     void* mappedData = map();
     memcpy(mappedData, data, static_cast<size_t>(size));
-    unmap();
 }
 
 void VulkanBuffer::copyTo(VulkanBuffer& dst, VkDeviceSize size) {
@@ -65,11 +53,12 @@ void VulkanBuffer::copyTo(VulkanBuffer& dst, VkDeviceSize size) {
 }
 
 void* VulkanBuffer::map() {
-    void* data;
-    vkMapMemory(m_context.getDevice(), m_memory, 0, m_size, 0, &data);
-    return data;
+    if (m_allocation.mapped == nullptr) {
+        throw std::runtime_error("failed to map buffer memory!");
+    }
+    return m_allocation.mapped;
 }
 
 void VulkanBuffer::unmap() {
-    vkUnmapMemory(m_context.getDevice(), m_memory);
+    // The allocator owns the mapping of the whole memory block
 }
@@ -1,4 +1,8 @@
 #include "vulkan/VulkanContext.hpp"
+#include "vulkan/VulkanMemoryAllocator.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "vulkan/VulkanSamplerCache.hpp"
+#include "vulkan/VulkanUploadManager.hpp"
 #include <stdexcept>
 #include <set>
 #include <iostream>
@@ -23,15 +27,36 @@ VulkanContext::~VulkanContext() {
 }
 
 void VulkanContext::init(GLFWwindow* window) {
+    m_headless = window == nullptr;
     createInstance();
     setupDebugMessenger();
-    createSurface(window);
+    if (!m_headless) {
+        createSurface(window);
+    }
     pickPhysicalDevice();
     createLogicalDevice();
     createCommandPool();
+    
+    m_allocator = std::make_unique<VulkanMemoryAllocator>(*this);
+    m_allocator->init();
+    
+    m_uploadManager = std::make_unique<VulkanUploadManager>(*this);
+    m_uploadManager->init();
+    
+    m_samplerCache = std::make_unique<VulkanSamplerCache>(*this);
+    
+    m_pipelineCache = std::make_unique<VulkanPipelineCache>(*this);
+    m_pipelineCache->init("pipeline_cache.bin");
 }
 
 void VulkanContext::cleanup() {
+    // Pending uploads still own staging memory, so they go first.
+    // All other buffers and images must be destroyed by now.
+    m_uploadManager.reset();
+    m_allocator.reset();
+    m_samplerCache.reset();
+    m_pipelineCache.reset();   // Saved to disk on the way out
+    
     if (m_commandPool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(m_device, m_commandPool, nullptr);
         m_commandPool = VK_NULL_HANDLE;
@@ -144,6 +169,9 @@ void VulkanContext::pickPhysicalDevice() {
     if (m_physicalDevice == VK_NULL_HANDLE) {
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+    
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &m_deviceProperties);
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &m_deviceFeatures);
 }
 
 void VulkanContext::createLogicalDevice() {
@@ -152,7 +180,8 @@ void VulkanContext::createLogicalDevice() {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {
         m_queueFamilies.graphicsFamily.value(),
-        m_queueFamilies.presentFamily.value()
+        m_queueFamilies.presentFamily.value(),
+        m_queueFamilies.transferFamily.value_or(m_queueFamilies.graphicsFamily.value())
     };
     
     float queuePriority = 1.0f;
@@ -168,14 +197,17 @@ void VulkanContext::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
     deviceFeatures.sampleRateShading = VK_TRUE;
+    deviceFeatures.textureCompressionBC = m_deviceFeatures.textureCompressionBC;
+    deviceFeatures.pipelineStatisticsQuery = m_deviceFeatures.pipelineStatisticsQuery;
     
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    std::vector<const char*> deviceExtensions = getDeviceExtensions();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
     
     if (m_enableValidationLayers) {
         createInfo.enabledLayerCount = static_cast<uint32_t>(m_validationLayers.size());
@@ -190,6 +222,13 @@ void VulkanContext::createLogicalDevice() {
     
     vkGetDeviceQueue(m_device, m_queueFamilies.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, m_queueFamilies.presentFamily.value(), 0, &m_presentQueue);
+    
+    // Without a dedicated family, uploads share the graphics queue
+    if (m_queueFamilies.transferFamily.has_value()) {
+        vkGetDeviceQueue(m_device, m_queueFamilies.transferFamily.value(), 0, &m_transferQueue);
+    } else {
+        m_transferQueue = m_graphicsQueue;
+    }
 }
 
 void VulkanContext::createCommandPool() {
@@ -229,11 +268,13 @@ bool VulkanContext::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> VulkanContext::getRequiredExtensions() {
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    // Headless: GLFW may not even be initialized (no display), and nothing needs a surface
+    std::vector<const char*> extensions;
+    if (!m_headless) {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
     
     if (m_enableValidationLayers) {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -242,6 +283,10 @@ std::vector<const char*> VulkanContext::getRequiredExtensions() {
     return extensions;
 }
 
+std::vector<const char*> VulkanContext::getDeviceExtensions() const {
+    return m_headless ? std::vector<const char*>{} : m_swapchainExtensions;
+}
+
 bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
     QueueFamilyIndices indices = findQueueFamilies(device);
     
@@ -251,7 +296,8 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
     
-    std::set<std::string> requiredExtensions(m_deviceExtensions.begin(), m_deviceExtensions.end());
+    std::vector<const char*> deviceExtensions = getDeviceExtensions();
+    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
     for (const auto& extension : availableExtensions) {
         requiredExtensions.erase(extension.extensionName);
     }
@@ -272,14 +318,37 @@ QueueFamilyIndices VulkanContext::findQueueFamilies(VkPhysicalDevice device) {
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
     
+    // Prefer a pure DMA family (transfer without graphics/compute), then any non-graphics one
+    for (uint32_t f = 0; f < queueFamilyCount; f++) {
+        VkQueueFlags flags = queueFamilies[f].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            indices.transferFamily = f;
+            break;
+        }
+    }
+    if (!indices.transferFamily.has_value()) {
+        for (uint32_t f = 0; f < queueFamilyCount; f++) {
+            VkQueueFlags flags = queueFamilies[f].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                indices.transferFamily = f;
+                break;
+            }
+        }
+    }
+    
     int i = 0;
     for (const auto& queueFamily : queueFamilies) {
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
             indices.graphicsFamily = i;
         }
         
+        // Headless frames are never presented; "present" is the graphics queue
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+        if (m_headless) {
+            presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        } else {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+        }
         if (presentSupport) {
             indices.presentFamily = i;
         }
@@ -340,6 +409,18 @@ uint32_t VulkanContext::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlag
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool VulkanContext::hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
+    
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return true;
+        }
+    }
+    return false;
+}
+
 VkFormat VulkanContext::findDepthFormat() {
     return findSupportedFormat(
         {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
@@ -11,11 +11,19 @@ VulkanDescriptorManager::~VulkanDescriptorManager() {
 }
 
 void VulkanDescriptorManager::createDescriptorPool(uint32_t maxSets) {
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    std::array<VkDescriptorPoolSize, 6> poolSizes{};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     poolSizes[0].descriptorCount = maxSets;
     poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     poolSizes[1].descriptorCount = maxSets * 4; // Allow multiple textures per set
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = maxSets;
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[3].descriptorCount = maxSets;
+    poolSizes[4].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[4].descriptorCount = maxSets;
+    poolSizes[5].type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    poolSizes[5].descriptorCount = maxSets;
     
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -63,6 +71,25 @@ void VulkanDescriptorManager::updateTextureDescriptor(VkDescriptorSet descriptor
     vkUpdateDescriptorSets(m_context.getDevice(), 1, &descriptorWrite, 0, nullptr);
 }
 
+void VulkanDescriptorManager::updateInputAttachmentDescriptor(VkDescriptorSet descriptorSet, uint32_t binding,
+                                                               VkImageView imageView) {
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfo.imageView = imageView;
+    imageInfo.sampler = VK_NULL_HANDLE;
+    
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+    
+    vkUpdateDescriptorSets(m_context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
 void VulkanDescriptorManager::updateUniformBuffer(VkDescriptorSet descriptorSet, uint32_t binding,
                                                    VkBuffer buffer, VkDeviceSize size) {
     VkDescriptorBufferInfo bufferInfo{};
@@ -82,6 +109,26 @@ void VulkanDescriptorManager::updateUniformBuffer(VkDescriptorSet descriptorSet,
     vkUpdateDescriptorSets(m_context.getDevice(), 1, &descriptorWrite, 0, nullptr);
 }
 
+void VulkanDescriptorManager::updateDynamicUniformBuffer(VkDescriptorSet descriptorSet, uint32_t binding,
+                                                          VkBuffer buffer, VkDeviceSize range) {
+    // Offset is supplied per bind through vkCmdBindDescriptorSets
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = range;
+    
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    
+    vkUpdateDescriptorSets(m_context.getDevice(), 1, &descriptorWrite, 0, nullptr);
+}
+
 void VulkanDescriptorManager::cleanup() {
     if (m_descriptorPool != VK_NULL_HANDLE) {
         vkDestroyDescriptorPool(m_context.getDevice(), m_descriptorPool, nullptr);
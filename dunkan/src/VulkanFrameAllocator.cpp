@@ -0,0 +1,77 @@
+#include "vulkan/VulkanFrameAllocator.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+VulkanFrameAllocator::VulkanFrameAllocator(VulkanContext& context)
+    : m_context(context), m_buffer(context) {
+}
+
+VulkanFrameAllocator::~VulkanFrameAllocator() {
+    cleanup();
+}
+
+void VulkanFrameAllocator::create(VkDeviceSize frameSize, uint32_t frameCount) {
+    const VkPhysicalDeviceLimits& limits = m_context.getDeviceProperties().limits;
+
+    // Every allocation must be usable as a dynamic UBO/SSBO offset
+    m_minAlignment = std::max<VkDeviceSize>({
+        16,
+        limits.minUniformBufferOffsetAlignment,
+        limits.minStorageBufferOffsetAlignment
+    });
+
+    m_frameSize = alignUp(frameSize, m_minAlignment);
+    m_frameCount = frameCount;
+
+    m_buffer.create(m_frameSize * m_frameCount,
+                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // Mapped once for the lifetime of the buffer
+    m_mapped = static_cast<uint8_t*>(m_buffer.map());
+
+    beginFrame(0);
+}
+
+void VulkanFrameAllocator::cleanup() {
+    m_buffer.cleanup();
+    m_mapped = nullptr;
+    m_frameSize = 0;
+    m_frameCount = 0;
+    m_frameBase = 0;
+    m_head = 0;
+}
+
+void VulkanFrameAllocator::beginFrame(uint32_t frameIndex) {
+    m_frameBase = m_frameSize * (frameIndex % m_frameCount);
+    m_head = m_frameBase;
+}
+
+VulkanFrameAllocator::Allocation VulkanFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+    VkDeviceSize offset = alignUp(m_head, std::max(alignment, m_minAlignment));
+
+    if (offset + size > m_frameBase + m_frameSize) {
+        throw std::runtime_error("frame allocator out of memory!");
+    }
+
+    m_head = offset + size;
+
+    Allocation allocation;
+    allocation.buffer = m_buffer.getBuffer();
+    allocation.offset = offset;
+    allocation.data = m_mapped + offset;
+    return allocation;
+}
+
+uint32_t VulkanFrameAllocator::push(const void* data, VkDeviceSize size) {
+    Allocation allocation = allocate(size);
+    memcpy(allocation.data, data, static_cast<size_t>(size));
+    return static_cast<uint32_t>(allocation.offset);
+}
@@ -1,42 +1,68 @@
 #include "vulkan/VulkanGBuffer.hpp"
 #include <stdexcept>
+#include <initializer_list>
 
-void GBuffer::create(VulkanContext& context, uint32_t w, uint32_t h) {
+GBufferFormats getGBufferFormats(GBufferLayout layout) {
+    // All of these are mandatory color attachment formats
+    if (layout == GBufferLayout::Compact) {
+        return {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM};
+    }
+    return {VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32_SFLOAT, VK_FORMAT_R8G8B8A8_UNORM};
+}
+
+void GBuffer::create(VulkanContext& context, uint32_t w, uint32_t h, GBufferLayout gbufferLayout, bool transientTargets,
+                     VulkanImage* depthStencil) {
     width = w;
     height = h;
+    layout = gbufferLayout;
+    transient = transientTargets;
+    GBufferFormats formats = getGBufferFormats(layout);
     
-    // Create Color RT (RGBA8 SRGB)
+    // Sampled by later passes, or only read as input attachments inside the merged render pass
+    VkImageUsageFlags usage = transient
+        ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+        : VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    
+    // Create Color RT
     colorRT = new VulkanImage(context);
-    colorRT->createRenderTarget(width, height, VK_FORMAT_R8G8B8A8_SRGB,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    colorRT->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-    colorRT->createSampler();
+    colorRT->createRenderTarget(width, height, formats.color, usage);
+    colorRT->createImageView(formats.color, VK_IMAGE_ASPECT_COLOR_BIT);
     
-    // Create Normal RT (RGBA16F for precision)
+    // Create Normal RT
     normalRT = new VulkanImage(context);
-    normalRT->createRenderTarget(width, height, VK_FORMAT_R16G16B16A16_SFLOAT,
-                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    normalRT->createImageView(VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    normalRT->createSampler();
+    normalRT->createRenderTarget(width, height, formats.normal, usage);
+    normalRT->createImageView(formats.normal, VK_IMAGE_ASPECT_COLOR_BIT);
     
-    // Create Depth RT (R32F for encoded height)
+    // Create Depth RT (linear depth, read back by lighting, SSAO and light culling)
     depthRT = new VulkanImage(context);
-    depthRT->createRenderTarget(width, height, VK_FORMAT_R32_SFLOAT,
-                                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    depthRT->createImageView(VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
-    depthRT->createSampler();
+    depthRT->createRenderTarget(width, height, formats.depth, usage);
+    depthRT->createImageView(formats.depth, VK_IMAGE_ASPECT_COLOR_BIT);
     
-    // Create Material RT (RGBA8)
+    // Create Material RT
     materialRT = new VulkanImage(context);
-    materialRT->createRenderTarget(width, height, VK_FORMAT_R8G8B8A8_UNORM,
-                                   VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-    materialRT->createImageView(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-    materialRT->createSampler();
+    materialRT->createRenderTarget(width, height, formats.material, usage);
+    materialRT->createImageView(formats.material, VK_IMAGE_ASPECT_COLOR_BIT);
+    
+    if (!transient) {
+        // Descriptors reference the targets from the start, even on frames that skip this G-buffer
+        for (VulkanImage* target : {colorRT, normalRT, depthRT, materialRT}) {
+            target->createSampler();
+            target->transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+    }
     
     // Create Depth/Stencil Image (Actual Depth Buffer)
+    ownsDepthStencil = depthStencil == nullptr;
+    if (!ownsDepthStencil) {
+        depthStencilImage = depthStencil;
+        return;
+    }
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (transient) {
+        depthUsage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
     depthStencilImage = new VulkanImage(context);
-    depthStencilImage->createRenderTarget(width, height, context.findDepthFormat(),
-                                          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    depthStencilImage->createRenderTarget(width, height, context.findDepthFormat(), depthUsage);
     depthStencilImage->createImageView(context.findDepthFormat(), VK_IMAGE_ASPECT_DEPTH_BIT);
 }
 
@@ -50,12 +76,14 @@ void GBuffer::cleanup(VulkanContext& context) {
     delete normalRT;
     delete depthRT;
     delete materialRT;
-    delete depthStencilImage;
+    if (ownsDepthStencil) {
+        delete depthStencilImage;
+    }
     
     colorRT = normalRT = depthRT = materialRT = depthStencilImage = nullptr;
 }
 
-void GBuffer::recreate(VulkanContext& context, uint32_t w, uint32_t h) {
+void GBuffer::recreate(VulkanContext& context, uint32_t w, uint32_t h, VulkanImage* depthStencil) {
     cleanup(context);
-    create(context, w, h);
+    create(context, w, h, layout, transient, depthStencil);
 }
@@ -0,0 +1,180 @@
+#include "vulkan/VulkanGpuProfiler.hpp"
+#include <stdexcept>
+
+namespace {
+
+// Frame begin and end, then a begin/end pair per scope
+constexpr uint32_t TIMESTAMPS_PER_SLOT = 2 + 2 * VulkanGpuProfiler::MAX_SCOPES;
+
+// Results come in bit order: clipping primitives, fragment invocations, compute invocations
+constexpr VkQueryPipelineStatisticFlags STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+constexpr uint32_t STATISTICS_COUNT = 3;
+
+} // namespace
+
+VulkanGpuProfiler::VulkanGpuProfiler(VulkanContext& context) : m_context(context) {
+}
+
+VulkanGpuProfiler::~VulkanGpuProfiler() {
+    cleanup();
+}
+
+void VulkanGpuProfiler::init(uint32_t frameCount) {
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_context.getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_context.getPhysicalDevice(), &familyCount, families.data());
+
+    uint32_t validBits = families[m_context.getQueueFamilies().graphicsFamily.value()].timestampValidBits;
+    m_timestampPeriod = m_context.getDeviceProperties().limits.timestampPeriod;
+    if (validBits == 0 || m_timestampPeriod <= 0.0f) {
+        return;
+    }
+    m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * TIMESTAMPS_PER_SLOT;
+
+    if (vkCreateQueryPool(m_context.getDevice(), &poolInfo, nullptr, &m_timestampPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+
+    if (m_context.supportsPipelineStatistics()) {
+        VkQueryPoolCreateInfo statisticsInfo{};
+        statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        statisticsInfo.queryCount = frameCount * MAX_SCOPES;
+        statisticsInfo.pipelineStatistics = STATISTICS;
+
+        if (vkCreateQueryPool(m_context.getDevice(), &statisticsInfo, nullptr, &m_statisticsPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+    }
+
+    m_slots.assign(frameCount, FrameSlot{});
+    m_timestampScratch.resize(TIMESTAMPS_PER_SLOT);
+    m_statisticsScratch.resize(STATISTICS_COUNT);
+}
+
+void VulkanGpuProfiler::cleanup() {
+    if (m_timestampPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_context.getDevice(), m_timestampPool, nullptr);
+        m_timestampPool = VK_NULL_HANDLE;
+    }
+    if (m_statisticsPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_context.getDevice(), m_statisticsPool, nullptr);
+        m_statisticsPool = VK_NULL_HANDLE;
+    }
+    m_slots.clear();
+}
+
+uint32_t VulkanGpuProfiler::timestampQuery(uint32_t scope, uint32_t end) const {
+    return m_frameIndex * TIMESTAMPS_PER_SLOT + 2 + scope * 2 + end;
+}
+
+bool VulkanGpuProfiler::readResults(uint32_t frameIndex) {
+    if (!isSupported() || !m_slots[frameIndex].pending) {
+        return false;
+    }
+    FrameSlot& slot = m_slots[frameIndex];
+    slot.pending = false;
+
+    // The fence covers the submission, so every query written is available; only those are read
+    uint32_t scopeCount = static_cast<uint32_t>(slot.scopeNames.size());
+    uint32_t timestampCount = 2 + scopeCount * 2;
+    if (vkGetQueryPoolResults(m_context.getDevice(), m_timestampPool, frameIndex * TIMESTAMPS_PER_SLOT,
+                              timestampCount, timestampCount * sizeof(uint64_t), m_timestampScratch.data(),
+                              sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+        return false;
+    }
+
+    auto elapsed = [this](uint64_t begin, uint64_t end) {
+        uint64_t ticks = ((end & m_timestampMask) - (begin & m_timestampMask)) & m_timestampMask;
+        return float(double(ticks) * m_timestampPeriod * 1e-6);
+    };
+
+    m_lastFrame.milliseconds = elapsed(m_timestampScratch[0], m_timestampScratch[1]);
+    m_lastFrame.scopes.resize(scopeCount);
+    for (uint32_t i = 0; i < scopeCount; i++) {
+        ScopeResult& result = m_lastFrame.scopes[i];
+        result.name = slot.scopeNames[i];
+        result.milliseconds = elapsed(m_timestampScratch[2 + i * 2], m_timestampScratch[3 + i * 2]);
+        result.hasStatistics = false;
+
+        if (slot.scopeStatistics[i] &&
+            vkGetQueryPoolResults(m_context.getDevice(), m_statisticsPool, frameIndex * MAX_SCOPES + i, 1,
+                                  STATISTICS_COUNT * sizeof(uint64_t), m_statisticsScratch.data(),
+                                  STATISTICS_COUNT * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            result.hasStatistics = true;
+            result.clippingPrimitives = m_statisticsScratch[0];
+            result.fragmentInvocations = m_statisticsScratch[1];
+            result.computeInvocations = m_statisticsScratch[2];
+        }
+    }
+    return true;
+}
+
+void VulkanGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (!isSupported()) {
+        return;
+    }
+    m_frameIndex = frameIndex;
+    FrameSlot& slot = m_slots[frameIndex];
+    slot.scopeNames.clear();
+    slot.scopeStatistics.clear();
+    slot.statistics = m_statisticsRequested && supportsStatistics();
+
+    vkCmdResetQueryPool(commandBuffer, m_timestampPool, frameIndex * TIMESTAMPS_PER_SLOT, TIMESTAMPS_PER_SLOT);
+    if (slot.statistics) {
+        vkCmdResetQueryPool(commandBuffer, m_statisticsPool, frameIndex * MAX_SCOPES, MAX_SCOPES);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestampPool,
+                        frameIndex * TIMESTAMPS_PER_SLOT);
+}
+
+void VulkanGpuProfiler::endFrame(VkCommandBuffer commandBuffer) {
+    if (!isSupported()) {
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool,
+                        m_frameIndex * TIMESTAMPS_PER_SLOT + 1);
+    m_slots[m_frameIndex].pending = true;
+}
+
+uint32_t VulkanGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name, bool statistics) {
+    if (!isSupported()) {
+        return UINT32_MAX;
+    }
+    FrameSlot& slot = m_slots[m_frameIndex];
+    if (slot.scopeNames.size() >= MAX_SCOPES) {
+        return UINT32_MAX;
+    }
+    uint32_t scope = static_cast<uint32_t>(slot.scopeNames.size());
+    slot.scopeNames.push_back(name);
+    slot.scopeStatistics.push_back(statistics && slot.statistics);
+
+    // Bottom of pipe: written once the work before the scope is done, so work overlapping the
+    // boundary counts towards the scope that finishes it rather than both
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool,
+                        timestampQuery(scope, 0));
+    if (slot.scopeStatistics[scope]) {
+        vkCmdBeginQuery(commandBuffer, m_statisticsPool, m_frameIndex * MAX_SCOPES + scope, 0);
+    }
+    return scope;
+}
+
+void VulkanGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (scope == UINT32_MAX) {
+        return;
+    }
+    if (m_slots[m_frameIndex].scopeStatistics[scope]) {
+        vkCmdEndQuery(commandBuffer, m_statisticsPool, m_frameIndex * MAX_SCOPES + scope);
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool,
+                        timestampQuery(scope, 1));
+}
@@ -1,5 +1,11 @@
 #include "vulkan/VulkanImage.hpp"
 #include "vulkan/VulkanBuffer.hpp"
+#include "vulkan/VulkanUploadManager.hpp"
+#include "utils/Ktx2.hpp"
+#include "utils/CpuProfiler.hpp"
+#include "utils/MipChain.hpp"
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -14,9 +20,10 @@ VulkanImage::~VulkanImage() {
 
 void VulkanImage::createImage(uint32_t width, uint32_t height, VkFormat format,
                                VkImageTiling tiling, VkImageUsageFlags usage,
-                               VkMemoryPropertyFlags properties) {
+                               VkMemoryPropertyFlags properties, uint32_t mipLevels) {
     m_width = width;
     m_height = height;
+    m_mipLevels = mipLevels;
     
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -24,7 +31,7 @@ void VulkanImage::createImage(uint32_t width, uint32_t height, VkFormat format,
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -37,24 +44,32 @@ void VulkanImage::createImage(uint32_t width, uint32_t height, VkFormat format,
         throw std::runtime_error("failed to create image!");
     }
     
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_context.getDevice(), m_image, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = m_context.findMemoryType(memRequirements.memoryTypeBits, properties);
+    m_allocation = m_context.getAllocator().allocateImage(m_image, properties);
+}
+
+void VulkanImage::createRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage) {
+    createUnboundRenderTarget(width, height, format, usage);
     
-    if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
+    // Transient attachments never leave the render pass; on tile-based GPUs lazily allocated
+    // memory lets them stay in tile memory without ever being backed
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) {
+        VkMemoryPropertyFlags lazy = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        if (m_context.hasMemoryType(getMemoryRequirements().memoryTypeBits, lazy)) {
+            properties = lazy;
+        }
     }
     
-    vkBindImageMemory(m_context.getDevice(), m_image, m_memory, 0);
+    // Render targets are large and long-lived, give them their own memory
+    m_allocation = m_context.getAllocator().allocateImage(m_image, properties, true);
+    
+    // Transition to appropriate layout if needed, but usually done by render pass
 }
 
-void VulkanImage::createRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage) {
+void VulkanImage::createUnboundRenderTarget(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage) {
     m_width = width;
     m_height = height;
+    m_mipLevels = 1;
     
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -74,22 +89,19 @@ void VulkanImage::createRenderTarget(uint32_t width, uint32_t height, VkFormat f
     if (vkCreateImage(m_context.getDevice(), &imageInfo, nullptr, &m_image) != VK_SUCCESS) {
         throw std::runtime_error("failed to create render target image!");
     }
-    
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_context.getDevice(), m_image, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = m_context.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    
-    if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate render target memory!");
+}
+
+void VulkanImage::bindMemory(VkDeviceMemory memory, VkDeviceSize offset) {
+    // The memory stays owned by the caller
+    if (vkBindImageMemory(m_context.getDevice(), m_image, memory, offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory!");
     }
-    
-    vkBindImageMemory(m_context.getDevice(), m_image, m_memory, 0);
-    
-    // Transition to appropriate layout if needed, but usually done by render pass
+}
+
+VkMemoryRequirements VulkanImage::getMemoryRequirements() const {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_context.getDevice(), m_image, &requirements);
+    return requirements;
 }
 
 void VulkanImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlags) {
@@ -100,7 +112,7 @@ void VulkanImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlag
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = m_mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
     
@@ -109,24 +121,50 @@ void VulkanImage::createImageView(VkFormat format, VkImageAspectFlags aspectFlag
     }
 }
 
-void VulkanImage::createSampler() {
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 16.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    
-    if (vkCreateSampler(m_context.getDevice(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create texture sampler!");
+void VulkanImage::createSampler(const SamplerDesc& desc) {
+    m_sampler = m_context.getSamplerCache().get(desc);
+}
+
+void VulkanImage::getLayoutUsage(VkImageLayout layout, VkPipelineStageFlags& stages, VkAccessFlags& access) {
+    switch (layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED:
+        stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        access = 0;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access = VK_ACCESS_TRANSFER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        access = VK_ACCESS_TRANSFER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_SHADER_READ_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_GENERAL:
+        // Storage images, written and read by compute and fragment shaders
+        stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+        stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        break;
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+        stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        access = 0;
+        break;
+    default:
+        // Anything else: wait for and make visible to everything
+        stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        break;
     }
 }
 
@@ -140,28 +178,22 @@ void VulkanImage::transitionLayout(VkImageLayout oldLayout, VkImageLayout newLay
     barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image = m_image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.aspectMask = newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+        ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = m_mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
     
+    // Wait for whatever used the old layout; make the image visible to whatever uses the new one
     VkPipelineStageFlags sourceStage;
     VkPipelineStageFlags destinationStage;
-    
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
+    VkAccessFlags sourceAccess;
+    getLayoutUsage(oldLayout, sourceStage, sourceAccess);
+    getLayoutUsage(newLayout, destinationStage, barrier.dstAccessMask);
+    barrier.srcAccessMask = sourceAccess & (VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
     
     vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     
@@ -188,40 +220,131 @@ void VulkanImage::copyFromBuffer(VkBuffer buffer, uint32_t width, uint32_t heigh
 }
 
 void VulkanImage::loadFromFile(const std::string& filepath) {
+    ImageData data;
+    if (!decodeFile(filepath, data)) {
+        throw std::runtime_error("failed to load texture image: " + filepath);
+    }
+    
+    createFromPixels(data, VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+bool VulkanImage::decodeFile(const std::string& filepath, ImageData& data, uint32_t channels) {
+    PROFILE_SCOPE("VulkanImage::decodeFile");
     int texWidth, texHeight, texChannels;
     stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
     
     if (!pixels) {
-        throw std::runtime_error("failed to load texture image: " + filepath);
+        return false;
     }
     
-    VulkanBuffer stagingBuffer(m_context);
-    stagingBuffer.create(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    stagingBuffer.copyFrom(pixels, imageSize);
+    // stb's 1/2-channel modes are luminance(+alpha); we want the leading R/RG channels as stored
+    size_t texelCount = static_cast<size_t>(texWidth) * texHeight;
+    data.channels = std::clamp(channels, 1u, 4u);
+    data.pixels.resize(texelCount * data.channels);
+    if (data.channels == 4) {
+        memcpy(data.pixels.data(), pixels, data.pixels.size());
+    } else {
+        for (size_t i = 0; i < texelCount; i++) {
+            for (uint32_t c = 0; c < data.channels; c++) {
+                data.pixels[i * data.channels + c] = pixels[i * 4 + c];
+            }
+        }
+    }
+    data.width = static_cast<uint32_t>(texWidth);
+    data.height = static_cast<uint32_t>(texHeight);
     
     stbi_image_free(pixels);
+    return true;
+}
+
+bool VulkanImage::decodeKtx2(const std::string& filepath, ImageData& data) {
+    PROFILE_SCOPE("VulkanImage::decodeKtx2");
+    Ktx2::Image image;
+    if (!Ktx2::read(filepath, image) || image.levels.empty()) {
+        return false;
+    }
+    
+    data.width = image.width;
+    data.height = image.height;
+    data.format = static_cast<VkFormat>(image.vkFormat);
+    data.pixels.clear();
+    data.mipOffsets.clear();
+    for (const auto& level : image.levels) {
+        data.mipOffsets.push_back(data.pixels.size());
+        data.pixels.insert(data.pixels.end(), level.begin(), level.end());
+    }
+    return true;
+}
+
+bool VulkanImage::isSrgbFormat(VkFormat format) {
+    return format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+void VulkanImage::generateMips(ImageData& data, bool srgb, uint32_t maxLevels) {
+    PROFILE_SCOPE("VulkanImage::generateMips");
+    if (!data.isValid()) {
+        return;
+    }
     
-    createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    uint32_t levels = std::min(MipChain::levelCount(data.width, data.height), std::max(1u, maxLevels));
     
-    transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyFromBuffer(stagingBuffer.getBuffer(), texWidth, texHeight);
-    transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Size the whole chain up front so pointers into earlier levels stay valid. Levels start
+    // on 4-byte boundaries: transfer-only queues require copy offsets to be multiples of 4
+    VkDeviceSize totalSize = 0;
+    data.mipOffsets.assign(levels, 0);
+    for (uint32_t level = 0; level < levels; level++) {
+        totalSize = (totalSize + 3) & ~VkDeviceSize(3);
+        data.mipOffsets[level] = totalSize;
+        totalSize += static_cast<VkDeviceSize>(MipChain::levelSize(data.width, level)) *
+                     MipChain::levelSize(data.height, level) * data.channels;
+    }
+    data.pixels.resize(static_cast<size_t>(totalSize));
     
-    stagingBuffer.cleanup();
+    for (uint32_t level = 1; level < levels; level++) {
+        MipChain::downsample(data.pixels.data() + data.mipOffsets[level - 1],
+                             MipChain::levelSize(data.width, level - 1),
+                             MipChain::levelSize(data.height, level - 1),
+                             data.channels, srgb, data.pixels.data() + data.mipOffsets[level]);
+    }
+}
+
+void VulkanImage::createFromPixels(const ImageData& data, VkFormat format) {
+    PROFILE_SCOPE("VulkanImage::createFromPixels");
+    // Pre-encoded data (KTX2) carries its own format and mip chain
+    if (data.format != VK_FORMAT_UNDEFINED) {
+        format = data.format;
+    }
+    
+    VulkanUploadManager& uploads = m_context.getUploadManager();
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    
+    // Batched with other uploads; the image is usable once the upload manager's batch completes
+    if (!data.mipOffsets.empty()) {
+        createImage(data.width, data.height, format, VK_IMAGE_TILING_OPTIMAL, usage,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, data.getMipLevels());
+        uploads.uploadImage(m_image, data.pixels.data(), data.pixels.size(),
+                            data.width, data.height, data.mipOffsets);
+    } else if (uploads.canBlitMips(format)) {
+        createImage(data.width, data.height, format, VK_IMAGE_TILING_OPTIMAL,
+                    usage | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    MipChain::levelCount(data.width, data.height));
+        uploads.uploadImageWithBlitMips(m_image, data.pixels.data(), data.pixels.size(),
+                                        data.width, data.height, m_mipLevels);
+    } else {
+        // Transfer-only queue or a format without linear blit support: build the chain here.
+        // The streaming path does this on the loader threads instead
+        ImageData withMips = data;
+        generateMips(withMips, isSrgbFormat(format));
+        createFromPixels(withMips, format);
+        return;
+    }
     
-    createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+    createImageView(format, VK_IMAGE_ASPECT_COLOR_BIT);
     createSampler();
 }
 
 void VulkanImage::cleanup() {
-    if (m_sampler != VK_NULL_HANDLE) {
-        vkDestroySampler(m_context.getDevice(), m_sampler, nullptr);
-        m_sampler = VK_NULL_HANDLE;
-    }
+    m_sampler = VK_NULL_HANDLE;  // Owned by the sampler cache
     if (m_imageView != VK_NULL_HANDLE) {
         vkDestroyImageView(m_context.getDevice(), m_imageView, nullptr);
         m_imageView = VK_NULL_HANDLE;
@@ -230,8 +353,7 @@ void VulkanImage::cleanup() {
         vkDestroyImage(m_context.getDevice(), m_image, nullptr);
         m_image = VK_NULL_HANDLE;
     }
-    if (m_memory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_context.getDevice(), m_memory, nullptr);
-        m_memory = VK_NULL_HANDLE;
+    if (m_allocation.isValid()) {
+        m_context.getAllocator().free(m_allocation);
     }
 }
@@ -0,0 +1,231 @@
+#include "vulkan/VulkanLightCulling.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+struct CullPushConstants {
+    glm::vec2 viewOffset;
+    glm::vec2 viewSize;
+    glm::uvec2 renderSize;
+    uint32_t firstPointLight;
+    uint32_t pointLightCount;
+    uint32_t spotLightCount;
+    uint32_t useTileDepth;
+};
+
+constexpr uint32_t INITIAL_LIGHT_CAPACITY = 64;
+
+} // namespace
+
+VulkanLightCulling::VulkanLightCulling(VulkanContext& context, VulkanDescriptorManager& descriptorManager)
+    : m_context(context), m_descriptorManager(descriptorManager), m_tileBuffer(context) {
+}
+
+VulkanLightCulling::~VulkanLightCulling() {
+    cleanup();
+}
+
+void VulkanLightCulling::init(VulkanImage* depth, VkExtent2D extent, uint32_t frameCount) {
+    m_depth = depth;
+    createTileBuffer(extent);
+    createPipeline();
+
+    m_frames.resize(frameCount);
+    for (FrameLights& frame : m_frames) {
+        frame.descriptorSet = m_descriptorManager.allocateDescriptorSet(m_descriptorSetLayout);
+        createLightBuffer(frame, INITIAL_LIGHT_CAPACITY);
+        writeDescriptorSet(frame);
+    }
+}
+
+void VulkanLightCulling::resize(VulkanImage* depth, VkExtent2D extent) {
+    m_depth = depth;
+    m_tileBuffer.cleanup();
+    createTileBuffer(extent);
+    for (FrameLights& frame : m_frames) {
+        writeDescriptorSet(frame);
+    }
+}
+
+void VulkanLightCulling::createTileBuffer(VkExtent2D extent) {
+    m_extent = extent;
+    setRenderExtent(extent);
+
+    // Written by the compute pass, read by composition; never touched by the CPU
+    VkDeviceSize tileBufferSize = VkDeviceSize(m_tileCountX) * m_tileCountY * TILE_STRIDE * sizeof(uint32_t);
+    m_tileBuffer.create(tileBufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void VulkanLightCulling::setRenderExtent(VkExtent2D extent) {
+    // Rows are packed at the render extent's width, so a smaller area uses the front of the buffer
+    m_renderExtent.width = std::min(extent.width, m_extent.width);
+    m_renderExtent.height = std::min(extent.height, m_extent.height);
+    m_tileCountX = (m_renderExtent.width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tileCountY = (m_renderExtent.height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+void VulkanLightCulling::cleanup() {
+    m_frames.clear();
+    m_tileBuffer.cleanup();
+
+    if (m_pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_context.getDevice(), m_pipeline, nullptr);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_context.getDevice(), m_pipelineLayout, nullptr);
+        m_pipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(m_context.getDevice(), m_descriptorSetLayout, nullptr);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanLightCulling::createPipeline() {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+
+    // Binding 0: All lights, read by the culling pass and composition
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Binding 1: Per-tile light lists
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    // Binding 2: G-buffer depth, for each tile's depth range
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create light culling descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(CullPushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create light culling pipeline layout!");
+    }
+
+    VkPipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    stageInfo.module = m_context.getPipelineCache().loadShaderModule("shaders/light_cull.comp.spv");
+    stageInfo.pName = "main";
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = stageInfo;
+    pipelineInfo.layout = m_pipelineLayout;
+
+    if (vkCreateComputePipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create light culling pipeline!");
+    }
+}
+
+void VulkanLightCulling::createLightBuffer(FrameLights& frame, uint32_t capacity) {
+    frame.buffer = std::make_unique<VulkanBuffer>(m_context);
+    frame.buffer->create(capacity * LIGHT_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    frame.buffer->map();
+    frame.capacity = capacity;
+}
+
+void VulkanLightCulling::writeDescriptorSet(FrameLights& frame) {
+    VkDescriptorBufferInfo lightsInfo{};
+    lightsInfo.buffer = frame.buffer->getBuffer();
+    lightsInfo.offset = 0;
+    lightsInfo.range = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo tilesInfo{};
+    tilesInfo.buffer = m_tileBuffer.getBuffer();
+    tilesInfo.offset = 0;
+    tilesInfo.range = VK_WHOLE_SIZE;
+
+    VkDescriptorImageInfo depthInfo{};
+    depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    depthInfo.imageView = m_depth->getImageView();
+    depthInfo.sampler = m_depth->getSampler();
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = frame.descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorCount = 1;
+    }
+    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].pBufferInfo = &lightsInfo;
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[1].pBufferInfo = &tilesInfo;
+    descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[2].pImageInfo = &depthInfo;
+
+    vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void VulkanLightCulling::updateLights(uint32_t frameIndex, const void* lights,
+                                      uint32_t directionalCount, uint32_t pointCount, uint32_t spotCount) {
+    FrameLights& frame = m_frames[frameIndex];
+    uint32_t lightCount = directionalCount + pointCount + spotCount;
+
+    // The frame's fence has signaled, so its buffer and descriptor set are free to replace
+    if (lightCount > frame.capacity) {
+        createLightBuffer(frame, std::max(lightCount, frame.capacity * 2));
+        writeDescriptorSet(frame);
+    }
+
+    if (lightCount > 0) {
+        std::memcpy(frame.buffer->getMapped(), lights, lightCount * LIGHT_SIZE);
+    }
+    frame.directionalCount = directionalCount;
+    frame.pointCount = pointCount;
+    frame.spotCount = spotCount;
+}
+
+void VulkanLightCulling::dispatch(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                                  const glm::vec2& viewOffset, const glm::vec2& viewSize, bool useTileDepth) {
+    CullPushConstants pushConstants{};
+    pushConstants.viewOffset = viewOffset;
+    pushConstants.viewSize = viewSize;
+    pushConstants.renderSize = glm::uvec2(m_renderExtent.width, m_renderExtent.height);
+    pushConstants.firstPointLight = m_frames[frameIndex].directionalCount;
+    pushConstants.pointLightCount = m_frames[frameIndex].pointCount;
+    pushConstants.spotLightCount = m_frames[frameIndex].spotCount;
+    pushConstants.useTileDepth = useTileDepth ? 1u : 0u;
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+                            0, 1, &m_frames[frameIndex].descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(pushConstants), &pushConstants);
+
+    // One workgroup per tile
+    vkCmdDispatch(commandBuffer, m_tileCountX, m_tileCountY, 1);
+}
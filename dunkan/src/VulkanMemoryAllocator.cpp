@@ -0,0 +1,399 @@
+#include "vulkan/VulkanMemoryAllocator.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VulkanContext& context) : m_context(context) {
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator() {
+    cleanup();
+}
+
+void VulkanMemoryAllocator::init() {
+    vkGetPhysicalDeviceMemoryProperties(m_context.getPhysicalDevice(), &m_memoryProperties);
+    m_nonCoherentAtomSize = std::max<VkDeviceSize>(1, m_context.getDeviceProperties().limits.nonCoherentAtomSize);
+}
+
+void VulkanMemoryAllocator::cleanup() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& pool : m_pools) {
+        for (auto& block : pool->blocks) {
+            if (!block) continue;
+            if (block->allocationCount > 0) {
+                std::cerr << "VulkanMemoryAllocator: " << block->allocationCount
+                          << " allocation(s) still alive at shutdown" << std::endl;
+            }
+            releaseBlock(*block);
+        }
+    }
+    m_pools.clear();
+
+    if (m_dedicatedCount > 0) {
+        std::cerr << "VulkanMemoryAllocator: " << m_dedicatedCount
+                  << " dedicated allocation(s) still alive at shutdown" << std::endl;
+    }
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties,
+                                                       AllocationStrategy strategy) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_context.getDevice(), buffer, &memRequirements);
+
+    VulkanAllocation allocation = allocate(memRequirements, properties, AllocationKind::Buffer, strategy,
+                                           false, buffer, VK_NULL_HANDLE);
+    vkBindBufferMemory(m_context.getDevice(), buffer, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocateImage(VkImage image, VkMemoryPropertyFlags properties,
+                                                      bool dedicated) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_context.getDevice(), image, &memRequirements);
+
+    VulkanAllocation allocation = allocate(memRequirements, properties, AllocationKind::Image,
+                                           AllocationStrategy::Buddy, dedicated, VK_NULL_HANDLE, image);
+    vkBindImageMemory(m_context.getDevice(), image, allocation.memory, allocation.offset);
+    return allocation;
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocateImageMemory(const VkMemoryRequirements& requirements,
+                                                            VkMemoryPropertyFlags properties) {
+    // Not dedicated to any one image, so no VkMemoryDedicatedAllocateInfo resource
+    return allocate(requirements, properties, AllocationKind::Image, AllocationStrategy::Buddy,
+                    true, VK_NULL_HANDLE, VK_NULL_HANDLE);
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                                                 VkMemoryPropertyFlags properties,
+                                                 AllocationKind kind, AllocationStrategy strategy,
+                                                 bool dedicated, VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+    uint32_t memoryTypeIndex = m_context.findMemoryType(requirements.memoryTypeBits, properties);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Anything bigger than half a block would waste most of it; give it its own memory
+    if (dedicated || requirements.size > chooseBlockSize(memoryTypeIndex) / 2) {
+        return allocateDedicated(requirements, memoryTypeIndex, dedicatedBuffer, dedicatedImage);
+    }
+
+    VkDeviceSize size = requirements.size;
+    VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+
+    // Keep host-visible, non-coherent ranges atom aligned so they can be flushed independently
+    VkMemoryPropertyFlags typeFlags = m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+    if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+        alignment = std::max(alignment, m_nonCoherentAtomSize);
+        size = alignUp(size, m_nonCoherentAtomSize);
+    }
+
+    uint32_t poolIndex = getPool(memoryTypeIndex, kind, strategy);
+    Pool& pool = *m_pools[poolIndex];
+
+    VulkanAllocation allocation;
+    allocation.poolIndex = poolIndex;
+
+    for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+        if (pool.blocks[i] && allocateFromBlock(pool, i, size, alignment, allocation)) {
+            return allocation;
+        }
+    }
+
+    uint32_t blockIndex = createBlock(pool);
+    if (!allocateFromBlock(pool, blockIndex, size, alignment, allocation)) {
+        throw std::runtime_error("failed to sub-allocate device memory!");
+    }
+    return allocation;
+}
+
+VulkanAllocation VulkanMemoryAllocator::allocateDedicated(const VkMemoryRequirements& requirements,
+                                                          uint32_t memoryTypeIndex,
+                                                          VkBuffer buffer, VkImage image) {
+    // Lets the driver place render targets optimally (core since Vulkan 1.1)
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = buffer;
+    dedicatedInfo.image = image;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = &dedicatedInfo;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VulkanAllocation allocation;
+    if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &allocation.memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate dedicated device memory!");
+    }
+
+    allocation.offset = 0;
+    allocation.size = requirements.size;
+    allocation.poolIndex = UINT32_MAX;
+
+    if (m_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        if (vkMapMemory(m_context.getDevice(), allocation.memory, 0, VK_WHOLE_SIZE, 0, &allocation.mapped) != VK_SUCCESS) {
+            throw std::runtime_error("failed to map dedicated device memory!");
+        }
+    }
+
+    m_dedicatedCount++;
+    m_dedicatedBytes += allocation.size;
+    return allocation;
+}
+
+void VulkanMemoryAllocator::free(VulkanAllocation& allocation) {
+    if (!allocation.isValid()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (allocation.poolIndex == UINT32_MAX) {
+        // Freeing implicitly unmaps
+        vkFreeMemory(m_context.getDevice(), allocation.memory, nullptr);
+        m_dedicatedCount--;
+        m_dedicatedBytes -= allocation.size;
+        allocation = VulkanAllocation{};
+        return;
+    }
+
+    Pool& pool = *m_pools[allocation.poolIndex];
+    Block& block = *pool.blocks[allocation.blockIndex];
+
+    block.usedBytes -= allocation.size;
+    block.allocationCount--;
+
+    if (pool.strategy == AllocationStrategy::Buddy) {
+        // Merge with the buddy as long as it is free too
+        VkDeviceSize offset = allocation.offset;
+        uint32_t order = allocation.order;
+        uint32_t topOrder = static_cast<uint32_t>(block.freeLists.size()) - 1;
+        while (order < topOrder) {
+            VkDeviceSize buddy = offset ^ (MIN_BUDDY_SIZE << order);
+            auto it = block.freeLists[order].find(buddy);
+            if (it == block.freeLists[order].end()) {
+                break;
+            }
+            block.freeLists[order].erase(it);
+            offset = std::min(offset, buddy);
+            order++;
+        }
+        block.freeLists[order].insert(offset);
+    } else if (block.allocationCount == 0) {
+        block.head = 0;
+    }
+
+    // Return empty blocks to the driver, but keep one around per pool to avoid thrashing
+    if (block.allocationCount == 0) {
+        uint32_t liveBlocks = 0;
+        for (const auto& b : pool.blocks) {
+            if (b) liveBlocks++;
+        }
+        if (liveBlocks > 1) {
+            releaseBlock(block);
+            pool.blocks[allocation.blockIndex].reset();
+        }
+    }
+
+    allocation = VulkanAllocation{};
+}
+
+uint32_t VulkanMemoryAllocator::getPool(uint32_t memoryTypeIndex, AllocationKind kind, AllocationStrategy strategy) {
+    for (uint32_t i = 0; i < m_pools.size(); i++) {
+        const Pool& pool = *m_pools[i];
+        if (pool.memoryTypeIndex == memoryTypeIndex && pool.kind == kind && pool.strategy == strategy) {
+            return i;
+        }
+    }
+
+    auto pool = std::make_unique<Pool>();
+    pool->memoryTypeIndex = memoryTypeIndex;
+    pool->kind = kind;
+    pool->strategy = strategy;
+    pool->blockSize = chooseBlockSize(memoryTypeIndex);
+    m_pools.push_back(std::move(pool));
+    return static_cast<uint32_t>(m_pools.size() - 1);
+}
+
+uint32_t VulkanMemoryAllocator::createBlock(Pool& pool) {
+    auto block = std::make_unique<Block>();
+    block->size = pool.blockSize;
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = block->size;
+    allocInfo.memoryTypeIndex = pool.memoryTypeIndex;
+
+    if (vkAllocateMemory(m_context.getDevice(), &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory block!");
+    }
+
+    // Host-visible blocks stay mapped for their whole lifetime
+    if (m_memoryProperties.memoryTypes[pool.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data = nullptr;
+        if (vkMapMemory(m_context.getDevice(), block->memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+            vkFreeMemory(m_context.getDevice(), block->memory, nullptr);
+            throw std::runtime_error("failed to map device memory block!");
+        }
+        block->mapped = static_cast<uint8_t*>(data);
+    }
+
+    if (pool.strategy == AllocationStrategy::Buddy) {
+        block->freeLists.resize(buddyOrderCount(block->size));
+        block->freeLists.back().insert(0);
+    }
+
+    for (uint32_t i = 0; i < pool.blocks.size(); i++) {
+        if (!pool.blocks[i]) {
+            pool.blocks[i] = std::move(block);
+            return i;
+        }
+    }
+    pool.blocks.push_back(std::move(block));
+    return static_cast<uint32_t>(pool.blocks.size() - 1);
+}
+
+bool VulkanMemoryAllocator::allocateFromBlock(Pool& pool, uint32_t blockIndex, VkDeviceSize size,
+                                              VkDeviceSize alignment, VulkanAllocation& allocation) {
+    Block& block = *pool.blocks[blockIndex];
+    VkDeviceSize offset = 0;
+
+    if (pool.strategy == AllocationStrategy::Buddy) {
+        // Buddy nodes are naturally aligned to their size, so asking for at least
+        // `alignment` bytes satisfies the alignment requirement too
+        VkDeviceSize nodeSize = MIN_BUDDY_SIZE;
+        uint32_t order = 0;
+        while (nodeSize < size || nodeSize < alignment) {
+            nodeSize <<= 1;
+            order++;
+        }
+        if (order >= block.freeLists.size()) {
+            return false;
+        }
+
+        uint32_t freeOrder = order;
+        while (freeOrder < block.freeLists.size() && block.freeLists[freeOrder].empty()) {
+            freeOrder++;
+        }
+        if (freeOrder == block.freeLists.size()) {
+            return false;
+        }
+
+        offset = *block.freeLists[freeOrder].begin();
+        block.freeLists[freeOrder].erase(block.freeLists[freeOrder].begin());
+
+        // Split down, keeping the upper halves free
+        while (freeOrder > order) {
+            freeOrder--;
+            block.freeLists[freeOrder].insert(offset + (MIN_BUDDY_SIZE << freeOrder));
+        }
+        allocation.order = order;
+    } else {
+        offset = alignUp(block.head, alignment);
+        if (offset + size > block.size) {
+            return false;
+        }
+        block.head = offset + size;
+    }
+
+    block.usedBytes += size;
+    block.allocationCount++;
+
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.size = size;
+    allocation.mapped = block.mapped ? block.mapped + offset : nullptr;
+    allocation.blockIndex = blockIndex;
+    return true;
+}
+
+void VulkanMemoryAllocator::releaseBlock(Block& block) {
+    if (block.memory != VK_NULL_HANDLE) {
+        vkFreeMemory(m_context.getDevice(), block.memory, nullptr);
+        block.memory = VK_NULL_HANDLE;
+        block.mapped = nullptr;
+    }
+}
+
+VkDeviceSize VulkanMemoryAllocator::chooseBlockSize(uint32_t memoryTypeIndex) const {
+    // Small heaps (e.g. 256 MB BAR memory) get smaller blocks so one pool can't exhaust them
+    uint32_t heapIndex = m_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+    VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+
+    VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE;
+    while (blockSize > MIN_BLOCK_SIZE && blockSize > heapSize / 8) {
+        blockSize >>= 1;
+    }
+    return blockSize;
+}
+
+uint32_t VulkanMemoryAllocator::buddyOrderCount(VkDeviceSize blockSize) const {
+    uint32_t count = 1;
+    for (VkDeviceSize size = MIN_BUDDY_SIZE; size < blockSize; size <<= 1) {
+        count++;
+    }
+    return count;
+}
+
+VulkanMemoryAllocator::Stats VulkanMemoryAllocator::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats;
+    stats.dedicatedCount = m_dedicatedCount;
+    stats.dedicatedBytes = m_dedicatedBytes;
+    stats.deviceMemoryCount = m_dedicatedCount;
+
+    for (const auto& pool : m_pools) {
+        PoolStats poolStats;
+        poolStats.memoryTypeIndex = pool->memoryTypeIndex;
+        poolStats.kind = pool->kind;
+        poolStats.strategy = pool->strategy;
+
+        VkDeviceSize freeBytes = 0;
+        for (const auto& block : pool->blocks) {
+            if (!block) continue;
+
+            poolStats.blockCount++;
+            poolStats.allocationCount += block->allocationCount;
+            poolStats.blockBytes += block->size;
+            poolStats.usedBytes += block->usedBytes;
+
+            if (pool->strategy == AllocationStrategy::Buddy) {
+                for (uint32_t order = 0; order < block->freeLists.size(); order++) {
+                    VkDeviceSize nodeSize = MIN_BUDDY_SIZE << order;
+                    freeBytes += nodeSize * block->freeLists[order].size();
+                    if (!block->freeLists[order].empty()) {
+                        poolStats.largestFreeRange = std::max(poolStats.largestFreeRange, nodeSize);
+                    }
+                }
+            } else {
+                VkDeviceSize tail = block->size - block->head;
+                freeBytes += tail;
+                poolStats.largestFreeRange = std::max(poolStats.largestFreeRange, tail);
+            }
+        }
+
+        if (freeBytes > 0) {
+            poolStats.fragmentation = 1.0f - static_cast<float>(poolStats.largestFreeRange) / static_cast<float>(freeBytes);
+        }
+
+        stats.deviceMemoryCount += poolStats.blockCount;
+        stats.pools.push_back(poolStats);
+    }
+
+    return stats;
+}
+
+const char* VulkanMemoryAllocator::kindName(AllocationKind kind) {
+    return kind == AllocationKind::Buffer ? "Buffer" : "Image";
+}
+
+const char* VulkanMemoryAllocator::strategyName(AllocationStrategy strategy) {
+    return strategy == AllocationStrategy::Buddy ? "Buddy" : "Linear";
+}
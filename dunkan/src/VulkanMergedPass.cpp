@@ -0,0 +1,154 @@
+#include "vulkan/VulkanMergedPass.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+struct CompositionPushConstants {
+    float gamma;
+    uint32_t tilesPerRow;
+};
+
+} // namespace
+
+VulkanMergedPass::VulkanMergedPass(VulkanContext& context, VulkanDescriptorManager& descriptorManager)
+    : m_context(context), m_descriptorManager(descriptorManager) {
+}
+
+VulkanMergedPass::~VulkanMergedPass() {
+    cleanup();
+}
+
+void VulkanMergedPass::init(VkRenderPass renderPass, VkExtent2D extent, GBufferLayout layout,
+                            VkDescriptorSetLayout lightingSetLayout, VkBuffer uniformBuffer, VkDeviceSize uniformRange) {
+    m_renderPass = renderPass;
+    m_gbuffer.renderPass = renderPass;
+    m_gbuffer.create(m_context, extent.width, extent.height, layout, true);
+
+    // Same shaders as the separate G-buffer pass; subpass 0 has the same attachments, so
+    // material descriptor sets work with either pipeline
+    m_gbufferPipeline = std::make_unique<VulkanPipeline>(m_context);
+    m_gbufferPipeline->createGraphicsPipeline(renderPass, "shaders/default.vert.spv",
+                                              "shaders/color.frag.spv", 4);
+
+    m_compositionPipeline = std::make_unique<VulkanPipeline>(m_context);
+    m_compositionPipeline->createSubpassCompositionPipeline(renderPass, 1, "shaders/composite.vert.spv",
+                                                            "shaders/composite_subpass.frag.spv",
+                                                            lightingSetLayout);
+
+    m_descriptorSet = m_descriptorManager.allocateDescriptorSet(m_compositionPipeline->getDescriptorSetLayout());
+    m_uniformBuffer = uniformBuffer;
+    m_uniformRange = uniformRange;
+    writeDescriptorSet();
+}
+
+void VulkanMergedPass::resize(const std::vector<VkImageView>& imageViews, VkExtent2D extent) {
+    m_gbuffer.recreate(m_context, extent.width, extent.height);
+    writeDescriptorSet();
+    createFramebuffers(imageViews, extent);
+}
+
+void VulkanMergedPass::writeDescriptorSet() {
+    std::array<VulkanImage*, 4> targets = {m_gbuffer.colorRT, m_gbuffer.normalRT,
+                                           m_gbuffer.depthRT, m_gbuffer.materialRT};
+    for (uint32_t i = 0; i < targets.size(); i++) {
+        m_descriptorManager.updateInputAttachmentDescriptor(m_descriptorSet, i, targets[i]->getImageView());
+    }
+    m_descriptorManager.updateDynamicUniformBuffer(m_descriptorSet, 5, m_uniformBuffer, m_uniformRange);
+}
+
+void VulkanMergedPass::createFramebuffers(const std::vector<VkImageView>& imageViews, VkExtent2D extent) {
+    destroyFramebuffers();
+
+    // The G-buffer keeps its size until resize(); render the area both cover
+    m_framebufferExtent.width = std::min(extent.width, m_gbuffer.width);
+    m_framebufferExtent.height = std::min(extent.height, m_gbuffer.height);
+
+    m_framebuffers.resize(imageViews.size());
+    for (size_t i = 0; i < imageViews.size(); i++) {
+        std::array<VkImageView, 6> attachments = {
+            imageViews[i],
+            m_gbuffer.colorRT->getImageView(),
+            m_gbuffer.normalRT->getImageView(),
+            m_gbuffer.depthRT->getImageView(),
+            m_gbuffer.materialRT->getImageView(),
+            m_gbuffer.depthStencilImage->getImageView()
+        };
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = m_renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferInfo.pAttachments = attachments.data();
+        framebufferInfo.width = m_framebufferExtent.width;
+        framebufferInfo.height = m_framebufferExtent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(m_context.getDevice(), &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create merged pass framebuffer!");
+        }
+    }
+}
+
+void VulkanMergedPass::destroyFramebuffers() {
+    for (VkFramebuffer framebuffer : m_framebuffers) {
+        vkDestroyFramebuffer(m_context.getDevice(), framebuffer, nullptr);
+    }
+    m_framebuffers.clear();
+}
+
+void VulkanMergedPass::cleanup() {
+    destroyFramebuffers();
+    m_compositionPipeline.reset();
+    m_gbufferPipeline.reset();
+    m_gbuffer.cleanup(m_context);
+    m_descriptorSet = VK_NULL_HANDLE;
+}
+
+void VulkanMergedPass::begin(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_framebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_framebufferExtent;
+
+    // Swapchain as in the final render pass, G-buffer as in the separate G-buffer pass
+    std::array<VkClearValue, 6> clearValues{};
+    clearValues[0].color = {{0.1f, 0.1f, 0.15f, 1.0f}};
+    clearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    clearValues[2].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    clearValues[3].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    clearValues[4].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+    clearValues[5].depthStencil = {1.0f, 0};
+
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // Dynamic state, kept for the composition subpass
+    VulkanPipeline::setViewport(commandBuffer, m_framebufferExtent);
+}
+
+void VulkanMergedPass::compose(VkCommandBuffer commandBuffer, const ShaderPermutation& permutation,
+                               uint32_t lightingUBOOffset, VkDescriptorSet lightSet, float gamma, uint32_t tilesPerRow) {
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkPipelineLayout layout = m_compositionPipeline->getLayout();
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_compositionPipeline->getPipeline(permutation));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+                            0, 1, &m_descriptorSet, 1, &lightingUBOOffset);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+                            1, 1, &lightSet, 0, nullptr);
+
+    CompositionPushConstants pushConstants{gamma, tilesPerRow};
+    vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(pushConstants), &pushConstants);
+
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Full screen triangle
+}
+
+void VulkanMergedPass::end(VkCommandBuffer commandBuffer) {
+    vkCmdEndRenderPass(commandBuffer);
+}
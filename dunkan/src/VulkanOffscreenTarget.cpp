@@ -0,0 +1,140 @@
+#include "vulkan/VulkanOffscreenTarget.hpp"
+#include "utils/CpuProfiler.hpp"
+#include <cstring>
+#include <stdexcept>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+VulkanOffscreenTarget::VulkanOffscreenTarget(VulkanContext& context) : m_context(context) {
+}
+
+VulkanOffscreenTarget::~VulkanOffscreenTarget() {
+    waitForWrites();
+    cleanup();
+}
+
+void VulkanOffscreenTarget::create(VkExtent2D extent, uint32_t imageCount, VkFormat format) {
+    m_extent = extent;
+    m_format = format;
+
+    VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+    for (uint32_t i = 0; i < imageCount; i++) {
+        auto target = std::make_unique<VulkanImage>(m_context);
+        target->createRenderTarget(extent.width, extent.height, format,
+                                   VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+        target->createImageView(format, VK_IMAGE_ASPECT_COLOR_BIT);
+        m_images.push_back(target->getImage());
+        m_imageViews.push_back(target->getImageView());
+        m_targets.push_back(std::move(target));
+
+        // Read by the CPU once the frame is done, persistently mapped
+        auto readback = std::make_unique<VulkanBuffer>(m_context);
+        readback->create(readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        m_readbacks.push_back(std::move(readback));
+    }
+}
+
+void VulkanOffscreenTarget::cleanup() {
+    destroyFramebuffers();
+    m_imageViews.clear();
+    m_images.clear();
+    m_targets.clear();
+    m_readbacks.clear();
+}
+
+void VulkanOffscreenTarget::createFramebuffers(VkRenderPass renderPass) {
+    destroyFramebuffers();
+    m_framebuffers.resize(m_imageViews.size());
+
+    for (size_t i = 0; i < m_imageViews.size(); i++) {
+        VkImageView attachments[] = {m_imageViews[i]};
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.width = m_extent.width;
+        framebufferInfo.height = m_extent.height;
+        framebufferInfo.layers = 1;
+
+        if (vkCreateFramebuffer(m_context.getDevice(), &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen framebuffer!");
+        }
+    }
+}
+
+void VulkanOffscreenTarget::destroyFramebuffers() {
+    for (VkFramebuffer framebuffer : m_framebuffers) {
+        vkDestroyFramebuffer(m_context.getDevice(), framebuffer, nullptr);
+    }
+    m_framebuffers.clear();
+}
+
+void VulkanOffscreenTarget::recordReadback(VkCommandBuffer commandBuffer, uint32_t index) {
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;     // Tightly packed rows
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {m_extent.width, m_extent.height, 1};
+
+    vkCmdCopyImageToBuffer(commandBuffer, m_images[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           m_readbacks[index]->getBuffer(), 1, &region);
+
+    // Make the copy visible to the host reading the mapped buffer after the fence
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_readbacks[index]->getBuffer();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void VulkanOffscreenTarget::writePng(uint32_t index, const std::string& path) {
+    PROFILE_SCOPE("VulkanOffscreenTarget::writePng");
+
+    // Each queued frame holds a copy of its pixels; don't let a slow disk pile them up
+    while (m_writes.size() >= MAX_QUEUED_WRITES) {
+        finishOldestWrite();
+    }
+
+    // Copied out so the buffer can take the slot's next frame while the PNG is encoded
+    const VulkanBuffer& readback = *m_readbacks[index];
+    std::vector<uint8_t> pixels(static_cast<size_t>(readback.getSize()));
+    std::memcpy(pixels.data(), readback.getMapped(), pixels.size());
+
+    int width = static_cast<int>(m_extent.width);
+    int height = static_cast<int>(m_extent.height);
+    m_writes.push_back(m_writer.submit([pixels = std::move(pixels), path, width, height] {
+        PROFILE_SCOPE("stbi_write_png");
+        return stbi_write_png(path.c_str(), width, height, 4, pixels.data(), width * 4) != 0;
+    }));
+}
+
+void VulkanOffscreenTarget::finishOldestWrite() {
+    if (!m_writes.front().get()) {
+        m_failedWrites++;
+    }
+    m_writes.pop_front();
+}
+
+uint32_t VulkanOffscreenTarget::waitForWrites() {
+    while (!m_writes.empty()) {
+        finishOldestWrite();
+    }
+    uint32_t failed = m_failedWrites;
+    m_failedWrites = 0;
+    return failed;
+}
@@ -1,6 +1,6 @@
 #include "vulkan/VulkanPipeline.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
 #include "vulkan/VulkanTypes.hpp"
-#include <fstream>
 #include <stdexcept>
 
 VulkanPipeline::VulkanPipeline(VulkanContext& context) : m_context(context) {
@@ -10,48 +10,84 @@ VulkanPipeline::~VulkanPipeline() {
     cleanup();
 }
 
-std::vector<char> VulkanPipeline::readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+void VulkanPipeline::createGraphicsPipeline(
+    VkRenderPass renderPass,
+    const std::string& vertShaderPath,
+    const std::string& fragShaderPath,
+    uint32_t attachmentCount) {
+    
+    m_kind = PipelineKind::GBuffer;
+    m_renderPass = renderPass;
+    m_subpass = 0;
+    m_vertShaderPath = vertShaderPath;
+    m_fragShaderPath = fragShaderPath;
+    m_attachmentCount = attachmentCount;
+    
+    // Descriptor set layout - UBO + textures
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    
+    // Binding 0: Uniform buffer (view/projection), offset into the frame allocator at bind time
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[0].pImmutableSamplers = nullptr;
+    
+    // Binding 1: Color texture (albedo)
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].pImmutableSamplers = nullptr;
+    
+    // Binding 2: Depth/Height texture
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[2].pImmutableSamplers = nullptr;
+    
+    // Binding 3: Normal texture
+    bindings[3].binding = 3;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[3].descriptorCount = 1;
+    bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[3].pImmutableSamplers = nullptr;
     
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file: " + filename);
+    // Binding 4: Material texture (roughness, metalness, AO)
+    bindings[4].binding = 4;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[4].descriptorCount = 1;
+    bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[4].pImmutableSamplers = nullptr;
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    
+    if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
     }
     
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    // Per-sprite data comes in as instance attributes (SpriteInstance), no push constants
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
     
-    return buffer;
-}
-
-VkShaderModule VulkanPipeline::createShaderModule(const std::vector<char>& code) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-    
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(m_context.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
     }
     
-    return shaderModule;
+    // The default permutation is built up front, the others on first use
+    m_pipeline = getPipeline(ShaderPermutation{});
 }
 
-void VulkanPipeline::createGraphicsPipeline(
-    VkRenderPass renderPass,
-    const std::string& vertShaderPath,
-    const std::string& fragShaderPath,
-    VkExtent2D extent,
-    uint32_t attachmentCount) {
-    
-    auto vertShaderCode = readFile(vertShaderPath);
-    auto fragShaderCode = readFile(fragShaderPath);
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+VkPipeline VulkanPipeline::compileGraphicsPipeline(const VkSpecializationInfo& specialization) {
+    // Modules are owned by the context's pipeline cache and shared with other pipelines
+    VkShaderModule vertShaderModule = m_context.getPipelineCache().loadShaderModule(m_vertShaderPath);
+    VkShaderModule fragShaderModule = m_context.getPipelineCache().loadShaderModule(m_fragShaderPath);
     
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -64,17 +100,28 @@ void VulkanPipeline::createGraphicsPipeline(
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = &specialization;
     
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
     
-    // Vertex input
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    // Vertex input: binding 0 = quad vertices, binding 1 = per-sprite instance data
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+        Vertex::getBindingDescription(),
+        SpriteInstance::getBindingDescription()
+    };
+    
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+    for (const auto& attribute : Vertex::getAttributeDescriptions()) {
+        attributeDescriptions.push_back(attribute);
+    }
+    for (const auto& attribute : SpriteInstance::getAttributeDescriptions()) {
+        attributeDescriptions.push_back(attribute);
+    }
     
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     
@@ -83,24 +130,17 @@ void VulkanPipeline::createGraphicsPipeline(
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) extent.width;
-    viewport.height = (float) extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = extent;
-    
+    // Set at record time (setViewport())
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
     
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -117,38 +157,26 @@ void VulkanPipeline::createGraphicsPipeline(
     multisampling.sampleShadingEnable = VK_FALSE;
     multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
     
-    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(attachmentCount);
-    for(uint32_t i = 0; i < attachmentCount; i++) {
+    std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments(m_attachmentCount);
+    for(uint32_t i = 0; i < m_attachmentCount; i++) {
         colorBlendAttachments[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                                               VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
         
-        // Enable blending ONLY for depth buffer (attachment 2)
-        // Attachments: 0=Albedo, 1=Normal, 2=Depth, 3=Material
-        if (i == 2) {
-            // Depth buffer: use alpha blending
-            colorBlendAttachments[i].blendEnable = VK_TRUE;
-            colorBlendAttachments[i].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-            colorBlendAttachments[i].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-            colorBlendAttachments[i].colorBlendOp = VK_BLEND_OP_ADD;
-            colorBlendAttachments[i].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            colorBlendAttachments[i].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            colorBlendAttachments[i].alphaBlendOp = VK_BLEND_OP_ADD;
-        } else {
-            // All other buffers: no blending, depth test determines visibility
-            colorBlendAttachments[i].blendEnable = VK_FALSE;
-            colorBlendAttachments[i].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-            colorBlendAttachments[i].dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-            colorBlendAttachments[i].colorBlendOp = VK_BLEND_OP_ADD;
-            colorBlendAttachments[i].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            colorBlendAttachments[i].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            colorBlendAttachments[i].alphaBlendOp = VK_BLEND_OP_ADD;
-        }
+        // No blending: the depth test determines visibility. The G-buffer's depth target is a
+        // float format (R16F/R32F) that stores a single linear depth, blending it would mix depths
+        colorBlendAttachments[i].blendEnable = VK_FALSE;
+        colorBlendAttachments[i].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[i].dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachments[i].colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachments[i].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[i].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachments[i].alphaBlendOp = VK_BLEND_OP_ADD;
     }
     
     VkPipelineColorBlendStateCreateInfo colorBlending{};
     colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
     colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.attachmentCount = attachmentCount;
+    colorBlending.attachmentCount = m_attachmentCount;
     colorBlending.pAttachments = colorBlendAttachments.data();
     
     // Depth and stencil state - CRITICAL for proper sprite layering!
@@ -160,104 +188,139 @@ void VulkanPipeline::createGraphicsPipeline(
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable = VK_FALSE;
     
-    // Descriptor set layout - UBO + textures
-    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;  // CRITICAL: Enable depth testing!
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.renderPass = m_renderPass;
+    pipelineInfo.subpass = 0;
     
-    // Binding 0: Uniform buffer (view/projection)
-    bindings[0].binding = 0;
-    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    bindings[0].descriptorCount = 1;
-    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    bindings[0].pImmutableSamplers = nullptr;
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create graphics pipeline!");
+    }
     
-    // Binding 1: Color texture (albedo)
-    bindings[1].binding = 1;
-    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[1].descriptorCount = 1;
-    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[1].pImmutableSamplers = nullptr;
+    return pipeline;
+}
+
+void VulkanPipeline::createCompositionPipeline(
+    VkRenderPass renderPass,
+    const std::string& vertShaderPath,
+    const std::string& fragShaderPath,
+    VkDescriptorSetLayout lightingSetLayout) {
     
-    // Binding 2: Depth/Height texture
-    bindings[2].binding = 2;
-    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[2].descriptorCount = 1;
-    bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[2].pImmutableSamplers = nullptr;
+    m_kind = PipelineKind::Composition;
+    m_renderPass = renderPass;
+    m_subpass = 0;
+    m_vertShaderPath = vertShaderPath;
+    m_fragShaderPath = fragShaderPath;
+    m_attachmentCount = 1;
     
-    // Binding 3: Normal texture
-    bindings[3].binding = 3;
-    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    bindings[3].descriptorCount = 1;
-    bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[3].pImmutableSamplers = nullptr;
+    // Descriptor set layout - 6 bindings (5 Samplers + 1 UBO for lighting)
+    std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
     
-    // Binding 4: Material texture (roughness, metalness, AO)
-    bindings[4].binding = 4;
-    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    // Bindings 0-4: Samplers (Color, Normal, Depth, Material, SSAO)
+    for(int i=0; i<5; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+    
+    // Binding 5: Lighting UBO (dynamic, lives in the frame allocator)
+    bindings[5].binding = 5;
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[5].descriptorCount = 1;
+    bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[5].pImmutableSamplers = nullptr;
+    
+    createCompositionLayout(bindings.data(), static_cast<uint32_t>(bindings.size()), lightingSetLayout);
+    m_pipeline = getPipeline(ShaderPermutation{});
+}
+
+void VulkanPipeline::createSubpassCompositionPipeline(
+    VkRenderPass renderPass,
+    uint32_t subpass,
+    const std::string& vertShaderPath,
+    const std::string& fragShaderPath,
+    VkDescriptorSetLayout lightingSetLayout) {
+    
+    m_kind = PipelineKind::Composition;
+    m_renderPass = renderPass;
+    m_subpass = subpass;
+    m_vertShaderPath = vertShaderPath;
+    m_fragShaderPath = fragShaderPath;
+    m_attachmentCount = 1;
+    
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+    
+    // Bindings 0-3: Input attachments (Color, Normal, Depth, Material)
+    for (uint32_t i = 0; i < 4; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+    
+    // Binding 5: Lighting UBO, as in the separate composition pass
+    bindings[4].binding = 5;
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     bindings[4].descriptorCount = 1;
     bindings[4].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     bindings[4].pImmutableSamplers = nullptr;
     
+    createCompositionLayout(bindings.data(), static_cast<uint32_t>(bindings.size()), lightingSetLayout);
+    m_pipeline = getPipeline(ShaderPermutation{});
+}
+
+void VulkanPipeline::createCompositionLayout(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount,
+                                             VkDescriptorSetLayout lightingSetLayout) {
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
+    layoutInfo.bindingCount = bindingCount;
+    layoutInfo.pBindings = bindings;
     
     if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create descriptor set layout!");
+        throw std::runtime_error("failed to create composition descriptor set layout!");
     }
     
-    // Push constants for per-sprite data
+    // Push constant range for gamma, then the light culling tiles per row; debug view and SSAO
+    // are specialization constants
     VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     pushConstantRange.offset = 0;
-    pushConstantRange.size = 128; // Enough for transform matrix + params
+    pushConstantRange.size = sizeof(float) + sizeof(uint32_t);
+    
+    // Set 0: G-buffer and lighting UBO, set 1: lights and tile lists
+    std::array<VkDescriptorSetLayout, 2> setLayouts = {m_descriptorSetLayout, lightingSetLayout};
     
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
     pipelineLayoutInfo.pushConstantRangeCount = 1;
     pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
     
     if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
-    
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;  // CRITICAL: Enable depth testing!
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
-    
-    if (vkCreateGraphicsPipelines(m_context.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
+        throw std::runtime_error("failed to create composition pipeline layout!");
     }
-    
-    vkDestroyShaderModule(m_context.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_context.getDevice(), vertShaderModule, nullptr);
 }
 
-void VulkanPipeline::createCompositionPipeline(
-    VkRenderPass renderPass,
-    const std::string& vertShaderPath,
-    const std::string& fragShaderPath,
-    VkExtent2D extent) {
-    
-    auto vertShaderCode = readFile(vertShaderPath);
-    auto fragShaderCode = readFile(fragShaderPath);
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+VkPipeline VulkanPipeline::compileCompositionPipeline(const VkSpecializationInfo& specialization) {
+    // Modules are owned by the context's pipeline cache and shared with other pipelines
+    VkShaderModule vertShaderModule = m_context.getPipelineCache().loadShaderModule(m_vertShaderPath);
+    VkShaderModule fragShaderModule = m_context.getPipelineCache().loadShaderModule(m_fragShaderPath);
     
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -270,6 +333,7 @@ void VulkanPipeline::createCompositionPipeline(
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = &specialization;
     
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
     
@@ -282,24 +346,17 @@ void VulkanPipeline::createCompositionPipeline(
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float) extent.width;
-    viewport.height = (float) extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = extent;
-    
+    // Set at record time (setViewport())
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
     
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -327,51 +384,6 @@ void VulkanPipeline::createCompositionPipeline(
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
     
-    // Descriptor set layout - 6 bindings (5 Samplers + 1 UBO for lighting)
-    std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
-    
-    // Bindings 0-4: Samplers (Color, Normal, Depth, Material, SSAO)
-    for(int i=0; i<5; i++) {
-        bindings[i].binding = i;
-        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        bindings[i].descriptorCount = 1;
-        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-        bindings[i].pImmutableSamplers = nullptr;
-    }
-    
-    // Binding 5: Lighting UBO
-    bindings[5].binding = 5;
-    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    bindings[5].descriptorCount = 1;
-    bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    bindings[5].pImmutableSamplers = nullptr;
-    
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-    
-    if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create composition descriptor set layout!");
-    }
-    
-    // Push constant range for debug view mode + enableSSAO + gamma (2 ints + 1 float = 12 bytes)
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(int) * 2 + sizeof(float);  // debugViewMode + enableSSAO + gamma
-    
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-   pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-    
-    if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create composition pipeline layout!");
-    }
-    
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount = 2;
@@ -382,23 +394,67 @@ void VulkanPipeline::createCompositionPipeline(
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
-    pipelineInfo.subpass = 0;
+    pipelineInfo.renderPass = m_renderPass;
+    pipelineInfo.subpass = m_subpass;
     
-    if (vkCreateGraphicsPipelines(m_context.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create composition pipeline!");
     }
     
-    vkDestroyShaderModule(m_context.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_context.getDevice(), vertShaderModule, nullptr);
+    return pipeline;
+}
+
+VkPipeline VulkanPipeline::getPipeline(const ShaderPermutation& permutation) {
+    auto it = m_permutations.find(permutation);
+    if (it != m_permutations.end()) {
+        return it->second;
+    }
+    
+    // Every slot is mapped; entries for constant IDs a shader doesn't declare are ignored
+    std::array<VkSpecializationMapEntry, SPECIALIZATION_CONSTANT_COUNT> mapEntries{};
+    for (uint32_t i = 0; i < SPECIALIZATION_CONSTANT_COUNT; i++) {
+        mapEntries[i].constantID = i;
+        mapEntries[i].offset = i * sizeof(uint32_t);
+        mapEntries[i].size = sizeof(uint32_t);
+    }
+    
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specialization.pMapEntries = mapEntries.data();
+    specialization.dataSize = sizeof(ShaderPermutation);
+    specialization.pData = permutation.data();
+    
+    VkPipeline pipeline = m_kind == PipelineKind::GBuffer ? compileGraphicsPipeline(specialization)
+                                                          : compileCompositionPipeline(specialization);
+    m_permutations.emplace(permutation, pipeline);
+    return pipeline;
+}
+
+void VulkanPipeline::setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float) extent.width;
+    viewport.height = (float) extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = extent;
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
 void VulkanPipeline::cleanup() {
-    if (m_pipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_context.getDevice(), m_pipeline, nullptr);
-        m_pipeline = VK_NULL_HANDLE;
+    for (auto& [permutation, pipeline] : m_permutations) {
+        vkDestroyPipeline(m_context.getDevice(), pipeline, nullptr);
     }
+    m_permutations.clear();
+    m_pipeline = VK_NULL_HANDLE;
     if (m_pipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_context.getDevice(), m_pipelineLayout, nullptr);
         m_pipelineLayout = VK_NULL_HANDLE;
@@ -0,0 +1,178 @@
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x43504B44;   // "DKPC"
+constexpr uint32_t CACHE_VERSION = 1;
+
+// FNV-1a; catches truncated or corrupted files, which some drivers crash on
+uint64_t checksum(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+} // namespace
+
+VulkanPipelineCache::VulkanPipelineCache(VulkanContext& context) : m_context(context) {
+}
+
+VulkanPipelineCache::~VulkanPipelineCache() {
+    cleanup();
+}
+
+void VulkanPipelineCache::init(const std::string& filepath) {
+    m_filepath = filepath;
+    std::vector<uint8_t> initialData = loadFromDisk();
+    
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = initialData.size();
+    cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    
+    if (vkCreatePipelineCache(m_context.getDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+        // The driver rejected the data after all; an empty cache still works
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(m_context.getDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+}
+
+void VulkanPipelineCache::cleanup() {
+    if (m_cache != VK_NULL_HANDLE) {
+        save();
+        vkDestroyPipelineCache(m_context.getDevice(), m_cache, nullptr);
+        m_cache = VK_NULL_HANDLE;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_moduleMutex);
+    for (auto& [path, module] : m_shaderModules) {
+        vkDestroyShaderModule(m_context.getDevice(), module, nullptr);
+    }
+    m_shaderModules.clear();
+}
+
+VulkanPipelineCache::FileHeader VulkanPipelineCache::makeHeader() const {
+    const VkPhysicalDeviceProperties& properties = m_context.getDeviceProperties();
+    
+    FileHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+    return header;
+}
+
+std::vector<uint8_t> VulkanPipelineCache::loadFromDisk() const {
+    std::ifstream file(m_filepath, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+    
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    file.seekg(0);
+    
+    FileHeader header{};
+    if (fileSize < sizeof(FileHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return {};
+    }
+    
+    // Another GPU, a driver update or an engine-side format change all invalidate the cache
+    FileHeader expected = makeHeader();
+    if (header.magic != expected.magic || header.version != expected.version ||
+        header.vendorID != expected.vendorID || header.deviceID != expected.deviceID ||
+        header.driverVersion != expected.driverVersion ||
+        memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+        header.dataSize != fileSize - sizeof(FileHeader)) {
+        std::cout << "Pipeline cache " << m_filepath << " is stale, rebuilding" << std::endl;
+        return {};
+    }
+    
+    std::vector<uint8_t> data(static_cast<size_t>(header.dataSize));
+    if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+        checksum(data.data(), data.size()) != header.checksum) {
+        std::cout << "Pipeline cache " << m_filepath << " is corrupt, rebuilding" << std::endl;
+        return {};
+    }
+    
+    return data;
+}
+
+bool VulkanPipelineCache::save() {
+    if (m_cache == VK_NULL_HANDLE || m_filepath.empty()) {
+        return false;
+    }
+    
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_context.getDevice(), m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+        return false;
+    }
+    std::vector<uint8_t> data(dataSize);
+    if (vkGetPipelineCacheData(m_context.getDevice(), m_cache, &dataSize, data.data()) != VK_SUCCESS) {
+        return false;
+    }
+    data.resize(dataSize);
+    
+    FileHeader header = makeHeader();
+    header.dataSize = data.size();
+    header.checksum = checksum(data.data(), data.size());
+    
+    std::string tempPath = m_filepath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            std::cerr << "Failed to write pipeline cache " << tempPath << std::endl;
+            return false;
+        }
+    }
+    
+    std::remove(m_filepath.c_str());
+    return std::rename(tempPath.c_str(), m_filepath.c_str()) == 0;
+}
+
+VkShaderModule VulkanPipelineCache::loadShaderModule(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_moduleMutex);
+    
+    auto it = m_shaderModules.find(filepath);
+    if (it != m_shaderModules.end()) {
+        return it->second;
+    }
+    
+    std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open file: " + filepath);
+    }
+    
+    // uint32_t storage keeps the code aligned as VkShaderModuleCreateInfo requires
+    size_t fileSize = static_cast<size_t>(file.tellg());
+    std::vector<uint32_t> code((fileSize + 3) / 4);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(fileSize));
+    
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = fileSize;
+    createInfo.pCode = code.data();
+    
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(m_context.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create shader module!");
+    }
+    
+    m_shaderModules[filepath] = shaderModule;
+    return shaderModule;
+}
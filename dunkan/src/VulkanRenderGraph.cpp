@@ -0,0 +1,584 @@
+#include "vulkan/VulkanRenderGraph.hpp"
+#include "vulkan/VulkanGpuProfiler.hpp"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+struct UsageInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags readAccess;
+    VkAccessFlags writeAccess;
+    VkImageLayout layout;   // UNDEFINED for buffers
+};
+
+UsageInfo getUsageInfo(RenderGraphUsage usage) {
+    switch (usage) {
+    case RenderGraphUsage::ColorAttachment:
+        return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+    case RenderGraphUsage::DepthAttachment:
+        return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+    case RenderGraphUsage::SampledFragment:
+        return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    case RenderGraphUsage::SampledCompute:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    case RenderGraphUsage::General:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL};
+    case RenderGraphUsage::StorageRead:
+        return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED};
+    case RenderGraphUsage::StorageWrite:
+        return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+    }
+    throw std::invalid_argument("unknown render graph usage!");
+}
+
+bool overlaps(uint32_t firstA, uint32_t lastA, uint32_t firstB, uint32_t lastB) {
+    return firstA <= lastB && firstB <= lastA;
+}
+
+} // namespace
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::read(RenderGraphResource resource,
+                                                                     RenderGraphUsage usage) {
+    m_graph.addUse(m_pass, resource, usage, true, false);
+    return *this;
+}
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::write(RenderGraphResource resource,
+                                                                      RenderGraphUsage usage) {
+    m_graph.addUse(m_pass, resource, usage, false, true);
+    return *this;
+}
+
+VulkanRenderGraph::PassBuilder& VulkanRenderGraph::PassBuilder::readWrite(RenderGraphResource resource,
+                                                                          RenderGraphUsage usage) {
+    m_graph.addUse(m_pass, resource, usage, true, true);
+    return *this;
+}
+
+VulkanRenderGraph::VulkanRenderGraph(VulkanContext& context) : m_context(context) {
+}
+
+VulkanRenderGraph::~VulkanRenderGraph() {
+    cleanup();
+}
+
+RenderGraphResource VulkanRenderGraph::addResource(Resource resource) {
+    m_resources.push_back(std::move(resource));
+    return static_cast<RenderGraphResource>(m_resources.size() - 1);
+}
+
+RenderGraphResource VulkanRenderGraph::createImage(const std::string& name, const ImageDesc& desc) {
+    if (m_placed) {
+        throw std::runtime_error("render graph images must be created before the first compile!");
+    }
+
+    Resource resource;
+    resource.name = name;
+    resource.type = ResourceType::Transient;
+    resource.desc = desc;
+    resource.aspect = desc.aspect;
+    // Memory is bound once the first compile knows which images can share it
+    resource.transientImage = new VulkanImage(m_context);
+    resource.transientImage->createUnboundRenderTarget(desc.width, desc.height, desc.format, desc.usage);
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource VulkanRenderGraph::importImage(const std::string& name, VkImageLayout restingLayout,
+                                                   VkImageAspectFlags aspect) {
+    Resource resource;
+    resource.name = name;
+    resource.type = ResourceType::Imported;
+    resource.aspect = aspect;
+    resource.restingLayout = restingLayout;
+    resource.resting.layout = restingLayout;
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource VulkanRenderGraph::importSwapchainImage(const std::string& name, VkImageLayout finalLayout) {
+    Resource resource;
+    resource.name = name;
+    resource.type = ResourceType::Swapchain;
+    resource.restingLayout = finalLayout;
+    resource.output = true;
+    // A different image every frame, available once the acquire semaphore's wait at
+    // COLOR_ATTACHMENT_OUTPUT is over
+    resource.resting.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.resting.writeStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    return addResource(std::move(resource));
+}
+
+RenderGraphResource VulkanRenderGraph::importBuffer(const std::string& name) {
+    Resource resource;
+    resource.name = name;
+    resource.type = ResourceType::Buffer;
+    return addResource(std::move(resource));
+}
+
+void VulkanRenderGraph::markOutput(RenderGraphResource resource) {
+    m_resources[resource].output = true;
+}
+
+void VulkanRenderGraph::setImage(RenderGraphResource resource, VkImage image) {
+    m_resources[resource].image = image;
+}
+
+VulkanImage* VulkanRenderGraph::getImage(RenderGraphResource resource) const {
+    return m_resources[resource].transientImage;
+}
+
+VulkanRenderGraph::PassBuilder VulkanRenderGraph::addPass(const std::string& name,
+                                                          std::function<void(VkCommandBuffer)> record) {
+    Pass pass;
+    pass.name = name;
+    pass.record = std::move(record);
+    m_passes.push_back(std::move(pass));
+    m_compiled = false;
+    return PassBuilder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+}
+
+void VulkanRenderGraph::addUse(uint32_t pass, RenderGraphResource resource, RenderGraphUsage usage,
+                               bool read, bool write) {
+    UsageInfo info = getUsageInfo(usage);
+    bool isImage = m_resources[resource].type != ResourceType::Buffer;
+    if (isImage != (info.layout != VK_IMAGE_LAYOUT_UNDEFINED)) {
+        throw std::invalid_argument("render graph usage doesn't match the type of " + m_resources[resource].name + "!");
+    }
+
+    VkAccessFlags access = (read ? info.readAccess : 0) | (write ? info.writeAccess : 0);
+
+    // Several uses of one resource become one: a single barrier has to cover all of them
+    for (Use& use : m_passes[pass].uses) {
+        if (use.resource == resource) {
+            if (use.layout != info.layout) {
+                throw std::invalid_argument("pass " + m_passes[pass].name + " uses " +
+                                            m_resources[resource].name + " in two layouts!");
+            }
+            use.stages |= info.stages;
+            use.access |= access;
+            use.read = use.read || read;
+            use.write = use.write || write;
+            return;
+        }
+    }
+    m_passes[pass].uses.push_back({resource, info.stages, access, info.layout, read, write});
+}
+
+void VulkanRenderGraph::reset() {
+    m_passes.clear();
+    m_steps.clear();
+    m_compiled = false;
+}
+
+void VulkanRenderGraph::compile() {
+    if (!m_placed) {
+        placeTransientImages();
+    }
+    cull();
+    checkAliasing();
+    buildSteps();
+    m_compiled = true;
+}
+
+void VulkanRenderGraph::cull() {
+    // Walk back from the outputs: a pass runs if a later pass (or the frame) needs something it writes
+    std::vector<bool> needed(m_resources.size(), false);
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        needed[i] = m_resources[i].output;
+    }
+
+    for (size_t i = m_passes.size(); i-- > 0;) {
+        Pass& pass = m_passes[i];
+        pass.culled = std::none_of(pass.uses.begin(), pass.uses.end(),
+                                   [&](const Use& use) { return use.write && needed[use.resource]; });
+        if (pass.culled) {
+            continue;
+        }
+        // Overwritten here, so earlier writers are only needed for what this pass reads
+        for (const Use& use : pass.uses) {
+            if (use.write && !use.read) {
+                needed[use.resource] = false;
+            }
+        }
+        for (const Use& use : pass.uses) {
+            if (use.read) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+void VulkanRenderGraph::placeTransientImages() {
+    // Lifetimes over every declared pass, culled or not, so later graphs can bring culled passes back
+    std::vector<RenderGraphResource> transients;
+    for (RenderGraphResource i = 0; i < m_resources.size(); i++) {
+        if (m_resources[i].type == ResourceType::Transient) {
+            transients.push_back(i);
+        }
+    }
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        for (const Use& use : m_passes[p].uses) {
+            Resource& resource = m_resources[use.resource];
+            if (resource.type == ResourceType::Transient) {
+                resource.firstPass = std::min(resource.firstPass, p);
+                resource.lastPass = std::max(resource.lastPass, p);
+            }
+        }
+    }
+    for (RenderGraphResource i : transients) {
+        // Not used yet: could be used anywhere later, keep it to itself
+        if (m_resources[i].firstPass == UINT32_MAX) {
+            m_resources[i].firstPass = 0;
+            m_resources[i].lastPass = UINT32_MAX;
+        }
+    }
+
+    // Largest first, each into the first slot whose images are all dead during its lifetime
+    std::vector<VkMemoryRequirements> requirements(m_resources.size());
+    for (RenderGraphResource i : transients) {
+        requirements[i] = m_resources[i].transientImage->getMemoryRequirements();
+        m_unaliasedBytes += requirements[i].size;
+    }
+    std::stable_sort(transients.begin(), transients.end(), [&](RenderGraphResource a, RenderGraphResource b) {
+        return requirements[a].size > requirements[b].size;
+    });
+
+    for (RenderGraphResource i : transients) {
+        Resource& resource = m_resources[i];
+        const VkMemoryRequirements& required = requirements[i];
+
+        for (uint32_t s = 0; s < m_slots.size() && resource.slot == UINT32_MAX; s++) {
+            Slot& slot = m_slots[s];
+            if ((slot.requirements.memoryTypeBits & required.memoryTypeBits) == 0) {
+                continue;
+            }
+            bool free = std::none_of(slot.images.begin(), slot.images.end(), [&](RenderGraphResource other) {
+                return overlaps(resource.firstPass, resource.lastPass,
+                                m_resources[other].firstPass, m_resources[other].lastPass);
+            });
+            if (free) {
+                resource.slot = s;
+            }
+        }
+        if (resource.slot == UINT32_MAX) {
+            resource.slot = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+            m_slots.back().requirements.memoryTypeBits = required.memoryTypeBits;
+        }
+
+        Slot& slot = m_slots[resource.slot];
+        slot.requirements.size = std::max(slot.requirements.size, required.size);
+        slot.requirements.alignment = std::max(slot.requirements.alignment, required.alignment);
+        slot.requirements.memoryTypeBits &= required.memoryTypeBits;
+        slot.images.push_back(i);
+    }
+
+    // Every image of a slot starts at its beginning
+    for (Slot& slot : m_slots) {
+        slot.allocation = m_context.getAllocator().allocateImageMemory(slot.requirements,
+                                                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        m_transientBytes += slot.requirements.size;
+
+        for (RenderGraphResource i : slot.images) {
+            Resource& resource = m_resources[i];
+            resource.transientImage->bindMemory(slot.allocation.memory, slot.allocation.offset);
+            resource.transientImage->createImageView(resource.desc.format, resource.desc.aspect);
+            if (resource.desc.sampled) {
+                resource.transientImage->createSampler(resource.desc.samplerDesc);
+            }
+        }
+    }
+
+    std::cout << "Render graph: " << transients.size() << " transient images in " << m_slots.size()
+              << " allocations, " << m_transientBytes / (1024 * 1024) << " MB ("
+              << m_unaliasedBytes / (1024 * 1024) << " MB unaliased)" << std::endl;
+    m_placed = true;
+}
+
+void VulkanRenderGraph::checkAliasing() const {
+    // Lifetimes in this graph, over the passes that run
+    std::vector<uint32_t> first(m_resources.size(), UINT32_MAX);
+    std::vector<uint32_t> last(m_resources.size(), 0);
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        if (m_passes[p].culled) {
+            continue;
+        }
+        for (const Use& use : m_passes[p].uses) {
+            first[use.resource] = std::min(first[use.resource], p);
+            last[use.resource] = std::max(last[use.resource], p);
+        }
+    }
+
+    for (const Slot& slot : m_slots) {
+        for (size_t a = 0; a < slot.images.size(); a++) {
+            for (size_t b = a + 1; b < slot.images.size(); b++) {
+                RenderGraphResource imageA = slot.images[a];
+                RenderGraphResource imageB = slot.images[b];
+                if (first[imageA] != UINT32_MAX && first[imageB] != UINT32_MAX &&
+                    overlaps(first[imageA], last[imageA], first[imageB], last[imageB])) {
+                    throw std::runtime_error("render graph images " + m_resources[imageA].name + " and " +
+                                             m_resources[imageB].name + " share memory but are alive together!");
+                }
+            }
+        }
+    }
+}
+
+void VulkanRenderGraph::buildSteps() {
+    // The steps are replayed every frame, so they have to hold after the previous graph's last
+    // frame as well as after a frame of their own. Frames always begin with the same layouts
+    // (resting, undefined for transients), only the stages that touched things differ: simulate a
+    // frame to see where it leaves everything, then build the steps for either starting point
+    std::vector<SyncState> states(m_resources.size());
+    std::vector<SyncState> slotStates(m_slots.size());
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        states[i] = m_resources[i].resting;
+    }
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        slotStates[i] = m_slots[i].resting;
+    }
+
+    std::vector<SyncState> endStates = states;
+    std::vector<SyncState> endSlotStates = slotStates;
+    std::vector<Step> steps;
+    simulate(endStates, endSlotStates, steps);
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        // The swapchain image is a new one each frame and always starts from its acquire
+        if (m_resources[i].type != ResourceType::Swapchain) {
+            merge(states[i], endStates[i]);
+        }
+    }
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        merge(slotStates[i], endSlotStates[i]);
+    }
+
+    m_steps.clear();
+    simulate(states, slotStates, m_steps);
+
+    // Where the next graph starts from
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        if (m_resources[i].type != ResourceType::Swapchain) {
+            m_resources[i].resting = states[i];
+        }
+    }
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        m_slots[i].resting = slotStates[i];
+    }
+}
+
+void VulkanRenderGraph::simulate(std::vector<SyncState>& states, std::vector<SyncState>& slotStates,
+                                 std::vector<Step>& steps) {
+    std::vector<bool> touched(m_resources.size(), false);
+
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        const Pass& pass = m_passes[p];
+        if (pass.culled) {
+            continue;
+        }
+
+        Step step;
+        step.pass = p;
+        step.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        for (const Use& use : pass.uses) {
+            Resource& resource = m_resources[use.resource];
+            SyncState& state = states[use.resource];
+
+            if (!touched[use.resource]) {
+                touched[use.resource] = true;
+                if (resource.type == ResourceType::Transient) {
+                    // Contents never survive the frame; wait for whatever used the memory last
+                    state = slotStates[resource.slot];
+                    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                } else if (resource.type == ResourceType::Imported && !use.read) {
+                    // Fully overwritten, the old contents can be discarded
+                    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                }
+            }
+
+            synchronize(step, use, state);
+
+            if (resource.type == ResourceType::Transient) {
+                slotStates[resource.slot] = state;
+            }
+        }
+        steps.push_back(std::move(step));
+    }
+
+    // Leave imported images in their resting layout for the next frame (and the presentation engine)
+    Step closing;
+    closing.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    for (RenderGraphResource i = 0; i < m_resources.size(); i++) {
+        Resource& resource = m_resources[i];
+        bool resting = resource.type == ResourceType::Imported || resource.type == ResourceType::Swapchain;
+        if (!resting || !touched[i] || states[i].layout == resource.restingLayout) {
+            continue;
+        }
+        // Presentation waits on the frame's semaphore, later frames on the transition itself;
+        // a swapchain image read back instead is made available to its final layout's stage
+        VkPipelineStageFlags stages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        VkAccessFlags access = 0;
+        if (resource.type == ResourceType::Swapchain) {
+            VulkanImage::getLayoutUsage(resource.restingLayout, stages, access);
+        }
+        Use use{i, stages, access, resource.restingLayout, true, false};
+        synchronize(closing, use, states[i]);
+    }
+    if (!closing.imageBarriers.empty()) {
+        steps.push_back(std::move(closing));
+    }
+
+    for (RenderGraphResource i = 0; i < m_resources.size(); i++) {
+        if (m_resources[i].type == ResourceType::Transient) {
+            states[i].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+    }
+}
+
+void VulkanRenderGraph::synchronize(Step& step, const Use& use, SyncState& state) {
+    const Resource& resource = m_resources[use.resource];
+    bool isImage = resource.type != ResourceType::Buffer;
+    bool transition = isImage && state.layout != use.layout;
+
+    // Writes wait for earlier reads and writes; reads for a write not yet visible to their stages
+    bool hazard = use.write
+        ? (state.writeStages | state.readStages) != 0
+        : state.writeStages != 0 && (use.stages & ~state.visibleStages) != 0;
+
+    if (transition || hazard) {
+        VkPipelineStageFlags srcStages = state.writeStages;
+        if (use.write || transition) {
+            srcStages |= state.readStages;
+        }
+        step.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        step.dstStages |= use.stages;
+
+        if (isImage) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = state.writeAccess;
+            barrier.dstAccessMask = use.access;
+            barrier.oldLayout = state.layout;
+            barrier.newLayout = use.layout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = resource.aspect;
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+            step.imageBarriers.push_back({use.resource, barrier});
+        } else {
+            step.memoryBarrier.srcAccessMask |= state.writeAccess;
+            step.memoryBarrier.dstAccessMask |= use.access;
+        }
+    }
+
+    if (use.write) {
+        state.writeStages = use.stages;
+        state.writeAccess = use.access & ~(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                           VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT);
+        state.readStages = 0;
+        state.visibleStages = 0;
+    } else if (transition) {
+        // The transition is a write the reading stages already waited for
+        state.writeStages = use.stages;
+        state.writeAccess = 0;
+        state.readStages = use.stages;
+        state.visibleStages = use.stages;
+    } else {
+        state.readStages |= use.stages;
+        if (hazard) {
+            state.visibleStages |= use.stages;
+        }
+    }
+    if (isImage) {
+        state.layout = use.layout;
+    }
+}
+
+void VulkanRenderGraph::merge(SyncState& state, const SyncState& other) {
+    // Whatever either left to wait for, visible only where both made it visible
+    state.writeStages |= other.writeStages;
+    state.writeAccess |= other.writeAccess;
+    state.readStages |= other.readStages;
+    state.visibleStages &= other.visibleStages;
+}
+
+VkImage VulkanRenderGraph::getVkImage(const Resource& resource) const {
+    if (resource.type == ResourceType::Transient) {
+        return resource.transientImage->getImage();
+    }
+    if (resource.image == VK_NULL_HANDLE) {
+        throw std::runtime_error("render graph image " + resource.name + " was never set!");
+    }
+    return resource.image;
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer) {
+    if (!m_compiled) {
+        throw std::runtime_error("render graph executed without being compiled!");
+    }
+
+    for (const Step& step : m_steps) {
+        bool memory = step.memoryBarrier.srcAccessMask != 0 || step.memoryBarrier.dstAccessMask != 0;
+        if (memory || !step.imageBarriers.empty()) {
+            // Swapchain images change every frame, resolve handles now
+            m_barrierScratch.clear();
+            for (const Barrier& barrier : step.imageBarriers) {
+                m_barrierScratch.push_back(barrier.barrier);
+                m_barrierScratch.back().image = getVkImage(m_resources[barrier.resource]);
+            }
+            vkCmdPipelineBarrier(commandBuffer, step.srcStages,
+                                 step.dstStages != 0 ? step.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                 0, memory ? 1 : 0, &step.memoryBarrier, 0, nullptr,
+                                 static_cast<uint32_t>(m_barrierScratch.size()), m_barrierScratch.data());
+        } else if (step.srcStages != 0) {
+            // Execution dependency only (reads before a write)
+            vkCmdPipelineBarrier(commandBuffer, step.srcStages, step.dstStages,
+                                 0, 0, nullptr, 0, nullptr, 0, nullptr);
+        }
+
+        if (step.pass != UINT32_MAX) {
+            // After the pass's barriers, so waiting on earlier passes isn't counted as its own
+            const Pass& pass = m_passes[step.pass];
+            uint32_t scope = m_profiler != nullptr ? m_profiler->beginScope(commandBuffer, pass.name, true) : UINT32_MAX;
+            pass.record(commandBuffer);
+            if (m_profiler != nullptr) {
+                m_profiler->endScope(commandBuffer, scope);
+            }
+        }
+    }
+}
+
+bool VulkanRenderGraph::isPassCulled(const std::string& name) const {
+    for (const Pass& pass : m_passes) {
+        if (pass.name == name) {
+            return pass.culled;
+        }
+    }
+    return true;
+}
+
+void VulkanRenderGraph::cleanup() {
+    m_passes.clear();
+    m_steps.clear();
+    for (Resource& resource : m_resources) {
+        delete resource.transientImage;
+        resource.transientImage = nullptr;
+    }
+    m_resources.clear();
+    for (Slot& slot : m_slots) {
+        m_context.getAllocator().free(slot.allocation);
+    }
+    m_slots.clear();
+    m_placed = false;
+    m_compiled = false;
+}
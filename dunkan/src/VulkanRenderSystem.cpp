@@ -1,5 +1,10 @@
 #include "vulkan/VulkanRenderSystem.hpp"
+#include "vulkan/VulkanUploadManager.hpp"
+#include "utils/CpuProfiler.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include "game/types.hpp"
 
@@ -13,50 +18,32 @@ using VulkanRenderSystem_c = ADE::META_TYPES::Typelist<RenderComponent, PhysicsC
 using VulkanRenderSystem_t = ADE::META_TYPES::Typelist<>;
 
 VulkanRenderSystem::VulkanRenderSystem(VulkanContext& context, VulkanDescriptorManager& descriptorManager,
-                                       VulkanPipeline& pipeline, EntityManager& entityManager)
+                                       VulkanPipeline& pipeline, EntityManager& entityManager,
+                                       VulkanFrameAllocator& frameAllocator)
     : m_context(context), m_descriptorManager(descriptorManager),
-      m_pipeline(pipeline), m_entityManager(entityManager) {
+      m_pipeline(pipeline), m_entityManager(entityManager), m_frameAllocator(frameAllocator) {
     
     createDefaultTexture();
     
     // Create persistent quad vertex buffer
     std::vector<Vertex> quadVertices;
-    createQuadVertices(quadVertices, glm::vec2(1.0f, 1.0f)); // Unit quad, will scale with push constants
+    createQuadVertices(quadVertices, glm::vec2(1.0f, 1.0f)); // Unit quad, scaled by each instance's model matrix
     
     m_quadVertexBuffer = new VulkanBuffer(m_context);
     
-    VulkanBuffer stagingBuffer(m_context);
     VkDeviceSize bufferSize = quadVertices.size() * sizeof(Vertex);
-    stagingBuffer.create(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    stagingBuffer.copyFrom(quadVertices.data(), bufferSize);
-    
     m_quadVertexBuffer->create(bufferSize,
                               VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
                               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    stagingBuffer.copyTo(*m_quadVertexBuffer, bufferSize);
-    stagingBuffer.cleanup();
-    
-    // Create uniform buffer
-    bufferSize = sizeof(UniformBufferObject);
-    m_uniformBuffer = new VulkanBuffer(m_context);
-    m_uniformBuffer->create(bufferSize,
-                           VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    // Create lighting uniform buffer
-    m_lightingUBO = new VulkanBuffer(m_context);
-    m_lightingUBO->create(sizeof(void*) * 100,  // Placeholder size, will be set from main
-                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_context.getUploadManager().uploadBuffer(m_quadVertexBuffer->getBuffer(), quadVertices.data(), bufferSize);
     
     // Create descriptor sets for each frame
     m_descriptorSets.resize(MAX_FRAMES);
     for (int i = 0; i < MAX_FRAMES; i++) {
         m_descriptorSets[i] = m_descriptorManager.allocateDescriptorSet(m_pipeline.getDescriptorSetLayout());
         
-        m_descriptorManager.updateUniformBuffer(m_descriptorSets[i], 0,
-                                               m_uniformBuffer->getBuffer(), sizeof(UniformBufferObject));
+        m_descriptorManager.updateDynamicUniformBuffer(m_descriptorSets[i], 0,
+                                                      m_frameAllocator.getBuffer(), sizeof(UniformBufferObject));
         
         m_descriptorManager.updateTextureDescriptor(m_descriptorSets[i], 1,
                                                     m_defaultTexture->getImageView(),
@@ -74,17 +61,40 @@ VulkanRenderSystem::VulkanRenderSystem(VulkanContext& context, VulkanDescriptorM
 }
 
 VulkanRenderSystem::~VulkanRenderSystem() {
+    // Recorded uploads may still reference streamed images
+    m_context.getUploadManager().waitIdle();
+    
+    for (auto& pending : m_pendingMaterials) {
+        for (VulkanImage* image : pending->images) {
+            delete image;
+        }
+    }
+    m_pendingAtlases.clear();
+    m_atlases.clear();
+    for (auto& [name, texture] : m_textures) {
+        if (texture != m_defaultTexture) {
+            delete texture;
+        }
+    }
+    
     delete m_quadVertexBuffer;
-    delete m_uniformBuffer;
     delete m_defaultTexture;
     m_gbuffer.cleanup(m_context);
 }
 
-void VulkanRenderSystem::initGBuffer(VkRenderPass renderPass, VkExtent2D extent) {
+void VulkanRenderSystem::initGBuffer(VkRenderPass renderPass, VkExtent2D extent, GBufferLayout layout,
+                                     VulkanImage* depthStencil) {
     m_gbuffer.renderPass = renderPass;
-    m_gbuffer.create(m_context, extent.width, extent.height);
-    
-    // Create G-Buffer framebuffer
+    m_gbuffer.create(m_context, extent.width, extent.height, layout, false, depthStencil);
+    createGBufferFramebuffer();
+}
+
+void VulkanRenderSystem::resizeGBuffer(VkExtent2D extent, VulkanImage* depthStencil) {
+    m_gbuffer.recreate(m_context, extent.width, extent.height, depthStencil);
+    createGBufferFramebuffer();
+}
+
+void VulkanRenderSystem::createGBufferFramebuffer() {
     std::array<VkImageView, 5> attachments = {
         m_gbuffer.colorRT->getImageView(),
         m_gbuffer.normalRT->getImageView(),
@@ -95,11 +105,11 @@ void VulkanRenderSystem::initGBuffer(VkRenderPass renderPass, VkExtent2D extent)
     
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.renderPass = m_gbuffer.renderPass;
     framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
     framebufferInfo.pAttachments = attachments.data();
-    framebufferInfo.width = extent.width;
-    framebufferInfo.height = extent.height;
+    framebufferInfo.width = m_gbuffer.width;
+    framebufferInfo.height = m_gbuffer.height;
     framebufferInfo.layers = 1;
     
     if (vkCreateFramebuffer(m_context.getDevice(), &framebufferInfo, nullptr, &m_gbuffer.framebuffer) != VK_SUCCESS) {
@@ -126,16 +136,8 @@ void VulkanRenderSystem::createDefaultTexture() {
                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     
-    VulkanBuffer stagingBuffer(m_context);
-    stagingBuffer.create(pixels.size() * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    stagingBuffer.copyFrom(pixels.data(), pixels.size() * sizeof(uint32_t));
-    
-    m_defaultTexture->transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    m_defaultTexture->copyFromBuffer(stagingBuffer.getBuffer(), SIZE, SIZE);
-    m_defaultTexture->transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    stagingBuffer.cleanup();
+    m_context.getUploadManager().uploadImage(m_defaultTexture->getImage(), pixels.data(),
+                                             pixels.size() * sizeof(uint32_t), SIZE, SIZE);
     
     m_defaultTexture->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
     m_defaultTexture->createSampler();
@@ -155,31 +157,35 @@ void VulkanRenderSystem::createQuadVertices(std::vector<Vertex>& vertices, glm::
     };
 }
 
-void VulkanRenderSystem::prepareFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
-    // Update uniform buffer
+void VulkanRenderSystem::prepareFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::vec2& viewSize) {
+    // Write this frame's UBO into the frame allocator; the GPU may still be reading
+    // the previous frame's copy, so it never gets overwritten in place
     UniformBufferObject ubo{};
     ubo.view = glm::mat4(1.0f);
-    ubo.proj = glm::ortho(0.0f, 1920.0f, 1080.0f, 0.0f, -100.0f, 100.0f);
+    ubo.proj = glm::ortho(0.0f, viewSize.x, viewSize.y, 0.0f, -100.0f, 100.0f);
     
-    m_uniformBuffer->copyFrom(&ubo, sizeof(ubo));
+    m_uboOffset = m_frameAllocator.push(ubo);
     
-    // Bind pipeline (descriptor sets are bound per-entity in renderEntities)
+    // Bind pipeline (descriptor sets are bound per batch in renderEntities)
     // Note: We don't bind pipeline here anymore because renderEntities begins the render pass
     // and binding pipeline must happen inside a render pass.
 }
 
-void VulkanRenderSystem::renderEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+void VulkanRenderSystem::renderEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkExtent2D renderExtent) {
+    renderExtent.width = std::min(renderExtent.width, m_gbuffer.width);
+    renderExtent.height = std::min(renderExtent.height, m_gbuffer.height);
+    
     // Begin G-Buffer Render Pass
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = m_gbuffer.renderPass;
     renderPassInfo.framebuffer = m_gbuffer.framebuffer;
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = {m_gbuffer.width, m_gbuffer.height};
+    renderPassInfo.renderArea.extent = renderExtent;
     
     std::array<VkClearValue, 5> clearValues{};
     clearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Color (transparent)
-    clearValues[1].color = {{0.5f, 0.5f, 1.0f, 0.0f}}; // Normal (forward-facing default: unpacks to (0,0,1))
+    clearValues[1].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Normal (octahedral (0,0) decodes to forward-facing (0,0,1))
     clearValues[2].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Depth (no depth)
     clearValues[3].color = {{0.0f, 0.0f, 0.0f, 0.0f}}; // Material (no material)
     clearValues[4].depthStencil = {1.0f, 0};           // Depth/Stencil (far plane)
@@ -188,17 +194,37 @@ void VulkanRenderSystem::renderEntities(VkCommandBuffer commandBuffer, uint32_t
     renderPassInfo.pClearValues = clearValues.data();
     
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    VulkanPipeline::setViewport(commandBuffer, renderExtent);
     
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.getPipeline());
+    recordDraws(commandBuffer, frameIndex, m_pipeline);
     
-    // Bind the persistent quad vertex buffer once
-    VkBuffer vertexBuffers[] = {m_quadVertexBuffer->getBuffer()};
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdEndRenderPass(commandBuffer);
     
-    int entitiesRendered = 0;
+    // FPS counter only printed once per second in main loop
+}
+
+void VulkanRenderSystem::drawEntities(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    if (m_subpassPipeline == nullptr) {
+        throw std::runtime_error("drawEntities called without a subpass pipeline!");
+    }
+    recordDraws(commandBuffer, frameIndex, *m_subpassPipeline);
+}
+
+void VulkanRenderSystem::setSubpassPipeline(VulkanPipeline* pipeline) {
+    m_subpassPipeline = pipeline;
+    if (m_subpassPipeline != nullptr) {
+        for (const auto& [name, permutation] : m_texturePermutations) {
+            m_subpassPipeline->getPipeline(permutation);
+        }
+    }
+}
+
+void VulkanRenderSystem::recordDraws(VkCommandBuffer commandBuffer, uint32_t frameIndex, VulkanPipeline& pipeline) {
+    PROFILE_SCOPE("VulkanRenderSystem::recordDraws");
     
-    // Use foreach to iterate entities with RenderComponent and PhysicsComponent
+    // Gather one instance per entity with RenderComponent and PhysicsComponent
+    m_drawItems.clear();
+    m_drawCallCount = 0;
     m_entityManager.foreach<VulkanRenderSystem_c, VulkanRenderSystem_t>
     ([&](Entity&, RenderComponent& renderComp, PhysicsComponent& physicsComp)
     {
@@ -209,171 +235,349 @@ void VulkanRenderSystem::renderEntities(VkCommandBuffer commandBuffer, uint32_t
         if (size.x <= 0) size.x = 100.0f;
         if (size.y <= 0) size.y = 100.0f;
         
-        // Get descriptor set for this entity's texture
+        // Descriptor set of the entity's texture or atlas page, and its rect in that page
         VkDescriptorSet descriptorSet = m_descriptorSets[frameIndex]; // Default
+        ShaderPermutation permutation{};
+        glm::vec4 spriteRect(0.0f, 0.0f, 1.0f, 1.0f);
         if (!renderComp.albedoTextureName.empty()) {
             auto it = m_textureDescriptorSets.find(renderComp.albedoTextureName);
             if (it != m_textureDescriptorSets.end()) {
                 descriptorSet = it->second;
             }
+            auto features = m_texturePermutations.find(renderComp.albedoTextureName);
+            if (features != m_texturePermutations.end()) {
+                permutation = features->second;
+            }
+            auto rect = m_spriteRects.find(renderComp.albedoTextureName);
+            if (rect != m_spriteRects.end()) {
+                spriteRect = rect->second;
+            }
         }
         
-        // Bind the correct descriptor set for this entity
-        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                               m_pipeline.getLayout(), 0, 1, &descriptorSet, 0, nullptr);
+        // Height and material maps only apply when the entity asks for them,
+        // otherwise its own height and PBR values are used
+        if (renderComp.depthTextureName.empty()) {
+            permutation[DEPTH_MAP] = 0;
+        }
+        if (renderComp.materialTextureName.empty()) {
+            permutation[MATERIAL_MAP] = 0;
+        }
         
-        // Push constants for transform
-        struct PushConstants {
-            glm::mat4 model;
-            float z_position;
-            float height;
-            int useDepthMap;
-            float roughness;
-            float metalness;
-            float translucency;
-            int useMaterialMap; // Whether to use material texture or push constant values
-        } pushConstants;
+        DrawItem item;
+        item.pipeline = pipeline.getPipeline(permutation);
+        item.descriptorSet = descriptorSet;
         
+        SpriteInstance& instance = item.instance;
         // Apply scale and translate
-        pushConstants.model = glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f)) *
-                             glm::scale(glm::mat4(1.0f), glm::vec3(size.x * renderComp.scale, 
-                                                                    size.y * renderComp.scale, 1.0f));
-        pushConstants.z_position = physicsComp.z;
-        pushConstants.height = renderComp.height;
-        pushConstants.useDepthMap = (!renderComp.depthTextureName.empty()) ? 1 : 0;
-        pushConstants.roughness = renderComp.roughness;
-        pushConstants.metalness = renderComp.metalness;
-        pushConstants.translucency = renderComp.translucency;
-        pushConstants.useMaterialMap = (!renderComp.materialTextureName.empty()) ? 1 : 0;
-        
-        vkCmdPushConstants(commandBuffer, m_pipeline.getLayout(),
-                          VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                          0, sizeof(pushConstants), &pushConstants);
+        instance.model = glm::translate(glm::mat4(1.0f), glm::vec3(position, 0.0f)) *
+                         glm::scale(glm::mat4(1.0f), glm::vec3(size.x * renderComp.scale,
+                                                               size.y * renderComp.scale, 1.0f));
+        // The entity's own sub-rect, mapped into the sprite's rect
+        glm::vec2 origin(spriteRect.x, spriteRect.y);
+        glm::vec2 extent(spriteRect.z - spriteRect.x, spriteRect.w - spriteRect.y);
+        instance.uvRect = glm::vec4(origin + glm::vec2(renderComp.uvRect.x, renderComp.uvRect.y) * extent,
+                                    origin + glm::vec2(renderComp.uvRect.z, renderComp.uvRect.w) * extent);
+        instance.params = glm::vec4(physicsComp.z, renderComp.height, renderComp.roughness, renderComp.metalness);
+        instance.flags = glm::vec4(renderComp.translucency, 0.0f, 0.0f, 0.0f);
         
-        vkCmdDraw(commandBuffer, 6, 1, 0, 0);
-        entitiesRendered++;
+        m_drawItems.push_back(item);
     });
     
-    vkCmdEndRenderPass(commandBuffer);
-    
-    // FPS counter only printed once per second in main loop
+    if (!m_drawItems.empty()) {
+        // One draw per permutation and descriptor set (atlas page or standalone texture). Stable, so
+        // entities keep their order inside a batch; visibility between batches is settled by the depth test
+        std::stable_sort(m_drawItems.begin(), m_drawItems.end(), [](const DrawItem& a, const DrawItem& b) {
+            if (a.pipeline != b.pipeline) {
+                return a.pipeline < b.pipeline;
+            }
+            return a.descriptorSet < b.descriptorSet;
+        });
+        
+        VulkanFrameAllocator::Allocation instances =
+            m_frameAllocator.allocate(m_drawItems.size() * sizeof(SpriteInstance), alignof(SpriteInstance));
+        SpriteInstance* instanceData = static_cast<SpriteInstance*>(instances.data);
+        for (size_t i = 0; i < m_drawItems.size(); i++) {
+            instanceData[i] = m_drawItems[i].instance;
+        }
+        
+        // Persistent quad in binding 0, this frame's instances in binding 1
+        VkBuffer vertexBuffers[] = {m_quadVertexBuffer->getBuffer(), instances.buffer};
+        VkDeviceSize offsets[] = {0, instances.offset};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+        
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        for (size_t first = 0; first < m_drawItems.size();) {
+            size_t last = first + 1;
+            while (last < m_drawItems.size() && m_drawItems[last].pipeline == m_drawItems[first].pipeline &&
+                   m_drawItems[last].descriptorSet == m_drawItems[first].descriptorSet) {
+                last++;
+            }
+            
+            if (m_drawItems[first].pipeline != boundPipeline) {
+                boundPipeline = m_drawItems[first].pipeline;
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+            }
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                   pipeline.getLayout(), 0, 1, &m_drawItems[first].descriptorSet, 1, &m_uboOffset);
+            vkCmdDraw(commandBuffer, 6, static_cast<uint32_t>(last - first), 0, static_cast<uint32_t>(first));
+            m_drawCallCount++;
+            first = last;
+        }
+    }
 }
 
 void VulkanRenderSystem::loadTexture(const std::string& name, const std::string& filepath, 
                                      const std::string& depthFilepath,
                                      const std::string& normalFilepath,
                                      const std::string& materialFilepath) {
-    std::cout << "VulkanRenderSystem::loadTexture called for " << name << std::endl;
-    // Check if already loaded
+    PROFILE_SCOPE("VulkanRenderSystem::loadTexture");
+    
+    // Check if already loaded or in flight
     if (m_textures.find(name) != m_textures.end()) {
         std::cout << "Texture '" << name << "' already loaded, skipping." << std::endl;
         return;
     }
+    for (const auto& pending : m_pendingMaterials) {
+        if (pending->name == name) {
+            return;
+        }
+    }
+    
+    auto material = std::make_unique<PendingMaterial>();
+    material->name = name;
+    material->filepaths = {filepath, depthFilepath, normalFilepath, materialFilepath};
     
-    std::cout << "Creating VulkanImage..." << std::endl;
-    try {
-        // Load albedo texture
-        VulkanImage* texture = new VulkanImage(m_context);
-        std::cout << "Loading albedo from file: " << filepath << std::endl;
-        texture->loadFromFile(filepath);
-        std::cout << "Creating image view..." << std::endl;
-        texture->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-        std::cout << "Creating sampler..." << std::endl;
-        texture->createSampler();
+    // Cooked KTX2 (tools/texture_cooker) next to the PNG is used when BC can be sampled
+    bool useCooked = m_context.supportsBlockCompression();
+    
+    for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+        if (material->filepaths[i].empty()) {
+            continue;
+        }
         
-        m_textures[name] = texture;
+        std::string path = material->filepaths[i];
+        VkFormat format = MATERIAL_MAP_FORMATS[i];
+        uint32_t channels = MATERIAL_MAP_CHANNELS[i];
+        // Mips are blitted during the upload when the queue allows it, otherwise the loader
+        // threads build them so the main thread never does
+        bool cpuMips = !m_context.getUploadManager().canBlitMips(format);
         
-        // Load depth texture if provided
-        VulkanImage* depthTexture = m_defaultTexture;
-        if (!depthFilepath.empty()) {
-            VulkanImage* dTex = new VulkanImage(m_context);
-            try {
-                dTex->loadFromFile(depthFilepath);
-                dTex->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-                dTex->createSampler();
-                depthTexture = dTex;
-                m_textures[name + "_depth_internal"] = dTex;
-            } catch (...) {
-                std::cerr << "Failed to load depth texture: " << depthFilepath << ", using default." << std::endl;
-                delete dTex;
+        material->decoded[i] = m_loaderPool.submit([path, format, channels, cpuMips, useCooked] {
+            PROFILE_THREAD("loader");
+            VulkanImage::ImageData data;
+            if (useCooked &&
+                VulkanImage::decodeKtx2(std::filesystem::path(path).replace_extension(".ktx2").string(), data)) {
+                return data;
             }
-        }
-        
-        // Load normal texture if provided
-        VulkanImage* normalTexture = m_defaultTexture;
-        if (!normalFilepath.empty()) {
-            VulkanImage* nTex = new VulkanImage(m_context);
-            try {
-                std::cout << "Loading normal from file: " << normalFilepath << std::endl;
-                nTex->loadFromFile(normalFilepath);
-                nTex->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-                nTex->createSampler();
-                normalTexture = nTex;
-                m_textures[name + "_normal_internal"] = nTex;
-            } catch (...) {
-                std::cerr << "Failed to load normal texture: " << normalFilepath << ", using default." << std::endl;
-                delete nTex;
+            if (VulkanImage::decodeFile(path, data, channels) && cpuMips) {
+                VulkanImage::generateMips(data, VulkanImage::isSrgbFormat(format));
             }
-        }
+            return data;
+        });
+    }
+    
+    std::cout << "Queued texture load: " << name << " from " << filepath << std::endl;
+    m_pendingMaterials.push_back(std::move(material));
+}
+
+void VulkanRenderSystem::updateStreaming() {
+    PROFILE_SCOPE("VulkanRenderSystem::updateStreaming");
+    
+    for (auto it = m_pendingMaterials.begin(); it != m_pendingMaterials.end();) {
+        PendingMaterial& material = **it;
         
-        // Load material texture if provided
-        VulkanImage* materialTexture = m_defaultTexture;
-        if (!materialFilepath.empty()) {
-            VulkanImage* mTex = new VulkanImage(m_context);
-            try {
-                std::cout << "Loading material from file: " << materialFilepath << std::endl;
-                mTex->loadFromFile(materialFilepath);
-                mTex->createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
-                mTex->createSampler();
-                materialTexture = mTex;
-                m_textures[name + "_material_internal"] = mTex;
-            } catch (...) {
-                std::cerr << "Failed to load material texture: " << materialFilepath << ", using default." << std::endl;
-                delete mTex;
+        if (!material.uploading) {
+            bool decoded = true;
+            for (auto& future : material.decoded) {
+                if (future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    decoded = false;
+                    break;
+                }
             }
+            
+            if (decoded && !beginMaterialUpload(material)) {
+                it = m_pendingMaterials.erase(it);
+                continue;
+            }
+        } else if (m_context.getUploadManager().isComplete(material.uploadTicket)) {
+            // Completed batches have already been handed to the graphics queue
+            // (recordAcquireBarriers), so the material can be sampled from now on
+            finishMaterial(material);
+            it = m_pendingMaterials.erase(it);
+            continue;
         }
         
-        // Create descriptor set for this texture
-        std::cout << "Allocating descriptor set for " << name << std::endl;
-        VkDescriptorSet descriptorSet = m_descriptorManager.allocateDescriptorSet(m_pipeline.getDescriptorSetLayout());
-        
-        // Update descriptor set with UBO and all textures
-        std::cout << "Updating descriptor set for " << name << std::endl;
-        m_descriptorManager.updateUniformBuffer(descriptorSet, 0,
-                                               m_uniformBuffer->getBuffer(), sizeof(UniformBufferObject));
-        
-        // Binding 1: Albedo texture
-        m_descriptorManager.updateTextureDescriptor(descriptorSet, 1,
-                                                    texture->getImageView(),
-                                                    texture->getSampler());
-        // Binding 2: Depth texture
-        std::cout << "Binding depth texture for " << name << std::endl;
-        m_descriptorManager.updateTextureDescriptor(descriptorSet, 2,
-                                                    depthTexture->getImageView(),
-                                                    depthTexture->getSampler());
-        
-        // Binding 3: Normal texture
-        std::cout << "Binding normal texture for " << name << std::endl;
-        m_descriptorManager.updateTextureDescriptor(descriptorSet, 3,
-                                                    normalTexture->getImageView(),
-                                                    normalTexture->getSampler());
-        
-        // Binding 4: Material texture
-        std::cout << "Binding material texture for " << name << std::endl;
-        m_descriptorManager.updateTextureDescriptor(descriptorSet, 4,
-                                                    materialTexture->getImageView(),
-                                                    materialTexture->getSampler());
-        
-        m_textureDescriptorSets[name] = descriptorSet;
+        ++it;
+    }
+    
+    for (auto it = m_pendingAtlases.begin(); it != m_pendingAtlases.end();) {
+        PendingAtlas& pending = **it;
         
-        std::cout << "Loaded texture: " << name << " from " << filepath << std::endl;
+        if (!pending.uploading) {
+            if (pending.pageSet.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                VulkanTextureAtlas::PageSet pageSet = pending.pageSet.get();
+                if (!pageSet.isValid()) {
+                    // Sprites keep whatever standalone texture they have (or the default one)
+                    std::cerr << "Failed to build atlas '" << pending.name << "': " << pageSet.error << std::endl;
+                    it = m_pendingAtlases.erase(it);
+                    continue;
+                }
+                
+                pending.atlas = std::make_unique<VulkanTextureAtlas>(m_context);
+                pending.atlas->create(pageSet);
+                pending.uploadTicket = m_context.getUploadManager().getRecordingTicket();
+                pending.uploading = true;
+            }
+        } else if (m_context.getUploadManager().isComplete(pending.uploadTicket)) {
+            finishAtlas(pending);
+            it = m_pendingAtlases.erase(it);
+            continue;
+        }
         
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to load texture '" << name << "' from '" << filepath << "': " << e.what() << std::endl;
+        ++it;
+    }
+}
+
+bool VulkanRenderSystem::beginMaterialUpload(PendingMaterial& material) {
+    PROFILE_SCOPE("VulkanRenderSystem::beginMaterialUpload");
+    
+    std::array<VulkanImage::ImageData, MATERIAL_MAP_COUNT> data;
+    for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+        if (material.decoded[i].valid()) {
+            data[i] = material.decoded[i].get();
+        }
+    }
+    
+    if (!data[ALBEDO_MAP].isValid()) {
+        std::cerr << "Failed to load texture '" << material.name << "' from '"
+                  << material.filepaths[ALBEDO_MAP] << "'" << std::endl;
         // Use default texture as fallback
-        m_textures[name] = m_defaultTexture;
-        m_textureDescriptorSets[name] = m_descriptorSets[0]; // Use default descriptor set
+        m_textures[material.name] = m_defaultTexture;
+        m_textureDescriptorSets[material.name] = m_descriptorSets[0]; // Use default descriptor set
+        return false;
+    }
+    
+    for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+        if (!data[i].isValid()) {
+            if (!material.filepaths[i].empty()) {
+                std::cerr << "Failed to load texture: " << material.filepaths[i] << ", using default." << std::endl;
+            }
+            continue;
+        }
+        
+        material.images[i] = new VulkanImage(m_context);
+        material.images[i]->createFromPixels(data[i], MATERIAL_MAP_FORMATS[i]);
     }
+    
+    material.uploadTicket = m_context.getUploadManager().getRecordingTicket();
+    material.uploading = true;
+    return true;
+}
+
+void VulkanRenderSystem::finishMaterial(PendingMaterial& material) {
+    PROFILE_SCOPE("VulkanRenderSystem::finishMaterial");
+    
+    static const char* INTERNAL_SUFFIXES[MATERIAL_MAP_COUNT] = {
+        "", "_depth_internal", "_normal_internal", "_material_internal"
+    };
+    
+    std::array<VulkanImage*, MATERIAL_MAP_COUNT> images;
+    for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+        images[i] = material.images[i] ? material.images[i] : m_defaultTexture;
+        if (material.images[i]) {
+            m_textures[material.name + INTERNAL_SUFFIXES[i]] = material.images[i];
+        }
+    }
+    
+    // Swapped in between frames: entities switch from the default set on the next recording
+    m_textureDescriptorSets[material.name] = createMaterialDescriptorSet(images);
+    m_texturePermutations[material.name] = selectPermutation(material.images);
+    
+    std::cout << "Loaded texture: " << material.name << " from " << material.filepaths[ALBEDO_MAP] << std::endl;
+}
+
+VkDescriptorSet VulkanRenderSystem::createMaterialDescriptorSet(const std::array<VulkanImage*, MATERIAL_MAP_COUNT>& images) {
+    // UBO + albedo, depth, normal, material maps
+    VkDescriptorSet descriptorSet = m_descriptorManager.allocateDescriptorSet(m_pipeline.getDescriptorSetLayout());
+    m_descriptorManager.updateDynamicUniformBuffer(descriptorSet, 0,
+                                                  m_frameAllocator.getBuffer(), sizeof(UniformBufferObject));
+    for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+        m_descriptorManager.updateTextureDescriptor(descriptorSet, 1 + i,
+                                                    images[i]->getImageView(),
+                                                    images[i]->getSampler());
+    }
+    return descriptorSet;
+}
+
+ShaderPermutation VulkanRenderSystem::selectPermutation(const std::array<VulkanImage*, MATERIAL_MAP_COUNT>& images) {
+    // color.frag declares one constant per optional map, constant_id = MaterialMap index
+    ShaderPermutation permutation{};
+    for (int i = DEPTH_MAP; i < MATERIAL_MAP_COUNT; i++) {
+        permutation[i] = images[i] ? 1 : 0;
+    }
+    m_pipeline.getPipeline(permutation);
+    if (m_subpassPipeline != nullptr) {
+        m_subpassPipeline->getPipeline(permutation);
+    }
+    return permutation;
+}
+
+void VulkanRenderSystem::buildAtlas(const std::string& name, const std::vector<std::string>& materialPaths) {
+    queueAtlas(name, [materialPaths] {
+        return VulkanTextureAtlas::build(materialPaths);
+    });
+    std::cout << "Queued atlas build: " << name << " (" << materialPaths.size() << " sprites)" << std::endl;
+}
+
+void VulkanRenderSystem::loadAtlas(const std::string& manifestPath) {
+    bool useCooked = m_context.supportsBlockCompression();
+    queueAtlas(manifestPath, [manifestPath, useCooked] {
+        return VulkanTextureAtlas::load(manifestPath, useCooked);
+    });
+    std::cout << "Queued atlas load: " << manifestPath << std::endl;
+}
+
+void VulkanRenderSystem::queueAtlas(const std::string& name, std::function<VulkanTextureAtlas::PageSet()> job) {
+    auto pending = std::make_unique<PendingAtlas>();
+    pending->name = name;
+    pending->pageSet = m_loaderPool.submit([job = std::move(job)] {
+        PROFILE_THREAD("loader");
+        return job();
+    });
+    m_pendingAtlases.push_back(std::move(pending));
+}
+
+void VulkanRenderSystem::finishAtlas(PendingAtlas& pending) {
+    PROFILE_SCOPE("VulkanRenderSystem::finishAtlas");
+    
+    VulkanTextureAtlas& atlas = *pending.atlas;
+    
+    // One descriptor set per page, shared by every sprite on it
+    std::vector<VkDescriptorSet> pageSets;
+    std::vector<ShaderPermutation> pagePermutations;
+    for (uint32_t page = 0; page < atlas.getPageCount(); page++) {
+        std::array<VulkanImage*, MATERIAL_MAP_COUNT> pageImages;
+        std::array<VulkanImage*, MATERIAL_MAP_COUNT> images;
+        for (int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+            pageImages[i] = atlas.getImage(page, static_cast<MaterialMap>(i));
+            images[i] = pageImages[i] ? pageImages[i] : m_defaultTexture;
+        }
+        pageSets.push_back(createMaterialDescriptorSet(images));
+        // Sprites without a map the page has get its neutral fill, which reads as "no map"
+        pagePermutations.push_back(selectPermutation(pageImages));
+    }
+    
+    for (const Atlas::Sprite& sprite : atlas.getSprites()) {
+        float uv[4];
+        Atlas::uvRect(sprite, atlas.getPageSize(), uv);
+        m_textureDescriptorSets[sprite.name] = pageSets[sprite.page];
+        m_texturePermutations[sprite.name] = pagePermutations[sprite.page];
+        m_spriteRects[sprite.name] = glm::vec4(uv[0], uv[1], uv[2], uv[3]);
+    }
+    
+    std::cout << "Loaded atlas: " << pending.name << " (" << atlas.getSprites().size() << " sprites, "
+              << atlas.getPageCount() << " pages)" << std::endl;
+    m_atlases.push_back(std::move(pending.atlas));
 }
 
 VulkanImage* VulkanRenderSystem::getTexture(const std::string& name) {
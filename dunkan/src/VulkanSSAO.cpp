@@ -1,9 +1,29 @@
 #include "vulkan/VulkanSSAO.hpp"
+#include "vulkan/VulkanPipeline.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "vulkan/VulkanUploadManager.hpp"
+#include <algorithm>
 #include <array>
 #include <random>
-#include <fstream>
 
-VulkanSSAO::VulkanSSAO(VulkanContext& context) : m_context(context) {
+namespace {
+
+// Shared by ssao.comp, ssao_blur.comp and ssao_upsample.frag
+struct ComputePushConstants {
+    glm::ivec2 targetSize;   // Low-resolution pixels in use
+    glm::ivec2 direction;    // Blur direction
+    int32_t downscale;
+    int32_t samplePhase;     // First kernel sample evaluated this frame
+    glm::vec2 historyOffset; // Low-resolution pixels from a pixel to its position in the history
+    int32_t historyValid;
+};
+
+constexpr uint32_t COMPUTE_GROUP_SIZE = 8;
+
+} // namespace
+
+VulkanSSAO::VulkanSSAO(VulkanContext& context, VulkanFrameAllocator& frameAllocator)
+    : m_context(context), m_frameAllocator(frameAllocator) {
 }
 
 VulkanSSAO::~VulkanSSAO() {
@@ -14,32 +34,79 @@ void VulkanSSAO::init(VkRenderPass renderPass, VkExtent2D extent) {
     createNoiseTexture();
     createKernel();
     
+    // Initialize SSAO parameters with defaults
+    m_uboData.radius = 0.5f;
+    m_uboData.bias = 0.025f;
+    m_uboData.power = 1.0f;
+    m_uboData._padding = 0.0f;
+    
+    m_renderPass = renderPass;
+    m_extent = extent;
+    m_renderExtent = extent;
+    createTargets();
+    createPipeline();
+    createComputePipelines();
+}
+
+void VulkanSSAO::resize(VkExtent2D extent) {
+    destroyTargets();
+    m_extent = extent;
+    m_renderExtent = extent;
+    m_historyValid = false;
+    createTargets();
+}
+
+void VulkanSSAO::createTargets() {
     // Create SSAO Output Image
     ssaoOutput = new VulkanImage(m_context);
-    ssaoOutput->createImage(extent.width, extent.height, VK_FORMAT_R8_UNORM, 
+    ssaoOutput->createImage(m_extent.width, m_extent.height, VK_FORMAT_R8_UNORM, 
                            VK_IMAGE_TILING_OPTIMAL, 
                            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
     ssaoOutput->createImageView(VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
     ssaoOutput->createSampler();
+    // Composition's descriptor references it from the start, even while SSAO is off
+    ssaoOutput->transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
     
     // Create Framebuffer
     VkImageView attachments[] = { ssaoOutput->getImageView() };
     
     VkFramebufferCreateInfo framebufferInfo{};
     framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.renderPass = m_renderPass;
     framebufferInfo.attachmentCount = 1;
     framebufferInfo.pAttachments = attachments;
-    framebufferInfo.width = extent.width;
-    framebufferInfo.height = extent.height;
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
     framebufferInfo.layers = 1;
     
     if (vkCreateFramebuffer(m_context.getDevice(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to create SSAO framebuffer!");
     }
     
-    createPipeline(renderPass, extent);
+    // The history outlives the frame; the AO/blur images are render graph transients
+    VulkanRenderGraph::ImageDesc desc = getWorkImageDesc();
+    for (VulkanImage*& image : m_historyImages) {
+        image = new VulkanImage(m_context);
+        image->createRenderTarget(desc.width, desc.height, desc.format, desc.usage);
+        image->createImageView(desc.format, VK_IMAGE_ASPECT_COLOR_BIT);
+        image->createSampler(desc.samplerDesc);
+        // Stays in GENERAL: written as a storage image, read through a sampler
+        image->transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
+    }
+}
+
+void VulkanSSAO::destroyTargets() {
+    if (framebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(m_context.getDevice(), framebuffer, nullptr);
+        framebuffer = VK_NULL_HANDLE;
+    }
+    delete ssaoOutput;
+    ssaoOutput = nullptr;
+    for (VulkanImage*& image : m_historyImages) {
+        delete image;
+        image = nullptr;
+    }
 }
 
 void VulkanSSAO::createNoiseTexture() {
@@ -58,16 +125,8 @@ void VulkanSSAO::createNoiseTexture() {
                                VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 
                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
                                
-    VulkanBuffer stagingBuffer(m_context);
-    stagingBuffer.create(ssaoNoise.size() * sizeof(glm::vec4), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    stagingBuffer.copyFrom(ssaoNoise.data(), ssaoNoise.size() * sizeof(glm::vec4));
-    
-    m_noiseTexture->transitionLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    m_noiseTexture->copyFromBuffer(stagingBuffer.getBuffer(), 4, 4);
-    m_noiseTexture->transitionLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    
-    stagingBuffer.cleanup();
+    m_context.getUploadManager().uploadImage(m_noiseTexture->getImage(), ssaoNoise.data(),
+                                             ssaoNoise.size() * sizeof(glm::vec4), 4, 4);
     
     m_noiseTexture->createImageView(VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT);
     m_noiseTexture->createSampler();
@@ -77,41 +136,54 @@ void VulkanSSAO::createKernel() {
     std::uniform_real_distribution<float> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
     
-    for (unsigned int i = 0; i < 64; ++i) {
+    // Spread over the active sample count so smaller kernels still reach the full radius
+    for (uint32_t i = 0; i < m_kernelSize; ++i) {
         glm::vec4 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator), 0.0f);
         sample = glm::normalize(sample);
         sample *= randomFloats(generator);
-        float scale = float(i) / 64.0;
+        float scale = float(i) / float(m_kernelSize);
         scale = 0.1f + (scale * scale) * (1.0f - 0.1f); // Lerp
         sample *= scale;
         m_uboData.samples[i] = sample;
     }
-    
-    // Initialize SSAO parameters with defaults
-    m_uboData.radius = 0.5f;
-    m_uboData.bias = 0.025f;
-    m_uboData.power = 1.0f;
-    m_uboData._padding = 0.0f;
-    
-    m_kernelBuffer = new VulkanBuffer(m_context);
-    m_kernelBuffer->create(sizeof(SSAOKernel), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    m_kernelBuffer->copyFrom(&m_uboData, sizeof(SSAOKernel));
 }
 
 void VulkanSSAO::cleanup() {
-    if (framebuffer != VK_NULL_HANDLE) {
-        vkDestroyFramebuffer(m_context.getDevice(), framebuffer, nullptr);
-        framebuffer = VK_NULL_HANDLE;
-    }
-    delete ssaoOutput;
+    destroyTargets();
     delete m_noiseTexture;
-    delete m_kernelBuffer;
+    m_noiseTexture = nullptr;
+    m_aoImages[0] = m_aoImages[1] = nullptr;
+    
+    for (auto& [kernelSize, kernelPipeline] : m_computePipelines) {
+        vkDestroyPipeline(m_context.getDevice(), kernelPipeline, nullptr);
+    }
+    m_computePipelines.clear();
+    if (m_blurPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_context.getDevice(), m_blurPipeline, nullptr);
+        m_blurPipeline = VK_NULL_HANDLE;
+    }
+    if (m_temporalPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_context.getDevice(), m_temporalPipeline, nullptr);
+        m_temporalPipeline = VK_NULL_HANDLE;
+    }
+    if (m_upsamplePipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_context.getDevice(), m_upsamplePipeline, nullptr);
+        m_upsamplePipeline = VK_NULL_HANDLE;
+    }
+    if (m_computePipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_context.getDevice(), m_computePipelineLayout, nullptr);
+        m_computePipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_computeSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(m_context.getDevice(), m_computeSetLayout, nullptr);
+        m_computeSetLayout = VK_NULL_HANDLE;
+    }
     
-    if (pipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_context.getDevice(), pipeline, nullptr);
-        pipeline = VK_NULL_HANDLE;
+    for (auto& [kernelSize, kernelPipeline] : m_pipelines) {
+        vkDestroyPipeline(m_context.getDevice(), kernelPipeline, nullptr);
     }
+    m_pipelines.clear();
+    pipeline = VK_NULL_HANDLE;
     if (pipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_context.getDevice(), pipelineLayout, nullptr);
         pipelineLayout = VK_NULL_HANDLE;
@@ -122,7 +194,7 @@ void VulkanSSAO::cleanup() {
     }
 }
 
-void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
+void VulkanSSAO::createPipeline() {
     // Descriptor Set Layout
     std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
     
@@ -146,7 +218,7 @@ void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
     
     // Binding 3: Kernel UBO
     bindings[3].binding = 3;
-    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     bindings[3].descriptorCount = 1;
     bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
     
@@ -168,33 +240,36 @@ void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
         throw std::runtime_error("failed to create SSAO pipeline layout!");
     }
     
-    // Helper lambda for shader module creation
-    auto createShaderModule = [&](const std::vector<char>& code) {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-        VkShaderModule shaderModule;
-        vkCreateShaderModule(m_context.getDevice(), &createInfo, nullptr, &shaderModule);
-        return shaderModule;
-    };
-    
-    auto readFile = [](const std::string& filename) {
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-        if (!file.is_open()) throw std::runtime_error("failed to open file: " + filename);
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-        return buffer;
-    };
+    pipeline = getPipeline(m_kernelSize);
+}
 
-    auto vertShaderCode = readFile("shaders/composite.vert.spv"); // Reuse full screen triangle vert
-    auto fragShaderCode = readFile("shaders/ssao.frag.spv");
+VkPipeline VulkanSSAO::getPipeline(uint32_t kernelSize) {
+    auto it = m_pipelines.find(kernelSize);
+    if (it != m_pipelines.end()) {
+        return it->second;
+    }
     
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    // Sample count is specialization constant 0, giving the shader loop a constant trip count
+    VkSpecializationMapEntry mapEntry{};
+    mapEntry.constantID = 0;
+    mapEntry.offset = 0;
+    mapEntry.size = sizeof(uint32_t);
+    
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = 1;
+    specialization.pMapEntries = &mapEntry;
+    specialization.dataSize = sizeof(uint32_t);
+    specialization.pData = &kernelSize;
+    
+    VkPipeline kernelPipeline = createFullscreenPipeline("shaders/ssao.frag.spv", pipelineLayout, &specialization);
+    m_pipelines[kernelSize] = kernelPipeline;
+    return kernelPipeline;
+}
+
+VkPipeline VulkanSSAO::createFullscreenPipeline(const char* fragShaderPath, VkPipelineLayout layout,
+                                                const VkSpecializationInfo* specialization) {
+    VkShaderModule vertShaderModule = m_context.getPipelineCache().loadShaderModule("shaders/composite.vert.spv"); // Reuse full screen triangle vert
+    VkShaderModule fragShaderModule = m_context.getPipelineCache().loadShaderModule(fragShaderPath);
     
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -207,6 +282,7 @@ void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
+    fragShaderStageInfo.pSpecializationInfo = specialization;
     
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
     
@@ -218,21 +294,17 @@ void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
     inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
     
-    VkViewport viewport{};
-    viewport.width = (float) extent.width;
-    viewport.height = (float) extent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.extent = extent;
-    
+    // Set to the rendered area at record time
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+    
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
     
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -264,32 +336,75 @@ void VulkanSSAO::createPipeline(VkRenderPass renderPass, VkExtent2D extent) {
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = pipelineLayout;
-    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = m_renderPass;
     pipelineInfo.subpass = 0;
     
-    if (vkCreateGraphicsPipelines(m_context.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+    VkPipeline fullscreenPipeline;
+    if (vkCreateGraphicsPipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &fullscreenPipeline) != VK_SUCCESS) {
         throw std::runtime_error("failed to create SSAO pipeline!");
     }
-    
-    vkDestroyShaderModule(m_context.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_context.getDevice(), vertShaderModule, nullptr);
+    return fullscreenPipeline;
 }
 
-void VulkanSSAO::update(VkCommandBuffer commandBuffer, const glm::mat4& projection) {
+void VulkanSSAO::update(const glm::mat4& projection) {
     m_uboData.projection = projection;
-    m_kernelBuffer->copyFrom(&m_uboData, sizeof(SSAOKernel));
+    m_uboData.renderSize = glm::vec2(float(m_renderExtent.width), float(m_renderExtent.height));
+    m_uboData.uvScale = m_uboData.renderSize / glm::vec2(float(m_extent.width), float(m_extent.height));
+    m_kernelOffset = m_frameAllocator.push(m_uboData);
 }
 
-void VulkanSSAO::updateParameters(float radius, float bias, float power) {
+void VulkanSSAO::updateParameters(float radius, float bias, float power, int kernelSize, int downscale,
+                                  bool temporal) {
+    // Picked up by the next update()
     m_uboData.radius = radius;
     m_uboData.bias = bias;
     m_uboData.power = power;
-    m_kernelBuffer->copyFrom(&m_uboData, sizeof(SSAOKernel));
+    
+    // The history only matches the resolution and kernel it was accumulated with
+    uint32_t newDownscale = downscale >= static_cast<int>(MAX_DOWNSCALE) ? MAX_DOWNSCALE : (downscale >= 2 ? 2 : 1);
+    if (newDownscale != m_downscale || temporal != m_temporal) {
+        m_downscale = newDownscale;
+        m_temporal = temporal;
+        m_historyValid = false;
+    }
+    
+    uint32_t size = static_cast<uint32_t>(std::clamp(kernelSize, 1, MAX_KERNEL_SIZE));
+    if (size != m_kernelSize) {
+        m_kernelSize = size;
+        m_historyValid = false;
+        createKernel();
+        pipeline = getPipeline(m_kernelSize);
+    }
 }
 
-void VulkanSSAO::updateDescriptorSet(VkDescriptorSet descriptorSet, VulkanImage* depth, VulkanImage* normal) {
-    this->descriptorSet = descriptorSet;
+void VulkanSSAO::updateDescriptorSets(VulkanDescriptorManager& descriptorManager, VulkanImage* depth, VulkanImage* normal,
+                                      VulkanImage* work0, VulkanImage* work1) {
+    m_aoImages[0] = work0;
+    m_aoImages[1] = work1;
+    
+    // Written again after a resize, into the same sets
+    if (descriptorSet == VK_NULL_HANDLE) {
+        descriptorSet = descriptorManager.allocateDescriptorSet(descriptorSetLayout);
+        m_aoSet = descriptorManager.allocateDescriptorSet(m_computeSetLayout);
+        m_blurXSet = descriptorManager.allocateDescriptorSet(m_computeSetLayout);
+        m_blurYSet = descriptorManager.allocateDescriptorSet(m_computeSetLayout);
+        for (uint32_t i = 0; i < 2; i++) {
+            m_temporalSets[i] = descriptorManager.allocateDescriptorSet(m_computeSetLayout);
+            m_temporalBlurSets[i] = descriptorManager.allocateDescriptorSet(m_computeSetLayout);
+        }
+    }
+    writeComputeDescriptorSet(m_aoSet, depth, normal, m_aoImages[1], m_aoImages[0], m_historyImages[0]);
+    writeComputeDescriptorSet(m_blurXSet, depth, normal, m_aoImages[0], m_aoImages[1], m_historyImages[0]);
+    writeComputeDescriptorSet(m_blurYSet, depth, normal, m_aoImages[1], m_aoImages[0], m_historyImages[0]);
+    
+    for (uint32_t i = 0; i < 2; i++) {
+        VulkanImage* written = m_historyImages[i];
+        VulkanImage* previous = m_historyImages[1 - i];
+        writeComputeDescriptorSet(m_temporalSets[i], depth, normal, m_aoImages[0], written, previous);
+        writeComputeDescriptorSet(m_temporalBlurSets[i], depth, normal, written, m_aoImages[1], previous);
+    }
     
     VkDescriptorImageInfo depthInfo{};
     depthInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -307,7 +422,7 @@ void VulkanSSAO::updateDescriptorSet(VkDescriptorSet descriptorSet, VulkanImage*
     noiseInfo.sampler = m_noiseTexture->getSampler();
     
     VkDescriptorBufferInfo bufferInfo{};
-    bufferInfo.buffer = m_kernelBuffer->getBuffer();
+    bufferInfo.buffer = m_frameAllocator.getBuffer();
     bufferInfo.offset = 0;
     bufferInfo.range = sizeof(SSAOKernel);
     
@@ -341,9 +456,332 @@ void VulkanSSAO::updateDescriptorSet(VkDescriptorSet descriptorSet, VulkanImage*
     descriptorWrites[3].dstSet = descriptorSet;
     descriptorWrites[3].dstBinding = 3;
     descriptorWrites[3].dstArrayElement = 0;
-    descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
     descriptorWrites[3].descriptorCount = 1;
     descriptorWrites[3].pBufferInfo = &bufferInfo;
     
     vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
 }
+
+VulkanRenderGraph::ImageDesc VulkanSSAO::getWorkImageDesc() const {
+    // Half resolution covers both reduced paths; at quarter resolution only the top-left part is used
+    VulkanRenderGraph::ImageDesc desc;
+    desc.width = (m_extent.width + 1) / 2;
+    desc.height = (m_extent.height + 1) / 2;
+    desc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.sampled = true;
+    desc.samplerDesc.magFilter = VK_FILTER_NEAREST;
+    desc.samplerDesc.minFilter = VK_FILTER_NEAREST;
+    desc.samplerDesc.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    desc.samplerDesc.addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    desc.samplerDesc.maxAnisotropy = 1.0f;
+    return desc;
+}
+
+void VulkanSSAO::createComputePipelines() {
+    // One layout for the AO, blur and upsample stages; each stage uses the bindings it needs
+    std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    
+    // Binding 0: Position/Depth (from G-Buffer), also read by the upsample
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    // Binding 1: Normal (from G-Buffer), binding 2: Noise Texture
+    // Binding 3: Kernel UBO
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    // Binding 4: Reduced-resolution AO input
+    bindings[4].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    // Binding 5: Reduced-resolution AO output
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    // Binding 6: Previous frame's AO history (temporal accumulation)
+    
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+    
+    if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_computeSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create SSAO compute descriptor set layout!");
+    }
+    
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(ComputePushConstants);
+    
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_computeSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    
+    if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_computePipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create SSAO compute pipeline layout!");
+    }
+    
+    VkComputePipelineCreateInfo blurInfo{};
+    blurInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    blurInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    blurInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    blurInfo.stage.module = m_context.getPipelineCache().loadShaderModule("shaders/ssao_blur.comp.spv");
+    blurInfo.stage.pName = "main";
+    blurInfo.layout = m_computePipelineLayout;
+    
+    if (vkCreateComputePipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &blurInfo, nullptr, &m_blurPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create SSAO blur pipeline!");
+    }
+    
+    m_upsamplePipeline = createFullscreenPipeline("shaders/ssao_upsample.frag.spv", m_computePipelineLayout, nullptr);
+    
+    VkComputePipelineCreateInfo temporalInfo = blurInfo;
+    temporalInfo.stage.module = m_context.getPipelineCache().loadShaderModule("shaders/ssao_temporal.comp.spv");
+    
+    if (vkCreateComputePipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &temporalInfo, nullptr, &m_temporalPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create SSAO temporal pipeline!");
+    }
+    
+    getComputePipeline(m_kernelSize, 1);
+}
+
+VkPipeline VulkanSSAO::getComputePipeline(uint32_t sampleCount, uint32_t sampleStride) {
+    auto it = m_computePipelines.find({sampleCount, sampleStride});
+    if (it != m_computePipelines.end()) {
+        return it->second;
+    }
+    
+    // Constant 0 is the sample count as in the fragment path, constant 1 the stride between samples
+    std::array<uint32_t, 2> constants = {sampleCount, sampleStride};
+    std::array<VkSpecializationMapEntry, 2> mapEntries{};
+    for (uint32_t i = 0; i < mapEntries.size(); i++) {
+        mapEntries[i].constantID = i;
+        mapEntries[i].offset = i * sizeof(uint32_t);
+        mapEntries[i].size = sizeof(uint32_t);
+    }
+    
+    VkSpecializationInfo specialization{};
+    specialization.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specialization.pMapEntries = mapEntries.data();
+    specialization.dataSize = sizeof(constants);
+    specialization.pData = constants.data();
+    
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = m_context.getPipelineCache().loadShaderModule("shaders/ssao.comp.spv");
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specialization;
+    pipelineInfo.layout = m_computePipelineLayout;
+    
+    VkPipeline kernelPipeline;
+    if (vkCreateComputePipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &kernelPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create SSAO compute pipeline!");
+    }
+    
+    m_computePipelines[{sampleCount, sampleStride}] = kernelPipeline;
+    return kernelPipeline;
+}
+
+void VulkanSSAO::writeComputeDescriptorSet(VkDescriptorSet set, VulkanImage* depth, VulkanImage* normal,
+                                           VulkanImage* input, VulkanImage* output, VulkanImage* history) {
+    std::array<VkDescriptorImageInfo, 6> imageInfos{};
+    VulkanImage* sampled[] = { depth, normal, m_noiseTexture };
+    for (uint32_t i = 0; i < 3; i++) {
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfos[i].imageView = sampled[i]->getImageView();
+        imageInfos[i].sampler = sampled[i]->getSampler();
+    }
+    imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfos[3].imageView = input->getImageView();
+    imageInfos[3].sampler = input->getSampler();
+    imageInfos[4].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfos[4].imageView = output->getImageView();
+    imageInfos[5].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfos[5].imageView = history->getImageView();
+    imageInfos[5].sampler = history->getSampler();
+    
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_frameAllocator.getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(SSAOKernel);
+    
+    std::array<VkWriteDescriptorSet, 7> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = set;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    }
+    descriptorWrites[0].pImageInfo = &imageInfos[0];
+    descriptorWrites[1].pImageInfo = &imageInfos[1];
+    descriptorWrites[2].pImageInfo = &imageInfos[2];
+    descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrites[3].pBufferInfo = &bufferInfo;
+    descriptorWrites[4].pImageInfo = &imageInfos[3];
+    descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    descriptorWrites[5].pImageInfo = &imageInfos[4];
+    descriptorWrites[6].pImageInfo = &imageInfos[5];
+    
+    vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void VulkanSSAO::record(VkCommandBuffer commandBuffer, const glm::mat4& projection,
+                        const glm::vec2& viewOffset, const glm::vec2& viewSize, VkExtent2D renderExtent) {
+    // The history's pixels only line up with the resolution they were accumulated at
+    renderExtent.width = std::min(renderExtent.width, m_extent.width);
+    renderExtent.height = std::min(renderExtent.height, m_extent.height);
+    if (renderExtent.width != m_renderExtent.width || renderExtent.height != m_renderExtent.height) {
+        m_renderExtent = renderExtent;
+        m_historyValid = false;
+    }
+    update(projection);
+    
+    if (m_downscale > 1) {
+        // Content at a fixed world position moves by the offset change, in low-resolution pixels
+        glm::vec2 lowResTexel = viewSize * float(m_downscale) /
+                                glm::vec2(float(m_renderExtent.width), float(m_renderExtent.height));
+        m_historyOffset = (viewOffset - m_previousViewOffset) / lowResTexel;
+        recordReducedResolution(commandBuffer);
+    } else {
+        recordFullResolution(commandBuffer);
+    }
+    m_previousViewOffset = viewOffset;
+}
+
+void VulkanSSAO::recordFullResolution(VkCommandBuffer commandBuffer) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_renderExtent;
+    
+    VkClearValue clearValue = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    VulkanPipeline::setViewport(commandBuffer, m_renderExtent);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            0, 1, &descriptorSet, 1, &m_kernelOffset);
+    
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Full screen triangle
+    
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void VulkanSSAO::recordReducedResolution(VkCommandBuffer commandBuffer) {
+    ComputePushConstants pushConstants{};
+    pushConstants.targetSize = glm::ivec2((m_renderExtent.width + m_downscale - 1) / m_downscale,
+                                          (m_renderExtent.height + m_downscale - 1) / m_downscale);
+    pushConstants.downscale = static_cast<int32_t>(m_downscale);
+    
+    uint32_t groupsX = (static_cast<uint32_t>(pushConstants.targetSize.x) + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE;
+    uint32_t groupsY = (static_cast<uint32_t>(pushConstants.targetSize.y) + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE;
+    
+    // Temporal: every sampleStride-th kernel sample, starting at a phase that rotates each frame,
+    // so TEMPORAL_FRAMES frames cover the whole kernel
+    uint32_t sampleCount = m_kernelSize;
+    uint32_t sampleStride = 1;
+    if (m_temporal) {
+        sampleCount = std::max(m_kernelSize / TEMPORAL_FRAMES, 1u);
+        sampleStride = m_kernelSize / sampleCount;
+        pushConstants.samplePhase = static_cast<int32_t>(m_temporalFrame % sampleStride);
+        pushConstants.historyOffset = m_historyOffset;
+        pushConstants.historyValid = m_historyValid ? 1 : 0;
+        m_temporalFrame++;
+    }
+    
+    // The G-buffer, history and work images arrive synchronized by the render graph.
+    // Between compute stages, each reads what the previous one wrote
+    VkMemoryBarrier computeBarrier{};
+    computeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    computeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    
+    // 1. Occlusion, one pixel per downscale x downscale block
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, getComputePipeline(sampleCount, sampleStride));
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout,
+                            0, 1, &m_aoSet, 1, &m_kernelOffset);
+    vkCmdPushConstants(commandBuffer, m_computePipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(pushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+    
+    // 2. Temporal: blend into the history, reprojected and rejected where the depth changed
+    VkDescriptorSet blurInputSet = m_blurXSet;
+    if (m_temporal) {
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+        
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_temporalPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout,
+                                0, 1, &m_temporalSets[m_historyIndex], 1, &m_kernelOffset);
+        vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+        
+        // The blur reads the accumulated history instead of this frame's samples
+        blurInputSet = m_temporalBlurSets[m_historyIndex];
+        m_historyIndex = 1 - m_historyIndex;
+        m_historyValid = true;
+    }
+    
+    // 3. Depth-aware blur, horizontal then vertical
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_blurPipeline);
+    VkDescriptorSet blurSets[] = { blurInputSet, m_blurYSet };
+    glm::ivec2 blurDirections[] = { glm::ivec2(1, 0), glm::ivec2(0, 1) };
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        vkCmdPipelineBarrier(commandBuffer,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+        
+        pushConstants.direction = blurDirections[pass];
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_computePipelineLayout,
+                                0, 1, &blurSets[pass], 1, &m_kernelOffset);
+        vkCmdPushConstants(commandBuffer, m_computePipelineLayout,
+                           VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                           0, sizeof(pushConstants), &pushConstants);
+        vkCmdDispatch(commandBuffer, groupsX, groupsY, 1);
+    }
+    
+    // 4. Bilateral upsample into ssaoOutput
+    computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+    
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = m_renderExtent;
+    
+    VkClearValue clearValue = {{0.0f, 0.0f, 0.0f, 1.0f}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    
+    // The vertical blur wrote image 0, the horizontal blur's input
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_upsamplePipeline);
+    VulkanPipeline::setViewport(commandBuffer, m_renderExtent);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_computePipelineLayout,
+                            0, 1, &m_blurXSet, 1, &m_kernelOffset);
+    vkCmdPushConstants(commandBuffer, m_computePipelineLayout,
+                       VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(pushConstants), &pushConstants);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Full screen triangle
+    
+    vkCmdEndRenderPass(commandBuffer);
+}
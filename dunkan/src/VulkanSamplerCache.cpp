@@ -0,0 +1,62 @@
+#include "vulkan/VulkanSamplerCache.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+VulkanSamplerCache::VulkanSamplerCache(VulkanContext& context) : m_context(context) {
+}
+
+VulkanSamplerCache::~VulkanSamplerCache() {
+    cleanup();
+}
+
+void VulkanSamplerCache::cleanup() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [desc, sampler] : m_samplers) {
+        vkDestroySampler(m_context.getDevice(), sampler, nullptr);
+    }
+    m_samplers.clear();
+}
+
+VkSampler VulkanSamplerCache::get(const SamplerDesc& requested) {
+    SamplerDesc desc = requested;
+    desc.maxAnisotropy = std::min(desc.maxAnisotropy, m_context.getDeviceProperties().limits.maxSamplerAnisotropy);
+    
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& [cached, sampler] : m_samplers) {
+        if (cached == desc) {
+            return sampler;
+        }
+    }
+    
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = desc.magFilter;
+    samplerInfo.minFilter = desc.minFilter;
+    samplerInfo.addressModeU = desc.addressMode;
+    samplerInfo.addressModeV = desc.addressMode;
+    samplerInfo.addressModeW = desc.addressMode;
+    samplerInfo.anisotropyEnable = desc.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = std::max(desc.maxAnisotropy, 1.0f);
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = desc.mipmapMode;
+    samplerInfo.minLod = desc.minLod;
+    samplerInfo.maxLod = desc.maxLod;
+    samplerInfo.mipLodBias = desc.mipLodBias;
+    
+    VkSampler sampler;
+    if (vkCreateSampler(m_context.getDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+    
+    m_samplers.emplace_back(desc, sampler);
+    return sampler;
+}
+
+size_t VulkanSamplerCache::getSamplerCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_samplers.size();
+}
@@ -16,6 +16,7 @@ void VulkanSwapchain::create() {
         m_context.getPhysicalDevice(), m_context.getSurface());
     
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
+    m_supportedPresentModes = swapChainSupport.presentModes;
     VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
     
@@ -62,6 +63,7 @@ void VulkanSwapchain::create() {
     
     m_imageFormat = surfaceFormat.format;
     m_extent = extent;
+    m_presentMode = presentMode;
     
     // Create image views
     m_imageViews.resize(m_images.size());
@@ -159,14 +161,19 @@ VkSurfaceFormatKHR VulkanSwapchain::chooseSwapSurfaceFormat(const std::vector<Vk
 }
 
 VkPresentModeKHR VulkanSwapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), m_requestedPresentMode) !=
+        availablePresentModes.end()) {
+        return m_requestedPresentMode;
     }
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+bool VulkanSwapchain::supportsPresentMode(VkPresentModeKHR mode) const {
+    return mode == VK_PRESENT_MODE_FIFO_KHR ||
+           std::find(m_supportedPresentModes.begin(), m_supportedPresentModes.end(), mode) !=
+               m_supportedPresentModes.end();
+}
+
 VkExtent2D VulkanSwapchain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
         return capabilities.currentExtent;
@@ -0,0 +1,177 @@
+#include "vulkan/VulkanTextureAtlas.hpp"
+#include "utils/CpuProfiler.hpp"
+#include <filesystem>
+#include <utility>
+
+namespace {
+
+using SourceMaps = std::array<Atlas::Image, MATERIAL_MAP_COUNT>;
+
+// Missing maps stay invalid; the page keeps its neutral fill there
+SourceMaps decodeSource(const std::string& materialPath) {
+    SourceMaps maps;
+    for (int map = 0; map < MATERIAL_MAP_COUNT; map++) {
+        VulkanImage::ImageData data;
+        std::string path = materialPath + MATERIAL_MAP_SUFFIXES[map] + ".png";
+        if (!std::filesystem::exists(path) || !VulkanImage::decodeFile(path, data, MATERIAL_MAP_CHANNELS[map])) {
+            continue;
+        }
+        maps[map].pixels = std::move(data.pixels);
+        maps[map].width = data.width;
+        maps[map].height = data.height;
+        maps[map].channels = data.channels;
+    }
+    return maps;
+}
+
+void composePages(VulkanTextureAtlas::PageSet& pageSet, const std::vector<SourceMaps>& sources) {
+    const Atlas::Layout& layout = pageSet.layout;
+    uint32_t mipLevels = Atlas::mipLevels(layout.padding);
+    pageSet.pages.assign(layout.pageCount, {});
+
+    for (uint32_t page = 0; page < layout.pageCount; page++) {
+        for (int map = 0; map < MATERIAL_MAP_COUNT; map++) {
+            std::vector<const Atlas::Image*> images(layout.sprites.size(), nullptr);
+            bool used = false;
+            for (size_t i = 0; i < layout.sprites.size(); i++) {
+                if (layout.sprites[i].page == page && sources[i][map].isValid()) {
+                    images[i] = &sources[i][map];
+                    used = true;
+                }
+            }
+            if (!used) {
+                continue;
+            }
+
+            Atlas::Image composed = Atlas::composePage(layout, page, images, MATERIAL_MAP_CHANNELS[map],
+                                                       MATERIAL_MAP_NEUTRAL[map]);
+            VulkanImage::ImageData& data = pageSet.pages[page][map];
+            data.pixels = std::move(composed.pixels);
+            data.width = composed.width;
+            data.height = composed.height;
+            data.channels = composed.channels;
+            VulkanImage::generateMips(data, VulkanImage::isSrgbFormat(MATERIAL_MAP_FORMATS[map]), mipLevels);
+        }
+    }
+}
+
+std::string spriteName(const std::string& materialPath) {
+    return std::filesystem::path(materialPath).filename().string() + MATERIAL_MAP_SUFFIXES[ALBEDO_MAP];
+}
+
+} // namespace
+
+VulkanTextureAtlas::PageSet VulkanTextureAtlas::build(const std::vector<std::string>& materialPaths,
+                                                      uint32_t pageSize, uint32_t padding) {
+    PROFILE_SCOPE("VulkanTextureAtlas::build");
+    PageSet pageSet;
+    pageSet.layout.pageSize = pageSize;
+    pageSet.layout.padding = padding;
+
+    std::vector<SourceMaps> sources;
+    for (const std::string& materialPath : materialPaths) {
+        SourceMaps maps = decodeSource(materialPath);
+        if (!maps[ALBEDO_MAP].isValid()) {
+            pageSet.error = "failed to load " + materialPath + MATERIAL_MAP_SUFFIXES[ALBEDO_MAP] + ".png";
+            return pageSet;
+        }
+
+        // The albedo map sets the sprite size; other maps are resampled to it
+        Atlas::Sprite sprite;
+        sprite.name = spriteName(materialPath);
+        sprite.source = materialPath;
+        sprite.width = maps[ALBEDO_MAP].width;
+        sprite.height = maps[ALBEDO_MAP].height;
+        pageSet.layout.sprites.push_back(sprite);
+        sources.push_back(std::move(maps));
+    }
+
+    if (!Atlas::pack(pageSet.layout, pageSet.error)) {
+        return pageSet;
+    }
+
+    composePages(pageSet, sources);
+    return pageSet;
+}
+
+VulkanTextureAtlas::PageSet VulkanTextureAtlas::load(const std::string& manifestPath, bool useCooked) {
+    PROFILE_SCOPE("VulkanTextureAtlas::load");
+    PageSet pageSet;
+    if (!Atlas::readManifest(manifestPath, pageSet.layout) || pageSet.layout.pageCount == 0) {
+        pageSet.error = "failed to read atlas manifest " + manifestPath;
+        return pageSet;
+    }
+    const Atlas::Layout& layout = pageSet.layout;
+
+    if (useCooked) {
+        pageSet.pages.assign(layout.pageCount, {});
+        bool complete = true;
+        for (uint32_t page = 0; page < layout.pageCount && complete; page++) {
+            for (int map = 0; map < MATERIAL_MAP_COUNT; map++) {
+                // Pages without sprites using a map have no file for it
+                VulkanImage::decodeKtx2(Atlas::pagePath(manifestPath, page, MATERIAL_MAP_SUFFIXES[map]),
+                                        pageSet.pages[page][map]);
+            }
+            complete = pageSet.pages[page][ALBEDO_MAP].isValid();
+        }
+        if (complete) {
+            return pageSet;
+        }
+        pageSet.pages.clear();
+    }
+
+    // No cooked pages (or no BC support): rebuild them with the recorded layout
+    std::vector<SourceMaps> sources;
+    for (const Atlas::Sprite& sprite : layout.sprites) {
+        sources.push_back(decodeSource(sprite.source));
+        if (!sources.back()[ALBEDO_MAP].isValid()) {
+            pageSet.error = "failed to load atlas sprite " + sprite.name + " from " + sprite.source;
+            return pageSet;
+        }
+    }
+
+    composePages(pageSet, sources);
+    return pageSet;
+}
+
+VulkanTextureAtlas::VulkanTextureAtlas(VulkanContext& context) : m_context(context) {
+}
+
+VulkanTextureAtlas::~VulkanTextureAtlas() {
+    cleanup();
+}
+
+void VulkanTextureAtlas::create(const PageSet& pageSet) {
+    m_layout = pageSet.layout;
+    for (size_t i = 0; i < m_layout.sprites.size(); i++) {
+        m_spriteIndex[m_layout.sprites[i].name] = i;
+    }
+
+    m_pages.assign(pageSet.pages.size(), {});
+    for (size_t page = 0; page < pageSet.pages.size(); page++) {
+        for (int map = 0; map < MATERIAL_MAP_COUNT; map++) {
+            const VulkanImage::ImageData& data = pageSet.pages[page][map];
+            if (!data.isValid()) {
+                continue;
+            }
+            m_pages[page][map] = new VulkanImage(m_context);
+            m_pages[page][map]->createFromPixels(data, MATERIAL_MAP_FORMATS[map]);
+        }
+    }
+}
+
+void VulkanTextureAtlas::cleanup() {
+    for (auto& page : m_pages) {
+        for (VulkanImage*& image : page) {
+            delete image;
+            image = nullptr;
+        }
+    }
+    m_pages.clear();
+    m_spriteIndex.clear();
+}
+
+const Atlas::Sprite* VulkanTextureAtlas::findSprite(const std::string& name) const {
+    auto it = m_spriteIndex.find(name);
+    return it != m_spriteIndex.end() ? &m_layout.sprites[it->second] : nullptr;
+}
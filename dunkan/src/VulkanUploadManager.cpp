@@ -0,0 +1,391 @@
+#include "vulkan/VulkanUploadManager.hpp"
+#include "vulkan/VulkanContext.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+VulkanUploadManager::VulkanUploadManager(VulkanContext& context) : m_context(context) {
+}
+
+VulkanUploadManager::~VulkanUploadManager() {
+    cleanup();
+}
+
+void VulkanUploadManager::init() {
+    QueueFamilyIndices families = m_context.getQueueFamilies();
+    m_graphicsFamily = families.graphicsFamily.value();
+    m_transferFamily = families.transferFamily.value_or(m_graphicsFamily);
+    m_queue = m_context.getTransferQueue();
+    
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    
+    if (vkCreateCommandPool(m_context.getDevice(), &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+}
+
+void VulkanUploadManager::cleanup() {
+    if (m_commandPool == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    waitIdle();
+    
+    for (auto& batch : m_freeBatches) {
+        vkDestroyFence(m_context.getDevice(), batch->fence, nullptr);
+    }
+    m_freeBatches.clear();
+    m_pendingImageAcquires.clear();
+    m_pendingBufferAcquires.clear();
+    
+    // Frees every command buffer allocated from it
+    vkDestroyCommandPool(m_context.getDevice(), m_commandPool, nullptr);
+    m_commandPool = VK_NULL_HANDLE;
+}
+
+VulkanUploadManager::Batch& VulkanUploadManager::getRecordingBatch() {
+    if (m_recording) {
+        return *m_recording;
+    }
+    
+    if (!m_freeBatches.empty()) {
+        m_recording = std::move(m_freeBatches.back());
+        m_freeBatches.pop_back();
+        vkResetFences(m_context.getDevice(), 1, &m_recording->fence);
+        vkResetCommandBuffer(m_recording->commandBuffer, 0);
+    } else {
+        m_recording = std::make_unique<Batch>();
+        
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        
+        if (vkAllocateCommandBuffers(m_context.getDevice(), &allocInfo, &m_recording->commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+        
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        
+        if (vkCreateFence(m_context.getDevice(), &fenceInfo, nullptr, &m_recording->fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+    }
+    
+    m_recording->ticket = m_nextTicket;
+    
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    
+    if (vkBeginCommandBuffer(m_recording->commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording upload command buffer!");
+    }
+    
+    return *m_recording;
+}
+
+VulkanBuffer* VulkanUploadManager::createStaging(Batch& batch, const void* data, VkDeviceSize size) {
+    auto staging = std::make_unique<VulkanBuffer>(m_context);
+    staging->create(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    AllocationStrategy::Linear);
+    staging->copyFrom(data, size);
+    
+    batch.stagingBuffers.push_back(std::move(staging));
+    return batch.stagingBuffers.back().get();
+}
+
+bool VulkanUploadManager::canBlitMips(VkFormat format) const {
+    // A dedicated transfer family has no graphics bit, so vkCmdBlitImage isn't available there
+    if (hasDedicatedTransferQueue()) {
+        return false;
+    }
+    
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(m_context.getPhysicalDevice(), format, &properties);
+    
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (properties.optimalTilingFeatures & required) == required;
+}
+
+void VulkanUploadManager::beginImageUpload(Batch& batch, VkImage image, uint32_t mipLevels) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanUploadManager::finishImageUpload(Batch& batch, VkImage image, uint32_t baseMipLevel, uint32_t mipLevels,
+                                            VkImageLayout oldLayout, VkAccessFlags srcAccessMask) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccessMask;
+    
+    if (hasDedicatedTransferQueue()) {
+        // Release half of the ownership transfer; the graphics queue acquires it later
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        barrier.dstAccessMask = 0;
+        
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        
+        VkImageMemoryBarrier acquire = barrier;
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        batch.imageAcquires.push_back(acquire);
+    } else {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+}
+
+void VulkanUploadManager::uploadImage(VkImage image, const void* data, VkDeviceSize size,
+                                      uint32_t width, uint32_t height, const std::vector<VkDeviceSize>& mipOffsets) {
+    Batch& batch = getRecordingBatch();
+    VulkanBuffer* staging = createStaging(batch, data, size);
+    
+    uint32_t mipLevels = mipOffsets.empty() ? 1 : static_cast<uint32_t>(mipOffsets.size());
+    beginImageUpload(batch, image, mipLevels);
+    
+    std::vector<VkBufferImageCopy> regions(mipLevels);
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        VkBufferImageCopy& region = regions[level];
+        region.bufferOffset = mipOffsets.empty() ? 0 : mipOffsets[level];
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {std::max(1u, width >> level), std::max(1u, height >> level), 1};
+    }
+    
+    vkCmdCopyBufferToImage(batch.commandBuffer, staging->getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+    
+    finishImageUpload(batch, image, 0, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+void VulkanUploadManager::uploadImageWithBlitMips(VkImage image, const void* data, VkDeviceSize size,
+                                                  uint32_t width, uint32_t height, uint32_t mipLevels) {
+    Batch& batch = getRecordingBatch();
+    VulkanBuffer* staging = createStaging(batch, data, size);
+    
+    beginImageUpload(batch, image, mipLevels);
+    
+    VkBufferImageCopy region{};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {width, height, 1};
+    
+    vkCmdCopyBufferToImage(batch.commandBuffer, staging->getBuffer(), image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    
+    // Each level is downsampled from the previous one, which must be done being written first
+    int32_t mipWidth = static_cast<int32_t>(width);
+    int32_t mipHeight = static_cast<int32_t>(height);
+    for (uint32_t level = 1; level < mipLevels; level++) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = level - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        
+        mipWidth = std::max(1, mipWidth / 2);
+        mipHeight = std::max(1, mipHeight / 2);
+        
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = level;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+        
+        vkCmdBlitImage(batch.commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+    }
+    
+    // Every level but the last was read as a blit source; the last was only written
+    if (mipLevels > 1) {
+        finishImageUpload(batch, image, 0, mipLevels - 1,
+                          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+    }
+    finishImageUpload(batch, image, mipLevels - 1, 1,
+                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+void VulkanUploadManager::uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+    Batch& batch = getRecordingBatch();
+    VulkanBuffer* staging = createStaging(batch, data, size);
+    
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(batch.commandBuffer, staging->getBuffer(), buffer, 1, &copyRegion);
+    
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    
+    if (hasDedicatedTransferQueue()) {
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+        barrier.dstAccessMask = 0;
+        
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+        
+        VkBufferMemoryBarrier acquire = barrier;
+        acquire.srcAccessMask = 0;
+        acquire.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        batch.bufferAcquires.push_back(acquire);
+    } else {
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+uint64_t VulkanUploadManager::flush() {
+    if (!m_recording) {
+        return m_nextTicket - 1;
+    }
+    
+    if (vkEndCommandBuffer(m_recording->commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record upload command buffer!");
+    }
+    
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_recording->commandBuffer;
+    
+    if (vkQueueSubmit(m_queue, 1, &submitInfo, m_recording->fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+    }
+    
+    uint64_t ticket = m_recording->ticket;
+    m_inFlight.push_back(std::move(m_recording));
+    m_nextTicket++;
+    return ticket;
+}
+
+void VulkanUploadManager::update() {
+    flush();
+    
+    // Batches are retired in submission order
+    while (!m_inFlight.empty() &&
+           vkGetFenceStatus(m_context.getDevice(), m_inFlight.front()->fence) == VK_SUCCESS) {
+        retire(*m_inFlight.front());
+        m_freeBatches.push_back(std::move(m_inFlight.front()));
+        m_inFlight.pop_front();
+    }
+}
+
+void VulkanUploadManager::wait(uint64_t ticket) {
+    if (m_recording && m_recording->ticket <= ticket) {
+        flush();
+    }
+    
+    while (!isComplete(ticket) && !m_inFlight.empty()) {
+        vkWaitForFences(m_context.getDevice(), 1, &m_inFlight.front()->fence, VK_TRUE, UINT64_MAX);
+        retire(*m_inFlight.front());
+        m_freeBatches.push_back(std::move(m_inFlight.front()));
+        m_inFlight.pop_front();
+    }
+}
+
+void VulkanUploadManager::waitIdle() {
+    wait(flush());
+}
+
+void VulkanUploadManager::retire(Batch& batch) {
+    m_completedTicket = batch.ticket;
+    
+    m_pendingImageAcquires.insert(m_pendingImageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+    m_pendingBufferAcquires.insert(m_pendingBufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+    
+    batch.imageAcquires.clear();
+    batch.bufferAcquires.clear();
+    batch.stagingBuffers.clear();
+}
+
+void VulkanUploadManager::recordAcquireBarriers(VkCommandBuffer commandBuffer) {
+    if (m_pendingImageAcquires.empty() && m_pendingBufferAcquires.empty()) {
+        return;
+    }
+    
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                         0, nullptr,
+                         static_cast<uint32_t>(m_pendingBufferAcquires.size()), m_pendingBufferAcquires.data(),
+                         static_cast<uint32_t>(m_pendingImageAcquires.size()), m_pendingImageAcquires.data());
+    
+    m_pendingImageAcquires.clear();
+    m_pendingBufferAcquires.clear();
+}
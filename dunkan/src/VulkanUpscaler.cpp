@@ -0,0 +1,298 @@
+#include "vulkan/VulkanUpscaler.hpp"
+#include "vulkan/VulkanPipeline.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+
+// Shared by easu.comp and rcas.frag
+struct UpscalePushConstants {
+    glm::ivec2 inputSize;
+    glm::ivec2 outputSize;
+    float sharpness;
+};
+
+constexpr uint32_t COMPUTE_GROUP_SIZE = 8;
+
+} // namespace
+
+VulkanUpscaler::VulkanUpscaler(VulkanContext& context, VulkanDescriptorManager& descriptorManager)
+    : m_context(context), m_descriptorManager(descriptorManager) {
+}
+
+VulkanUpscaler::~VulkanUpscaler() {
+    cleanup();
+}
+
+void VulkanUpscaler::init(VkRenderPass outputRenderPass, VkFormat colorFormat, VkExtent2D extent) {
+    m_outputRenderPass = outputRenderPass;
+    m_colorFormat = colorFormat;
+    m_extent = extent;
+    m_renderExtent = extent;
+    createPipelines();
+}
+
+void VulkanUpscaler::cleanup() {
+    VkDevice device = m_context.getDevice();
+    destroyFramebuffer();
+    if (m_easuPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, m_easuPipeline, nullptr);
+        m_easuPipeline = VK_NULL_HANDLE;
+    }
+    if (m_rcasPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(device, m_rcasPipeline, nullptr);
+        m_rcasPipeline = VK_NULL_HANDLE;
+    }
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+        m_pipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_setLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+        m_setLayout = VK_NULL_HANDLE;
+    }
+    // The set goes with the descriptor manager's pool
+    m_descriptorSet = VK_NULL_HANDLE;
+}
+
+void VulkanUpscaler::destroyFramebuffer() {
+    if (m_sceneFramebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(m_context.getDevice(), m_sceneFramebuffer, nullptr);
+        m_sceneFramebuffer = VK_NULL_HANDLE;
+    }
+}
+
+VulkanRenderGraph::ImageDesc VulkanUpscaler::getSceneColorDesc() const {
+    // Same format as the swapchain, so the composition pipeline renders into it unchanged
+    VulkanRenderGraph::ImageDesc desc;
+    desc.width = m_extent.width;
+    desc.height = m_extent.height;
+    desc.format = m_colorFormat;
+    desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    desc.sampled = true;
+    desc.samplerDesc.magFilter = VK_FILTER_NEAREST;
+    desc.samplerDesc.minFilter = VK_FILTER_NEAREST;
+    desc.samplerDesc.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    desc.samplerDesc.addressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    desc.samplerDesc.maxAnisotropy = 1.0f;
+    return desc;
+}
+
+VulkanRenderGraph::ImageDesc VulkanUpscaler::getUpscaledDesc() const {
+    // Linear values (the scene color is read through its sRGB view), so 16-bit keeps the darks
+    VulkanRenderGraph::ImageDesc desc = getSceneColorDesc();
+    desc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+    desc.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    return desc;
+}
+
+void VulkanUpscaler::resize(VkExtent2D extent) {
+    destroyFramebuffer();
+    m_extent = extent;
+    m_renderExtent = extent;
+}
+
+void VulkanUpscaler::setTargets(VulkanImage* sceneColor, VulkanImage* upscaled) {
+    destroyFramebuffer();
+    VkImageView attachments[] = { sceneColor->getImageView() };
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_outputRenderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(m_context.getDevice(), &framebufferInfo, nullptr, &m_sceneFramebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create scene color framebuffer!");
+    }
+
+    if (m_descriptorSet == VK_NULL_HANDLE) {
+        m_descriptorSet = m_descriptorManager.allocateDescriptorSet(m_setLayout);
+    }
+
+    std::array<VkDescriptorImageInfo, 3> imageInfos{};
+    imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageInfos[0].imageView = sceneColor->getImageView();
+    imageInfos[0].sampler = sceneColor->getSampler();
+    imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfos[1].imageView = upscaled->getImageView();
+    imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageInfos[2].imageView = upscaled->getImageView();
+    imageInfos[2].sampler = upscaled->getSampler();
+
+    std::array<VkWriteDescriptorSet, 3> descriptorWrites{};
+    for (uint32_t i = 0; i < descriptorWrites.size(); i++) {
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = m_descriptorSet;
+        descriptorWrites[i].dstBinding = i;
+        descriptorWrites[i].descriptorCount = 1;
+        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    }
+    descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void VulkanUpscaler::createPipelines() {
+    // Binding 0: scene color (EASU input), binding 1: upscaled image (EASU output),
+    // binding 2: upscaled image (RCAS input)
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(UpscalePushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upscale pipeline layout!");
+    }
+
+    VkComputePipelineCreateInfo easuInfo{};
+    easuInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    easuInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    easuInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    easuInfo.stage.module = m_context.getPipelineCache().loadShaderModule("shaders/easu.comp.spv");
+    easuInfo.stage.pName = "main";
+    easuInfo.layout = m_pipelineLayout;
+
+    if (vkCreateComputePipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &easuInfo, nullptr, &m_easuPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create EASU pipeline!");
+    }
+
+    // RCAS: full screen triangle into the output render pass
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = m_context.getPipelineCache().loadShaderModule("shaders/composite.vert.spv");
+    vertShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module = m_context.getPipelineCache().loadShaderModule("shaders/rcas.frag.spv");
+    fragShaderStageInfo.pName = "main";
+
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    // Set to the window size at record time
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    std::array<VkDynamicState, 2> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_FRONT_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = 0xf;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_pipelineLayout;
+    pipelineInfo.renderPass = m_outputRenderPass;
+    pipelineInfo.subpass = 0;
+
+    if (vkCreateGraphicsPipelines(m_context.getDevice(), m_context.getPipelineCache().getCache(), 1, &pipelineInfo, nullptr, &m_rcasPipeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create RCAS pipeline!");
+    }
+}
+
+void VulkanUpscaler::upscale(VkCommandBuffer commandBuffer, VkExtent2D renderExtent) {
+    m_renderExtent.width = std::clamp(renderExtent.width, 1u, m_extent.width);
+    m_renderExtent.height = std::clamp(renderExtent.height, 1u, m_extent.height);
+
+    UpscalePushConstants push{};
+    push.inputSize = glm::ivec2(m_renderExtent.width, m_renderExtent.height);
+    push.outputSize = glm::ivec2(m_extent.width, m_extent.height);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_easuPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1,
+                            &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(push), &push);
+    vkCmdDispatch(commandBuffer, (m_extent.width + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE,
+                  (m_extent.height + COMPUTE_GROUP_SIZE - 1) / COMPUTE_GROUP_SIZE, 1);
+}
+
+void VulkanUpscaler::sharpen(VkCommandBuffer commandBuffer, float sharpness) {
+    UpscalePushConstants push{};
+    push.inputSize = glm::ivec2(m_renderExtent.width, m_renderExtent.height);
+    push.outputSize = glm::ivec2(m_extent.width, m_extent.height);
+    push.sharpness = std::clamp(sharpness, 0.0f, 1.0f);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_rcasPipeline);
+    VulkanPipeline::setViewport(commandBuffer, m_extent);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                            &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                       0, sizeof(push), &push);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
@@ -1,7 +1,11 @@
 #include "app/DebugUI.hpp"
+#include "app/GpuProfileLog.hpp"
 #include "game/components/physicscomponent.hpp"
 #include "game/components/rendercomponent.hpp"
+#include "utils/CpuProfiler.hpp"
+#include "vulkan/VulkanMemoryAllocator.hpp"
 #include <imgui.h>
+#include <cmath>
 
 
 namespace dunkan {
@@ -144,6 +148,12 @@ void DebugUI::render(int fps, int entityCount,
     renderRenderingSettings();
     ImGui::End();
   }
+
+  if (showFramePacingPanel) {
+    ImGui::Begin("Frame Pacing", &showFramePacingPanel);
+    renderFramePacingPanel();
+    ImGui::End();
+  }
   
   if (showGizmoPanel) {
     ImGui::Begin("Gizmo Controls", &showGizmoPanel);
@@ -157,6 +167,24 @@ void DebugUI::render(int fps, int entityCount,
     ImGui::End();
   }
   
+  if (showMemoryPanel) {
+    ImGui::Begin("GPU Memory", &showMemoryPanel);
+    renderMemoryPanel();
+    ImGui::End();
+  }
+
+  if (showProfilerPanel) {
+    ImGui::Begin("GPU Profiler", &showProfilerPanel);
+    renderProfilerPanel();
+    ImGui::End();
+  }
+
+  if (showCpuProfilerPanel) {
+    ImGui::Begin("CPU Profiler", &showCpuProfilerPanel);
+    renderCpuProfilerPanel();
+    ImGui::End();
+  }
+  
   // Update gizmo with mouse input
   ImVec2 mousePos = ImGui::GetMousePos();
   bool mousePressed = ImGui::IsMouseDown(ImGuiMouseButton_Left) && !ImGui::GetIO().WantCaptureMouse;
@@ -177,9 +205,14 @@ void DebugUI::renderMainMenuBar(int fps, int entityCount) {
       ImGui::MenuItem("Depth Debug", nullptr, &showDepthDebugPanel);
       ImGui::MenuItem("Entity Editor", nullptr, &showEntityEditorPanel);
       ImGui::MenuItem("Rendering", nullptr, &showRenderingPanel);
+      ImGui::MenuItem("Frame Pacing", nullptr, &showFramePacingPanel);
       ImGui::Separator();
       ImGui::MenuItem("Gizmos", nullptr, &showGizmoPanel);
       ImGui::MenuItem("Camera", nullptr, &showCameraPanel);
+      ImGui::Separator();
+      ImGui::MenuItem("Memory", nullptr, &showMemoryPanel);
+      ImGui::MenuItem("GPU Profiler", nullptr, &showProfilerPanel);
+      ImGui::MenuItem("CPU Profiler", nullptr, &showCpuProfilerPanel);
       ImGui::EndMenu();
     }
     
@@ -220,9 +253,17 @@ void DebugUI::renderGBufferViews() {
 
 void DebugUI::renderSSAOPanel() {
   ImGui::Checkbox("Enable SSAO", &config.enableSSAO);
+  if (config.mergedGBufferPass) {
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("SSAO samples the G-buffer, so it switches from the "
+                        "single merged render pass to separate passes");
+    }
+  }
 
   if (config.enableSSAO) {
-    ImGui::SliderFloat("Radius", &config.ssaoRadius, 0.1f, 2.0f, "%.2f");
+    ImGui::SliderFloat("Radius", &config.ssaoRadius, 1.0f, 64.0f, "%.1f");
     ImGui::SameLine();
     ImGui::TextDisabled("(?)");
     if (ImGui::IsItemHovered()) {
@@ -242,6 +283,51 @@ void DebugUI::renderSSAOPanel() {
     if (ImGui::IsItemHovered()) {
       ImGui::SetTooltip("Intensity multiplier for AO effect");
     }
+
+    static const int kernelSizes[] = {8, 16, 32, 64};
+    static const char *kernelLabels[] = {"8", "16", "32", "64"};
+    int kernelIndex = 3;
+    for (int i = 0; i < 4; i++) {
+      if (kernelSizes[i] == config.ssaoKernelSize) {
+        kernelIndex = i;
+      }
+    }
+    if (ImGui::Combo("Samples", &kernelIndex, kernelLabels, 4)) {
+      config.ssaoKernelSize = kernelSizes[kernelIndex];
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Kernel size, fewer samples are faster but noisier");
+    }
+
+    static const int downscales[] = {1, 2, 4};
+    static const char *resolutionLabels[] = {"Full", "Half", "Quarter"};
+    int resolutionIndex = 0;
+    for (int i = 0; i < 3; i++) {
+      if (downscales[i] == config.ssaoDownscale) {
+        resolutionIndex = i;
+      }
+    }
+    if (ImGui::Combo("Resolution", &resolutionIndex, resolutionLabels, 3)) {
+      config.ssaoDownscale = downscales[resolutionIndex];
+    }
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Half and quarter run in compute with a depth-aware "
+                        "blur and upsample");
+    }
+
+    ImGui::BeginDisabled(config.ssaoDownscale == 1);
+    ImGui::Checkbox("Temporal", &config.ssaoTemporal);
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Evaluates 1/8 of the samples per frame and "
+                        "accumulates them over time (half/quarter only)");
+    }
   } else {
     ImGui::TextDisabled("SSAO is disabled");
   }
@@ -253,7 +339,7 @@ void DebugUI::renderLightingPanel() {
   ImGui::Separator();
 
   // Light list
-  ImGui::Text("Lights: %d / 10", (int)lightingMgr.getLightCount());
+  ImGui::Text("Lights: %d", (int)lightingMgr.getLightCount());
   if (ImGui::Button("Add Light")) {
     LightConfig newLight;
     lightingMgr.addLight(newLight);
@@ -527,6 +613,117 @@ void DebugUI::renderRenderingSettings() {
   if (ImGui::Button("Reset Gamma to 0.8")) {
     config.gammaCorrection = 0.8f;
   }
+
+  ImGui::Separator();
+  ImGui::Text("Internal Resolution");
+  ImGui::Checkbox("Dynamic Resolution", &config.dynamicResolution);
+  ImGui::SameLine();
+  ImGui::TextDisabled("(?)");
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Scales the G-buffer, SSAO and lighting resolution from "
+                      "the GPU frame time to hold the target frame rate.\n"
+                      "Below full resolution the G-buffer and composition "
+                      "run as separate passes");
+  }
+  if (config.dynamicResolution) {
+    ImGui::SliderFloat("Target FPS", &config.targetFrameRate, 30.0f, 240.0f,
+                       "%.0f");
+    ImGui::SliderFloat("Min Scale", &config.minRenderScale, 0.25f, 1.0f,
+                       "%.2f");
+  } else {
+    ImGui::SliderFloat("Render Scale", &config.renderScale, 0.25f, 1.0f,
+                       "%.2f");
+    // Per-axis scales of the usual upscaler quality modes
+    const char *presets[] = {"Native", "Ultra Quality", "Quality", "Balanced",
+                             "Performance"};
+    const float presetScales[] = {1.0f, 1.0f / 1.3f, 1.0f / 1.5f, 1.0f / 1.7f,
+                                  0.5f};
+    int preset = -1;
+    for (int i = 0; i < 5; i++) {
+      if (std::abs(config.renderScale - presetScales[i]) < 0.005f)
+        preset = i;
+    }
+    if (ImGui::Combo("Preset", &preset, presets, 5)) {
+      config.renderScale = presetScales[preset];
+    }
+  }
+  ImGui::Checkbox("Upscaling (EASU + RCAS)", &config.upscaling);
+  ImGui::SameLine();
+  ImGui::TextDisabled("(?)");
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Below full resolution, lights the scene at the internal "
+                      "resolution, then upscales it edge-adaptively and "
+                      "sharpens it.\nOff: composition runs at window size and "
+                      "stretches the G-buffer");
+  }
+  if (config.upscaling) {
+    ImGui::SliderFloat("Sharpness", &config.upscaleSharpness, 0.0f, 1.0f,
+                       "%.2f");
+  }
+  ImGui::Text("Render: %d x %d (%.0f%%)", renderSize[0], renderSize[1],
+              config.renderScale * 100.0f);
+  if (gpuFrameTime >= 0.0f) {
+    ImGui::Text("GPU frame: %.2f ms", gpuFrameTime);
+  } else {
+    ImGui::TextDisabled("GPU frame: no timestamps");
+  }
+}
+
+void DebugUI::renderFramePacingPanel() {
+  ImGui::SliderInt("Frames in Flight", &config.framesInFlight, 1, 3);
+  ImGui::SameLine();
+  ImGui::TextDisabled("(?)");
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("How many frames the CPU may record ahead of the GPU.\n"
+                      "1: least latency, CPU and GPU take turns\n"
+                      "3: most throughput, most latency");
+  }
+
+  // Unsupported modes present as FIFO
+  const char *presentModes[] = {"FIFO (V-Sync)", "FIFO Relaxed", "Mailbox",
+                                "Immediate"};
+  int presentMode = static_cast<int>(config.presentMode);
+  if (ImGui::BeginCombo("Present Mode", presentModes[presentMode])) {
+    for (int i = 0; i < 4; i++) {
+      bool supported = framePacingStats.presentModeSupported[i];
+      std::string label = supported ? presentModes[i]
+                                    : std::string(presentModes[i]) +
+                                          " (unsupported)";
+      if (ImGui::Selectable(label.c_str(), i == presentMode,
+                            supported ? 0 : ImGuiSelectableFlags_Disabled)) {
+        config.presentMode = static_cast<ApplicationConfig::PresentMode>(i);
+      }
+    }
+    ImGui::EndCombo();
+  }
+  if (framePacingStats.presentMode != config.presentMode) {
+    ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Presenting with %s",
+                       presentModes[static_cast<int>(
+                           framePacingStats.presentMode)]);
+  }
+
+  ImGui::SliderFloat("FPS Limit", &config.frameRateLimit, 0.0f, 360.0f,
+                     config.frameRateLimit > 0.0f ? "%.0f" : "Off");
+  if (config.frameRateLimit > 0.0f) {
+    ImGui::Text("Limiter Wait: %.2f ms", framePacingStats.limiterWait);
+  }
+
+  ImGui::Checkbox("Late Input Sampling", &config.lateInputSampling);
+  ImGui::SameLine();
+  ImGui::TextDisabled("(?)");
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Polls input once the frame slot is free and the "
+                      "swapchain image acquired, instead of before waiting "
+                      "for them");
+  }
+
+  ImGui::Separator();
+  ImGui::Text("Input to Submit");
+  ImGui::Text("Last: %.2f ms", framePacingStats.inputLatency);
+  ImGui::Text("Average: %.2f ms", framePacingStats.averageInputLatency);
+  ImGui::Text("Max: %.2f ms", framePacingStats.maxInputLatency);
+  ImGui::TextDisabled("(CPU side; display latency adds the frames queued "
+                      "for presentation)");
 }
 
 void DebugUI::renderGizmoPanel() {
@@ -599,4 +796,160 @@ void DebugUI::renderCameraPanel() {
   }
 }
 
+void DebugUI::renderMemoryPanel() {
+  if (!memoryAllocator) {
+    ImGui::TextDisabled("No allocator attached");
+    return;
+  }
+
+  const float MB = 1024.0f * 1024.0f;
+  VulkanMemoryAllocator::Stats stats = memoryAllocator->getStats();
+
+  ImGui::Text("Device memory objects: %u", stats.deviceMemoryCount);
+  ImGui::Text("Dedicated: %u (%.1f MB)", stats.dedicatedCount,
+              stats.dedicatedBytes / MB);
+  ImGui::Separator();
+
+  if (ImGui::BeginTable("MemoryPools", 7,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Type");
+    ImGui::TableSetupColumn("Kind");
+    ImGui::TableSetupColumn("Strategy");
+    ImGui::TableSetupColumn("Blocks");
+    ImGui::TableSetupColumn("Allocs");
+    ImGui::TableSetupColumn("Used / Reserved (MB)");
+    ImGui::TableSetupColumn("Frag");
+    ImGui::TableHeadersRow();
+
+    for (const auto &pool : stats.pools) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", pool.memoryTypeIndex);
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(VulkanMemoryAllocator::kindName(pool.kind));
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(
+          VulkanMemoryAllocator::strategyName(pool.strategy));
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", pool.blockCount);
+      ImGui::TableNextColumn();
+      ImGui::Text("%u", pool.allocationCount);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.1f / %.1f", pool.usedBytes / MB, pool.blockBytes / MB);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.0f%%", pool.fragmentation * 100.0f);
+    }
+    ImGui::EndTable();
+  }
+}
+
+void DebugUI::renderProfilerPanel() {
+  if (!gpuProfileLog || gpuProfileLog->getSampleCount() == 0) {
+    ImGui::TextDisabled("No GPU timestamps yet");
+    return;
+  }
+
+  ImGui::Text("GPU frame: %.2f ms (average of %u frames)",
+              gpuProfileLog->getAverageFrameTime(),
+              gpuProfileLog->getSampleCount());
+
+  if (pipelineStatisticsSupported) {
+    ImGui::Checkbox("Pipeline Statistics", &config.gpuPipelineStatistics);
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if (ImGui::IsItemHovered()) {
+      ImGui::SetTooltip("Counts clipped primitives and fragment/compute "
+                        "shader invocations per pass.\nAdds a query per "
+                        "pass; leave off when comparing timings");
+    }
+  } else {
+    ImGui::TextDisabled("Pipeline statistics not supported");
+  }
+
+  if (gpuProfileLog->isWritingCsv()) {
+    if (ImGui::Button("Stop CSV")) {
+      gpuProfileLog->stopCsv();
+    }
+    ImGui::SameLine();
+    ImGui::Text("Writing %s", gpuProfileLog->getCsvPath().c_str());
+  } else if (ImGui::Button("Write CSV")) {
+    gpuProfileLog->startCsv("gpu_profile.csv");
+  }
+  ImGui::Separator();
+
+  bool statistics = config.gpuPipelineStatistics && pipelineStatisticsSupported;
+  if (ImGui::BeginTable("GpuPasses", statistics ? 5 : 2,
+                        ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+    ImGui::TableSetupColumn("Pass");
+    ImGui::TableSetupColumn("ms");
+    if (statistics) {
+      ImGui::TableSetupColumn("Clip prims");
+      ImGui::TableSetupColumn("Frag invoc");
+      ImGui::TableSetupColumn("Comp invoc");
+    }
+    ImGui::TableHeadersRow();
+
+    for (const auto &pass : gpuProfileLog->getPassAverages()) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(pass.name.c_str());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", pass.milliseconds);
+      if (statistics) {
+        if (pass.hasStatistics) {
+          ImGui::TableNextColumn();
+          ImGui::Text("%.0f", pass.clippingPrimitives);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.0f", pass.fragmentInvocations);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.0f", pass.computeInvocations);
+        } else {
+          for (int i = 0; i < 3; i++) {
+            ImGui::TableNextColumn();
+            ImGui::TextDisabled("-");
+          }
+        }
+      }
+    }
+    ImGui::EndTable();
+  }
+}
+
+void DebugUI::renderCpuProfilerPanel() {
+  if (!CpuProfiler::isCompiledIn()) {
+    ImGui::TextDisabled("CPU markers are compiled out of this build");
+    ImGui::TextDisabled("(configure with -DDUNKAN_CPU_PROFILER=ON)");
+    return;
+  }
+
+  ImGui::SliderInt("Frames", &config.cpuCaptureFrames, 1, 600);
+  if (CpuProfiler::isCapturing()) {
+    ImGui::TextDisabled("Capturing...");
+  } else if (ImGui::Button("Capture (F11)")) {
+    CpuProfiler::requestCapture(static_cast<uint32_t>(config.cpuCaptureFrames),
+                                "cpu_trace.json");
+  }
+  ImGui::SameLine();
+  ImGui::TextDisabled("(?)");
+  if (ImGui::IsItemHovered()) {
+    ImGui::SetTooltip("Records every thread's profiling markers for the "
+                      "next frames and writes them as a Chrome trace.\nOpen "
+                      "it in chrome://tracing or ui.perfetto.dev");
+  }
+
+  const std::string &path = CpuProfiler::getLastCapturePath();
+  if (!path.empty()) {
+    ImGui::Separator();
+    ImGui::Text("Last capture: %s", path.c_str());
+    ImGui::Text("%llu events",
+                static_cast<unsigned long long>(CpuProfiler::getLastCaptureEvents()));
+    uint64_t dropped = CpuProfiler::getLastCaptureDropped();
+    if (dropped > 0) {
+      ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f),
+                         "%llu events overwritten; capture fewer frames",
+                         static_cast<unsigned long long>(dropped));
+    }
+  }
+}
+
 } // namespace dunkan
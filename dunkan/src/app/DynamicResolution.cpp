@@ -0,0 +1,59 @@
+#include "app/DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dunkan {
+
+namespace {
+
+constexpr float BUDGET_HEADROOM = 0.9f; // Aim below the frame budget, frame times vary
+constexpr float SMOOTHING = 0.1f;       // Weight of the newest frame time
+constexpr float DEAD_BAND = 0.05f;      // Relative distance from the budget that is left alone
+constexpr int SETTLE_FRAMES = 8;        // Frames at a new scale before the next change
+constexpr float MAX_STEP = 0.1f;        // Largest scale change at once
+constexpr float SCALE_QUANTUM = 0.01f;  // Scales are rounded to whole percents
+
+} // namespace
+
+bool DynamicResolution::update(float gpuMilliseconds, float targetFrameRate,
+                               float minScale) {
+  if (gpuMilliseconds <= 0.0f || targetFrameRate <= 0.0f)
+    return false;
+
+  smoothedTime = smoothedTime > 0.0f
+                     ? smoothedTime + (gpuMilliseconds - smoothedTime) * SMOOTHING
+                     : gpuMilliseconds;
+
+  // Results arrive a couple of frames late; wait until they come from the
+  // current scale
+  if (++framesSinceChange < SETTLE_FRAMES)
+    return false;
+
+  float budget = 1000.0f / targetFrameRate * BUDGET_HEADROOM;
+  float ratio = budget / smoothedTime;
+  if (std::abs(ratio - 1.0f) < DEAD_BAND)
+    return false;
+
+  float desired = scale * std::sqrt(ratio);
+  desired = std::clamp(desired, scale - MAX_STEP, scale + MAX_STEP);
+  desired = std::round(desired / SCALE_QUANTUM) * SCALE_QUANTUM;
+  desired = std::clamp(desired, std::min(minScale, 1.0f), 1.0f);
+  if (desired == scale)
+    return false;
+
+  // Start the new scale from the predicted time rather than the old one, so
+  // the smoothing doesn't push it further in the same direction
+  smoothedTime *= (desired * desired) / (scale * scale);
+  scale = desired;
+  framesSinceChange = 0;
+  return true;
+}
+
+void DynamicResolution::reset(float newScale) {
+  scale = newScale;
+  smoothedTime = 0.0f;
+  framesSinceChange = 0;
+}
+
+} // namespace dunkan
@@ -0,0 +1,109 @@
+#include "app/FramePacing.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+namespace dunkan {
+
+FrameLimiter::~FrameLimiter() { setFineTimer(false); }
+
+void FrameLimiter::setFineTimer(bool fine) {
+#ifdef _WIN32
+  if (fine != fineTimer) {
+    if (fine) {
+      timeBeginPeriod(1);
+    } else {
+      timeEndPeriod(1);
+    }
+    fineTimer = fine;
+  }
+#else
+  // Sleeps already wake within tens of microseconds
+  fineTimer = fine;
+#endif
+}
+
+void FrameLimiter::wait(float frameRate) {
+  Clock::time_point start = Clock::now();
+  if (frameRate <= 0.0f) {
+    running = false;
+    lastWait = 0.0f;
+    setFineTimer(false);
+    return;
+  }
+  setFineTimer(true);
+
+  auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / frameRate));
+  if (!running || start - nextFrame > period) {
+    nextFrame = start;
+  }
+
+  auto milliseconds = [](float value) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(value));
+  };
+  for (Clock::time_point now = start; nextFrame - now > spinMargin;
+       now = Clock::now()) {
+    Clock::duration sleep = nextFrame - now - spinMargin;
+    std::this_thread::sleep_for(sleep);
+
+    // Move the margin towards the overshoot plus a quarter: quickly up, so
+    // sleeps stop missing the frame's start, slowly down, and only part of
+    // the way for a single late wakeup
+    Clock::duration oversleep = Clock::now() - now - sleep;
+    Clock::duration target = oversleep + oversleep / 4;
+    spinMargin += target > spinMargin ? (target - spinMargin) / 4
+                                       : -(spinMargin - target) / 32;
+    spinMargin = std::clamp(spinMargin, milliseconds(MIN_SPIN_MILLISECONDS),
+                            milliseconds(MAX_SPIN_MILLISECONDS));
+  }
+  while (Clock::now() < nextFrame) {
+    std::this_thread::yield();
+  }
+
+  running = true;
+  nextFrame += period;
+  lastWait =
+      std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+}
+
+void InputLatency::markInputSampled() {
+  sampleTime = std::chrono::steady_clock::now();
+  sampled = true;
+}
+
+void InputLatency::markSubmitted() {
+  if (!sampled) {
+    return;
+  }
+  sampled = false;
+
+  last = std::chrono::duration<float, std::milli>(
+             std::chrono::steady_clock::now() - sampleTime)
+             .count();
+  if (history.size() < AVERAGE_FRAMES) {
+    history.push_back(last);
+  } else {
+    history[nextSample] = last;
+  }
+  nextSample = (nextSample + 1) % AVERAGE_FRAMES;
+
+  float total = 0.0f;
+  max = 0.0f;
+  for (float latency : history) {
+    total += latency;
+    max = std::max(max, latency);
+  }
+  average = total / static_cast<float>(history.size());
+}
+
+} // namespace dunkan
@@ -0,0 +1,102 @@
+#include "app/GpuProfileLog.hpp"
+
+namespace dunkan {
+
+namespace {
+
+bool samePasses(const VulkanGpuProfiler::FrameResult &a,
+                const VulkanGpuProfiler::FrameResult &b) {
+  if (a.scopes.size() != b.scopes.size())
+    return false;
+  for (size_t i = 0; i < a.scopes.size(); i++) {
+    if (a.scopes[i].name != b.scopes[i].name)
+      return false;
+  }
+  return true;
+}
+
+} // namespace
+
+void GpuProfileLog::addFrame(const VulkanGpuProfiler::FrameResult &frame) {
+  frameNumber++;
+
+  if (csv.is_open()) {
+    csv << frameNumber << ",frame," << frame.milliseconds << ",,,\n";
+    for (const auto &scope : frame.scopes) {
+      csv << frameNumber << ',' << scope.name << ',' << scope.milliseconds;
+      if (scope.hasStatistics) {
+        csv << ',' << scope.clippingPrimitives << ','
+            << scope.fragmentInvocations << ',' << scope.computeInvocations
+            << '\n';
+      } else {
+        csv << ",,,\n";
+      }
+    }
+  }
+
+  if (sampleCount > 0 && !samePasses(frame, history.front())) {
+    history.clear();
+    nextSample = 0;
+    sampleCount = 0;
+  }
+
+  if (history.size() < AVERAGE_FRAMES) {
+    history.push_back(frame);
+  } else {
+    history[nextSample] = frame;
+  }
+  nextSample = (nextSample + 1) % AVERAGE_FRAMES;
+  sampleCount = static_cast<uint32_t>(history.size());
+
+  recomputeAverages();
+}
+
+void GpuProfileLog::recomputeAverages() {
+  const auto &passes = history.front().scopes;
+  averages.assign(passes.size(), PassAverage{});
+  for (size_t i = 0; i < passes.size(); i++) {
+    averages[i].name = passes[i].name;
+    averages[i].hasStatistics = true;
+  }
+
+  float frameTime = 0.0f;
+  for (const auto &frame : history) {
+    frameTime += frame.milliseconds;
+    for (size_t i = 0; i < frame.scopes.size(); i++) {
+      const auto &scope = frame.scopes[i];
+      PassAverage &average = averages[i];
+      average.milliseconds += scope.milliseconds;
+      average.hasStatistics = average.hasStatistics && scope.hasStatistics;
+      average.clippingPrimitives += static_cast<double>(scope.clippingPrimitives);
+      average.fragmentInvocations += static_cast<double>(scope.fragmentInvocations);
+      average.computeInvocations += static_cast<double>(scope.computeInvocations);
+    }
+  }
+
+  float count = static_cast<float>(history.size());
+  averageFrameTime = frameTime / count;
+  for (PassAverage &average : averages) {
+    average.milliseconds /= count;
+    average.clippingPrimitives /= count;
+    average.fragmentInvocations /= count;
+    average.computeInvocations /= count;
+  }
+}
+
+bool GpuProfileLog::startCsv(const std::string &path) {
+  stopCsv();
+  csv.open(path, std::ios::out | std::ios::trunc);
+  if (!csv.is_open())
+    return false;
+  csvPath = path;
+  csv << "frame,pass,gpu_ms,clipping_primitives,fragment_invocations,"
+         "compute_invocations\n";
+  return true;
+}
+
+void GpuProfileLog::stopCsv() {
+  if (csv.is_open())
+    csv.close();
+}
+
+} // namespace dunkan
@@ -1,6 +1,9 @@
 #include "app/LightingManager.hpp"
-#include "vulkan/VulkanBuffer.hpp"
+#include "utils/CpuProfiler.hpp"
+#include "vulkan/VulkanFrameAllocator.hpp"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 
 namespace dunkan {
 
@@ -10,9 +13,7 @@ LightingManager::LightingManager() {
 }
 
 void LightingManager::addLight(const LightConfig &light) {
-  if (lights.size() < 10) {
-    lights.push_back(light);
-  }
+  lights.push_back(light);
 }
 
 void LightingManager::removeLight(size_t index) {
@@ -23,32 +24,84 @@ void LightingManager::removeLight(size_t index) {
 
 LightConfig &LightingManager::getLight(size_t index) { return lights[index]; }
 
-void LightingManager::updateLightingUBO(VulkanBuffer *lightingUBO,
-                                        const glm::vec3 &ambientLight,
-                                        const glm::vec3 &viewPos) {
+Light LightingManager::packLight(const LightConfig &config) {
+  Light light{};
+  light.color = glm::vec4(config.color * config.intensity, 0.0f);
+
+  if (config.type == 0) {
+    // Directional: only the direction towards the light matters
+    light.direction = glm::vec4(-glm::normalize(config.direction), 0.0f);
+    return light;
+  }
+
+  float radius = std::max(config.radius, 1.0f);
+  float range = radius * LIGHT_RANGE_SCALE;
+  light.position = glm::vec4(config.position, range);
+  light.direction = glm::vec4(-glm::normalize(config.direction),
+                              1.0f / (radius * radius));
+  light.params.z = 1.0f / (range * range);
+
+  if (config.type == 2) {
+    // Cone falloff clamp((cos(theta) - outer) / (inner - outer)) as one
+    // multiply-add: cos(theta) * scale + offset
+    float inner = std::cos(glm::radians(config.cutoffAngle));
+    float outer = std::cos(
+        glm::radians(config.cutoffAngle + SPOT_SOFT_EDGE_DEGREES));
+    float scale = 1.0f / std::max(inner - outer, 1e-4f);
+    light.params.x = scale;
+    light.params.y = -outer * scale;
+  }
+  return light;
+}
+
+uint32_t LightingManager::updateLightingUBO(VulkanFrameAllocator &frameAllocator,
+                                            const glm::vec3 &ambientLight,
+                                            const glm::vec3 &viewPos,
+                                            const glm::vec2 &viewSize,
+                                            const glm::vec4 &renderArea) {
+  PROFILE_SCOPE("LightingManager::updateLightingUBO");
+  glm::vec2 viewMin(viewPos);
+  glm::vec2 viewMax = viewMin + viewSize;
+
+  // One pass per type keeps each type contiguous, so the shaders loop over
+  // every type separately instead of branching per light
+  packedLights.clear();
+  for (size_t type = 0; type < LIGHT_TYPE_COUNT; type++) {
+    size_t first = packedLights.size();
+
+    for (const LightConfig &config : lights) {
+      if (!config.enabled || config.type != static_cast<int>(type))
+        continue;
+
+      Light light = packLight(config);
+
+      // Drop point and spot lights whose range misses the view entirely
+      float range = light.position.w;
+      if (range > 0.0f) {
+        glm::vec2 pos(config.position);
+        glm::vec2 offset = glm::clamp(pos, viewMin, viewMax) - pos;
+        if (glm::dot(offset, offset) > range * range)
+          continue;
+      }
+
+      packedLights.push_back(light);
+    }
+    packedLightCounts[type] =
+        static_cast<uint32_t>(packedLights.size() - first);
+  }
+
   LightingUBO ubo{};
   ubo.ambientLight = glm::vec4(ambientLight, 1.0f);
   ubo.viewPos = viewPos;
-  ubo.numLights = 0;
   
   // Set view offset (camera center) for world-space light calculations
   // This ensures circular point light falloff in isometric view
-  ubo.viewOffsetPadded = glm::vec4(viewPos.x, viewPos.y, 0.0f, 0.0f);
-
-  for (size_t i = 0; i < lights.size() && i < 10; i++) {
-    if (!lights[i].enabled)
-      continue;
-
-    Light &light = ubo.lights[ubo.numLights++];
-    light.position =
-        glm::vec4(lights[i].position, static_cast<float>(lights[i].type));
-    light.direction =
-        glm::vec4(glm::normalize(lights[i].direction), lights[i].radius);
-    light.color = glm::vec4(lights[i].color, lights[i].intensity);
-    light.params = glm::vec4(lights[i].cutoffAngle, 0.0f, 0.0f, 0.0f);
-  }
+  ubo.viewRect = glm::vec4(viewPos.x, viewPos.y, viewSize.x, viewSize.y);
+  ubo.renderArea = renderArea;
+  ubo.lightCounts = glm::uvec4(packedLightCounts[0], packedLightCounts[1],
+                               packedLightCounts[2], 0);
 
-  lightingUBO->copyFrom(&ubo, sizeof(LightingUBO));
+  return frameAllocator.push(ubo);
 }
 
 void LightingManager::initializeDefaultLights() {
@@ -134,6 +187,8 @@ void LightingManager::initializeDefaultLights() {
 }
 
 void LightingManager::updateAnimatedLights(float deltaTime) {
+  PROFILE_SCOPE("LightingManager::updateAnimatedLights");
+
   static float time = 0.0f;
   time += deltaTime;
   
@@ -0,0 +1,298 @@
+#include "app/RenderBench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+
+namespace dunkan {
+
+namespace {
+
+// Material of data/ a bench sprite can use, with the sprite rect of the
+// hand-built scene
+struct BenchSprite {
+  const char *albedo;
+  const char *normal;
+  const char *height;
+  const char *material; // "" without material map
+  glm::vec2 size;
+  float heightScale;
+};
+
+const BenchSprite BENCH_SPRITES[] = {
+    {"abbey_albedo", "abbey_normal", "abbey_height", "", {1024, 1024}, 10.0f},
+    {"tree_albedo", "tree_normal", "tree_height", "tree_material", {256, 512}, 12.0f},
+    {"teapot_albedo", "teapot_normal", "teapot_height", "", {200, 200}, 8.0f},
+    {"torus_albedo", "torus_normal", "torus_height", "torus_material", {180, 180}, 7.0f},
+    {"wetsand_albedo", "wetsand_normal", "wetsand_height", "wetsand_material", {512, 512}, 1.0f},
+};
+
+// Sprites per screen at full size; scaled down beyond it
+constexpr float BENCH_BASE_SPRITES = 1000.0f;
+constexpr float BENCH_BASE_SCALE = 0.25f;
+
+// [0, 1) from the top 24 bits, identical wherever mt19937 is. Several draws in
+// one expression go in braces, which fixes their order
+float unit(std::mt19937 &rng) {
+  return static_cast<float>(rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+float range(std::mt19937 &rng, float low, float high) {
+  return low + (high - low) * unit(rng);
+}
+
+glm::vec3 lightColor(std::mt19937 &rng) {
+  return glm::vec3{range(rng, 0.3f, 1.0f), range(rng, 0.3f, 1.0f),
+                   range(rng, 0.3f, 1.0f)};
+}
+
+struct Summary {
+  float average = 0.0f;
+  float min = 0.0f;
+  float max = 0.0f;
+  float p50 = 0.0f;
+  float p95 = 0.0f;
+  float p99 = 0.0f;
+};
+
+Summary summarize(std::vector<float> values) {
+  Summary summary;
+  if (values.empty()) {
+    return summary;
+  }
+
+  std::sort(values.begin(), values.end());
+  double total = 0.0;
+  for (float value : values) {
+    total += value;
+  }
+  auto percentile = [&](float p) {
+    size_t index = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+  };
+
+  summary.average = static_cast<float>(total / values.size());
+  summary.min = values.front();
+  summary.max = values.back();
+  summary.p50 = percentile(0.50f);
+  summary.p95 = percentile(0.95f);
+  summary.p99 = percentile(0.99f);
+  return summary;
+}
+
+void writeNumber(std::ostream &out, double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+  out << buffer;
+}
+
+void writeSummary(std::ostream &out, const char *name,
+                  const std::vector<float> &values) {
+  Summary summary = summarize(values);
+  out << "    \"" << name << "\": {\"average\": ";
+  writeNumber(out, summary.average);
+  out << ", \"min\": ";
+  writeNumber(out, summary.min);
+  out << ", \"max\": ";
+  writeNumber(out, summary.max);
+  out << ", \"p50\": ";
+  writeNumber(out, summary.p50);
+  out << ", \"p95\": ";
+  writeNumber(out, summary.p95);
+  out << ", \"p99\": ";
+  writeNumber(out, summary.p99);
+  out << ", \"samples\": " << values.size() << '}';
+}
+
+} // namespace
+
+void generateBenchScene(const BenchSceneConfig &scene, const glm::vec2 &worldSize,
+                        EntityManager &entityManager,
+                        LightingManager &lightingManager) {
+  std::mt19937 rng(scene.seed);
+
+  float countScale = std::min(
+      1.0f, std::sqrt(BENCH_BASE_SPRITES /
+                      static_cast<float>(std::max(scene.spriteCount, 1u))));
+  for (uint32_t i = 0; i < scene.spriteCount; i++) {
+    const BenchSprite &sprite =
+        BENCH_SPRITES[rng() % std::size(BENCH_SPRITES)];
+
+    Entity &entity = entityManager.create_entity();
+    entityManager.add_component<PhysicsComponent>(
+        entity, PhysicsComponent{.x = range(rng, 0.0f, worldSize.x),
+                                 .y = range(rng, 0.0f, worldSize.y),
+                                 .z = range(rng, 0.0f, 1.0f)});
+    RenderComponent &render = entityManager.add_component<RenderComponent>(
+        entity, RenderComponent{nullptr,
+                                glm::vec4(0, 0, sprite.size.x, sprite.size.y),
+                                sprite.heightScale,
+                                BENCH_BASE_SCALE * countScale *
+                                    range(rng, 0.5f, 1.5f),
+                                sprite.albedo, sprite.normal, sprite.height,
+                                sprite.material});
+    render.roughness = range(rng, 0.2f, 0.9f);
+  }
+
+  while (lightingManager.getLightCount() > 0) {
+    lightingManager.removeLight(lightingManager.getLightCount() - 1);
+  }
+
+  // Directional lights share the sun's strength so the scene doesn't blow out
+  for (uint32_t i = 0; i < scene.directionalLights; i++) {
+    LightConfig light;
+    light.type = 0;
+    light.direction = glm::normalize(glm::vec3{
+        range(rng, -1.0f, 1.0f), -1.0f, range(rng, -1.0f, 1.0f)});
+    light.color = lightColor(rng);
+    light.intensity = 0.6f / static_cast<float>(scene.directionalLights);
+    light.radius = 0.0f;
+    lightingManager.addLight(light);
+  }
+
+  for (uint32_t i = 0; i < scene.pointLights; i++) {
+    LightConfig light;
+    light.type = 1;
+    light.position = glm::vec3{range(rng, 0.0f, worldSize.x),
+                               range(rng, 0.0f, worldSize.y),
+                               range(rng, 10.0f, 40.0f)};
+    light.color = lightColor(rng);
+    light.intensity = range(rng, 0.5f, 1.5f);
+    light.radius = range(rng, 100.0f, 300.0f);
+    lightingManager.addLight(light);
+  }
+
+  for (uint32_t i = 0; i < scene.spotLights; i++) {
+    LightConfig light;
+    light.type = 2;
+    light.position = glm::vec3{range(rng, 0.0f, worldSize.x),
+                               range(rng, 0.0f, worldSize.y),
+                               range(rng, 20.0f, 40.0f)};
+    light.direction = glm::normalize(glm::vec3{
+        range(rng, -1.0f, 1.0f), -1.0f, range(rng, -1.0f, 1.0f)});
+    light.color = lightColor(rng);
+    light.intensity = range(rng, 1.0f, 2.0f);
+    light.radius = range(rng, 250.0f, 400.0f);
+    light.cutoffAngle = range(rng, 20.0f, 35.0f);
+    lightingManager.addLight(light);
+  }
+}
+
+void BenchReport::addFrame(float frameMilliseconds, float cpuMilliseconds,
+                           uint32_t drawCalls, float inputLatencyMilliseconds,
+                           float limiterWaitMilliseconds) {
+  frameTimes.push_back(frameMilliseconds);
+  cpuTimes.push_back(cpuMilliseconds);
+  inputLatencies.push_back(inputLatencyMilliseconds);
+  limiterWaits.push_back(limiterWaitMilliseconds);
+  drawCallTotal += drawCalls;
+  maxDrawCalls = std::max(maxDrawCalls, drawCalls);
+}
+
+void BenchReport::addGpuFrame(const VulkanGpuProfiler::FrameResult &frame) {
+  gpuTimes.push_back(frame.milliseconds);
+
+  for (const auto &scope : frame.scopes) {
+    auto pass = std::find_if(passes.begin(), passes.end(),
+                             [&](const PassTotal &total) {
+                               return total.name == scope.name;
+                             });
+    if (pass == passes.end()) {
+      passes.push_back({scope.name, 0.0, scope.milliseconds,
+                        scope.milliseconds, 0});
+      pass = passes.end() - 1;
+    }
+    pass->milliseconds += scope.milliseconds;
+    pass->minMilliseconds = std::min(pass->minMilliseconds, scope.milliseconds);
+    pass->maxMilliseconds = std::max(pass->maxMilliseconds, scope.milliseconds);
+    pass->samples++;
+  }
+}
+
+bool BenchReport::write(const std::string &path, const BenchSceneConfig &scene,
+                        uint32_t width, uint32_t height, bool headless,
+                        const BenchPacingConfig &pacing,
+                        const VulkanMemoryAllocator::Stats &memory,
+                        uint64_t frameAllocatorPeakBytes) const {
+  std::ofstream out(path, std::ios::out | std::ios::trunc);
+  if (!out.is_open()) {
+    std::cerr << "Failed to open bench report: " << path << std::endl;
+    return false;
+  }
+
+  uint64_t reservedBytes = memory.dedicatedBytes;
+  uint64_t usedBytes = memory.dedicatedBytes;
+  for (const auto &pool : memory.pools) {
+    reservedBytes += pool.blockBytes;
+    usedBytes += pool.usedBytes;
+  }
+
+  out << "{\n";
+  out << "  \"scene\": {\"seed\": " << scene.seed
+      << ", \"sprites\": " << scene.spriteCount
+      << ", \"pointLights\": " << scene.pointLights
+      << ", \"spotLights\": " << scene.spotLights
+      << ", \"directionalLights\": " << scene.directionalLights
+      << ", \"ssao\": " << (scene.ssao ? "true" : "false") << "},\n";
+  out << "  \"output\": {\"width\": " << width << ", \"height\": " << height
+      << ", \"headless\": " << (headless ? "true" : "false") << "},\n";
+  out << "  \"frames\": " << frameTimes.size() << ",\n";
+
+  out << "  \"cpuMilliseconds\": {\n";
+  writeSummary(out, "frame", frameTimes);
+  out << ",\n";
+  writeSummary(out, "recordAndSubmit", cpuTimes);
+  out << "\n  },\n";
+
+  out << "  \"framePacing\": {\"framesInFlight\": " << pacing.framesInFlight
+      << ", \"presentMode\": \"" << pacing.presentMode
+      << "\", \"frameRateLimit\": ";
+  writeNumber(out, pacing.frameRateLimit);
+  out << ", \"lateInputSampling\": "
+      << (pacing.lateInputSampling ? "true" : "false") << ",\n";
+  writeSummary(out, "inputLatencyMilliseconds", inputLatencies);
+  out << ",\n";
+  writeSummary(out, "limiterWaitMilliseconds", limiterWaits);
+  out << "\n  },\n";
+
+  out << "  \"gpuMilliseconds\": {\n";
+  writeSummary(out, "frame", gpuTimes);
+  out << ",\n    \"passes\": [";
+  for (size_t i = 0; i < passes.size(); i++) {
+    const PassTotal &pass = passes[i];
+    out << (i == 0 ? "\n" : ",\n") << "      {\"name\": \"" << pass.name
+        << "\", \"average\": ";
+    writeNumber(out, pass.milliseconds / pass.samples);
+    out << ", \"min\": ";
+    writeNumber(out, pass.minMilliseconds);
+    out << ", \"max\": ";
+    writeNumber(out, pass.maxMilliseconds);
+    out << ", \"samples\": " << pass.samples << '}';
+  }
+  out << (passes.empty() ? "]" : "\n    ]") << "\n  },\n";
+
+  out << "  \"drawCalls\": {\"average\": ";
+  writeNumber(out, frameTimes.empty()
+                       ? 0.0
+                       : static_cast<double>(drawCallTotal) / frameTimes.size());
+  out << ", \"max\": " << maxDrawCalls << "},\n";
+
+  out << "  \"memory\": {\"reservedBytes\": " << reservedBytes
+      << ", \"usedBytes\": " << usedBytes
+      << ", \"dedicatedBytes\": " << memory.dedicatedBytes
+      << ", \"deviceMemoryCount\": " << memory.deviceMemoryCount
+      << ", \"frameAllocatorPeakBytes\": " << frameAllocatorPeakBytes << "}\n";
+  out << "}\n";
+
+  if (!out.good()) {
+    std::cerr << "Failed to write bench report: " << path << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace dunkan
@@ -1,12 +1,20 @@
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
 #include <stdexcept>
 #include <vector>
 #include <vulkan/vulkan.h>
@@ -20,19 +28,33 @@
 #include "vulkan/VulkanBuffer.hpp"
 #include "vulkan/VulkanContext.hpp"
 #include "vulkan/VulkanDescriptorManager.hpp"
+#include "vulkan/VulkanFrameAllocator.hpp"
+#include "vulkan/VulkanGpuProfiler.hpp"
 #include "vulkan/VulkanImage.hpp"
+#include "vulkan/VulkanLightCulling.hpp"
+#include "vulkan/VulkanMergedPass.hpp"
+#include "vulkan/VulkanOffscreenTarget.hpp"
 #include "vulkan/VulkanPipeline.hpp"
+#include "vulkan/VulkanPipelineCache.hpp"
+#include "vulkan/VulkanRenderGraph.hpp"
 #include "vulkan/VulkanRenderPass.hpp"
 #include "vulkan/VulkanRenderSystem.hpp"
 #include "vulkan/VulkanResourceManager.hpp"
 #include "vulkan/VulkanSSAO.hpp"
 #include "vulkan/VulkanSwapchain.hpp"
+#include "vulkan/VulkanUploadManager.hpp"
+#include "vulkan/VulkanUpscaler.hpp"
 #include "vulkan/VulkanTypes.hpp"
+#include "utils/CpuProfiler.hpp"
 
 // Application components
 #include "app/ApplicationConfig.hpp"
 #include "app/DebugUI.hpp"
+#include "app/DynamicResolution.hpp"
+#include "app/FramePacing.hpp"
+#include "app/GpuProfileLog.hpp"
 #include "app/LightingManager.hpp"
+#include "app/RenderBench.hpp"
 
 // Type aliases for entity iteration
 using VulkanRenderSystem_c =
@@ -41,7 +63,17 @@ using VulkanRenderSystem_t = ADE::META_TYPES::Typelist<>;
 
 const int WIDTH = 1920;
 const int HEIGHT = 1080;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Per-frame resources are created for the most frames in flight;
+// config.framesInFlight of them are cycled through
+const int MAX_FRAMES_IN_FLIGHT = 3;
+const VkDeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024; // Per frame in flight
+// Swapchain present mode and command line name of each
+// ApplicationConfig::PresentMode
+const VkPresentModeKHR PRESENT_MODES[] = {
+    VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+    VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+const char *const PRESENT_MODE_NAMES[] = {"fifo", "fifo-relaxed", "mailbox",
+                                          "immediate"};
 
 unsigned int m_frame = 0;
 unsigned int m_fps = 0;
@@ -51,35 +83,143 @@ struct UniformBufferObject {
   alignas(16) glm::mat4 proj;
 };
 
+// Command line: --headless renders without a window or surface, --frames N
+// renders N fixed-timestep frames (headless) and exits, --out dir writes each
+// of them to dir as a PNG (headless too). render_bench fills in the bench fields. Frame
+// pacing options override the configuration's defaults
+struct RunOptions {
+  bool headless = false;
+  uint32_t frames = 0;   // 0: until the window is closed
+  std::string outputDir; // Empty: no readback
+
+  std::optional<int> framesInFlight;
+  std::optional<dunkan::ApplicationConfig::PresentMode> presentMode;
+  std::optional<float> frameRateLimit;
+  std::optional<bool> lateInputSampling;
+
+  bool bench = false; // Render benchScene instead of the game scene
+  dunkan::BenchSceneConfig benchScene;
+  uint32_t warmupFrames = 0; // Rendered before measuring
+  std::string reportPath;
+};
+
 class VulkanApplication {
 public:
-  void run() {
-    initWindow();
+  void run(const RunOptions &options) {
+    runOptions = options;
+    headless = options.headless;
+    if (runOptions.bench) {
+      config.enableSSAO = runOptions.benchScene.ssao;
+      config.showDebugWindow = false;
+    }
+    if (options.framesInFlight) {
+      config.framesInFlight = *options.framesInFlight;
+    }
+    if (options.presentMode) {
+      config.presentMode = *options.presentMode;
+    }
+    if (options.frameRateLimit) {
+      config.frameRateLimit = *options.frameRateLimit;
+    }
+    if (options.lateInputSampling) {
+      config.lateInputSampling = *options.lateInputSampling;
+    }
+    config.framesInFlight =
+        std::clamp(config.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    framesInFlight = static_cast<uint32_t>(config.framesInFlight);
+
+    if (!headless) {
+      initWindow();
+    }
     initVulkan();
+    // Default/noise textures are sampled from the first frame on; everything
+    // queued so far goes out in one submission
+    vulkanContext->getUploadManager().waitIdle();
     loadGameEntities();
-    mainLoop();
+    if (runOptions.frames > 0) {
+      renderFixedFrames();
+    } else {
+      mainLoop();
+    }
     cleanup();
   }
 
 private:
+  RunOptions runOptions;
+  bool headless = false; // No window: offscreen replaces swapchain, no ImGui
   GLFWwindow *window = nullptr;
   VulkanContext *vulkanContext = nullptr;
   VulkanSwapchain *swapchain = nullptr;
+  VulkanOffscreenTarget *offscreen = nullptr;
+  // Headless: the frame number each slot's image was read back for, or
+  // UINT32_MAX
+  std::vector<uint32_t> pendingReadbacks;
+  uint32_t frameNumber = 0;
+  // Fixed-frame runs time the frames; the fence wait is not CPU work
+  float lastFenceWaitTime = 0.0f;
+  dunkan::BenchReport benchReport;
+  VkDeviceSize frameAllocatorPeak = 0;
   VulkanRenderPass *renderPass = nullptr;
   VulkanPipeline *pipeline = nullptr;
   VulkanPipeline *compPipeline = nullptr;
   VulkanDescriptorManager *descriptorManager = nullptr;
+  VulkanFrameAllocator *frameAllocator = nullptr;
   VulkanRenderSystem *renderSystem = nullptr;
   VulkanSSAO *ssao = nullptr;
+  VulkanLightCulling *lightCulling = nullptr;
+  VulkanMergedPass *mergedPass = nullptr; // nullptr unless config.mergedGBufferPass
+  VulkanRenderGraph *renderGraph = nullptr;
+  VulkanGpuProfiler *gpuProfiler = nullptr;
+  VulkanUpscaler *upscaler = nullptr;
   EntityManager entity_manager;
 
+  // Passes the frame graph was built for; rebuilt when the settings change
+  struct FrameGraphConfig {
+    bool merged = false;      // G-buffer + composition in one render pass
+    bool ssao = false;
+    bool reducedSSAO = false; // Compute path (half/quarter resolution)
+    bool upscale = false;     // Compose at the internal resolution, then EASU + RCAS
+    bool operator==(const FrameGraphConfig &) const = default;
+  };
+  FrameGraphConfig frameGraphConfig;
+  RenderGraphResource gbufferTargets[4] = {}; // Color, normal, linear depth, material
+  RenderGraphResource gbufferDepthStencil = 0;
+  RenderGraphResource ssaoResult = 0;
+  RenderGraphResource ssaoWork[2] = {};
+  RenderGraphResource ssaoHistory[2] = {};
+  RenderGraphResource swapchainImage = 0;
+  RenderGraphResource tileLists = 0;
+  RenderGraphResource sceneColor = 0;    // Composed at the internal resolution
+  RenderGraphResource upscaledColor = 0;
+  // Read by the graph's passes while recording
+  uint32_t currentImageIndex = 0;
+  ShaderPermutation compositePermutation{};
+
   std::vector<VkCommandBuffer> commandBuffers;
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
   std::vector<VkFence> inFlightFences;
   std::vector<VkDescriptorSet> descriptorSets;
   VkDescriptorSet compDescriptorSet;
+  uint32_t lightingUBOOffset = 0;
+  glm::vec3 viewPos = glm::vec3(960.0f, 540.0f, 10.0f);
   uint32_t currentFrame = 0;
+  uint32_t framesInFlight = 2; // Slots cycled through, config.framesInFlight
+
+  // Frame pacing: the frame loops hold frames to config.frameRateLimit and
+  // polls input before the frame's fence wait, or after it and the acquire
+  // with late input sampling
+  dunkan::FrameLimiter frameLimiter;
+  dunkan::InputLatency inputLatency;
+  bool sampleInputLate = false; // This frame's drawFrame() polls input
+
+  // Internal resolution: the G-buffer, SSAO and light culling render into the
+  // top-left renderExtent of their window-sized targets
+  VkExtent2D renderExtent{};
+  dunkan::DynamicResolution dynamicResolution;
+  bool dynamicResolutionActive = false;
+  float gpuFrameTime = -1.0f; // Last measured, -1 without timestamps
+  dunkan::GpuProfileLog gpuProfileLog;
 
   // ImGui resources
   VkDescriptorPool imguiDescriptorPool = VK_NULL_HANDLE;
@@ -105,46 +245,128 @@ private:
     vulkanContext = new VulkanContext();
     vulkanContext->init(window);
 
-    swapchain = new VulkanSwapchain(*vulkanContext, window);
-    swapchain->create();
+    // Headless frames go to an image per frame in flight, read back by copy
+    if (headless) {
+      offscreen = new VulkanOffscreenTarget(*vulkanContext);
+      offscreen->create({static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT)},
+                        MAX_FRAMES_IN_FLIGHT);
+      pendingReadbacks.assign(MAX_FRAMES_IN_FLIGHT, UINT32_MAX);
+    } else {
+      swapchain = new VulkanSwapchain(*vulkanContext, window);
+      swapchain->setPresentMode(
+          PRESENT_MODES[static_cast<int>(config.presentMode)]);
+      swapchain->create();
+    }
 
-    renderPass =
-        new VulkanRenderPass(*vulkanContext, swapchain->getImageFormat());
-    renderPass->createGBufferRenderPass();
+    renderPass = new VulkanRenderPass(*vulkanContext, getOutputFormat());
+    GBufferLayout gbufferLayout =
+        config.compactGBuffer ? GBufferLayout::Compact : GBufferLayout::Standard;
+    renderPass->createGBufferRenderPass(gbufferLayout);
+    if (config.mergedGBufferPass) {
+      renderPass->createMergedRenderPass(gbufferLayout);
+      renderPass->createOverlayRenderPass();
+    }
     renderPass->createSSAORenderPass(); // We can create the render pass even if
                                         // we don't use it
     renderPass->create();               // Final render pass
 
-    swapchain->createFramebuffers(renderPass->getFinalRenderPass());
+    if (headless) {
+      offscreen->createFramebuffers(renderPass->getFinalRenderPass());
+    } else {
+      swapchain->createFramebuffers(renderPass->getFinalRenderPass());
+    }
 
     pipeline = new VulkanPipeline(*vulkanContext);
     pipeline->createGraphicsPipeline(
         renderPass->getGBufferRenderPass(), "shaders/default.vert.spv",
-        "shaders/color.frag.spv", swapchain->getExtent(),
+        "shaders/color.frag.spv",
         4 // 4 Color Attachments for G-Buffer
     );
 
     descriptorManager = new VulkanDescriptorManager(*vulkanContext);
     descriptorManager->createDescriptorPool(100);
 
+    frameAllocator = new VulkanFrameAllocator(*vulkanContext);
+    // Sprite instances go to the frame allocator too; the bench scene can
+    // have far more of them than the game
+    VkDeviceSize frameAllocatorSize = FRAME_ALLOCATOR_SIZE;
+    if (runOptions.bench) {
+      frameAllocatorSize += static_cast<VkDeviceSize>(
+                                runOptions.benchScene.spriteCount) *
+                            sizeof(SpriteInstance);
+    }
+    frameAllocator->create(frameAllocatorSize, MAX_FRAMES_IN_FLIGHT);
+
     renderSystem = new VulkanRenderSystem(*vulkanContext, *descriptorManager,
-                                          *pipeline, entity_manager);
-    renderSystem->initGBuffer(renderPass->getGBufferRenderPass(),
-                              swapchain->getExtent());
+                                          *pipeline, entity_manager,
+                                          *frameAllocator);
 
     // Initialize SSAO
-    ssao = new VulkanSSAO(*vulkanContext);
-    ssao->init(renderPass->getSSAORenderPass(), swapchain->getExtent());
+    ssao = new VulkanSSAO(*vulkanContext, *frameAllocator);
+    ssao->init(renderPass->getSSAORenderPass(), getOutputExtent());
+
+    // Timestamps around the frame and each of the frame graph's passes
+    gpuProfiler = new VulkanGpuProfiler(*vulkanContext);
+    gpuProfiler->init(MAX_FRAMES_IN_FLIGHT);
+
+    // Upscales the composed scene when rendering below the window size
+    upscaler = new VulkanUpscaler(*vulkanContext, *descriptorManager);
+    upscaler->init(renderPass->getFinalRenderPass(), getOutputFormat(),
+                   getOutputExtent());
+
+    // The frame graph owns the depth buffer, SSAO scratch images and the
+    // upscaler's images, so they exist once it placed them
+    createRenderGraph();
+
+    renderSystem->initGBuffer(renderPass->getGBufferRenderPass(),
+                              getOutputExtent(), gbufferLayout,
+                              renderGraph->getImage(gbufferDepthStencil));
+    setGBufferImages();
+
+    // Initialize tiled light culling (reads the G-buffer depth)
+    lightCulling = new VulkanLightCulling(*vulkanContext, *descriptorManager);
+    lightCulling->init(renderSystem->getGBuffer().depthRT,
+                       getOutputExtent(), MAX_FRAMES_IN_FLIGHT);
 
     // Create Composition Pipeline
     compPipeline = new VulkanPipeline(*vulkanContext);
     compPipeline->createCompositionPipeline(
         renderPass->getFinalRenderPass(), "shaders/composite.vert.spv",
-        "shaders/composite.frag.spv", swapchain->getExtent());
+        "shaders/composite.frag.spv",
+        lightCulling->getDescriptorSetLayout());
 
     compDescriptorSet = descriptorManager->allocateDescriptorSet(
         compPipeline->getDescriptorSetLayout());
 
+    writeTargetDescriptors();
+
+    // Merged G-buffer + composition pass, used while SSAO is off
+    if (config.mergedGBufferPass) {
+      mergedPass = new VulkanMergedPass(*vulkanContext, *descriptorManager);
+      mergedPass->init(renderPass->getMergedRenderPass(),
+                       getOutputExtent(), gbufferLayout,
+                       lightCulling->getDescriptorSetLayout(),
+                       frameAllocator->getBuffer(),
+                       sizeof(dunkan::LightingUBO));
+      mergedPass->createFramebuffers(getOutputImageViews(), getOutputExtent());
+      renderSystem->setSubpassPipeline(&mergedPass->getGBufferPipeline());
+    }
+
+    createCommandBuffers();
+    createSyncObjects();
+    if (!headless) {
+      initImGui();
+    }
+
+    // Initialize default lights
+    initializeLights();
+
+    std::cout << "Vulkan initialized successfully!" << std::endl;
+  }
+
+  // Descriptors reading the window-sized targets, written again whenever they
+  // are recreated
+  void writeTargetDescriptors() {
     // Update Composition Descriptor Set (5 bindings: 4 G-Buffer + 1 SSAO)
     descriptorManager->updateTextureDescriptor(
         compDescriptorSet, 0,
@@ -166,38 +388,319 @@ private:
                                                ssao->ssaoOutput->getImageView(),
                                                ssao->ssaoOutput->getSampler());
 
-    // Bind lighting UBO to composition descriptor set
-    VkDescriptorBufferInfo lightingBufferInfo{};
-    lightingBufferInfo.buffer = renderSystem->getLightingUBO()->getBuffer();
-    lightingBufferInfo.offset = 0;
-    lightingBufferInfo.range = sizeof(LightingUBO);
-
-    VkWriteDescriptorSet lightingWrite{};
-    lightingWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    lightingWrite.dstSet = compDescriptorSet;
-    lightingWrite.dstBinding = 5;
-    lightingWrite.dstArrayElement = 0;
-    lightingWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    lightingWrite.descriptorCount = 1;
-    lightingWrite.pBufferInfo = &lightingBufferInfo;
-
-    vkUpdateDescriptorSets(vulkanContext->getDevice(), 1, &lightingWrite, 0,
-                           nullptr);
-
-    // Update SSAO Descriptor Set
-    VkDescriptorSet ssaoSet =
-        descriptorManager->allocateDescriptorSet(ssao->descriptorSetLayout);
-    ssao->updateDescriptorSet(ssaoSet, renderSystem->getGBuffer().depthRT,
-                              renderSystem->getGBuffer().normalRT);
+    // Bind lighting UBO to composition descriptor set (offset supplied per
+    // frame)
+    descriptorManager->updateDynamicUniformBuffer(
+        compDescriptorSet, 5, frameAllocator->getBuffer(),
+        sizeof(dunkan::LightingUBO));
+
+    // Update SSAO Descriptor Sets
+    ssao->updateDescriptorSets(*descriptorManager,
+                               renderSystem->getGBuffer().depthRT,
+                               renderSystem->getGBuffer().normalRT,
+                               renderGraph->getImage(ssaoWork[0]),
+                               renderGraph->getImage(ssaoWork[1]));
+
+    upscaler->setTargets(renderGraph->getImage(sceneColor),
+                         renderGraph->getImage(upscaledColor));
+  }
 
-    createCommandBuffers();
-    createSyncObjects();
-    initImGui();
+  void recreateSwapchain() {
+    // Nothing can be presented while minimized
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    while (width == 0 || height == 0) {
+      glfwWaitEvents();
+      glfwGetFramebufferSize(window, &width, &height);
+    }
 
-    // Initialize default lights
-    initializeLights();
+    swapchain->recreate();
+    swapchain->createFramebuffers(renderPass->getFinalRenderPass());
+    resizeRenderTargets();
+  }
 
-    std::cout << "Vulkan initialized successfully!" << std::endl;
+  // Recreates everything sized after the window. swapchain->recreate() waited
+  // for the device, so none of the old targets are in use
+  void resizeRenderTargets() {
+    VkExtent2D extent = getOutputExtent();
+
+    ssao->resize(extent);
+    upscaler->resize(extent);
+
+    // Transients are placed once, so the graph starts over at the new size
+    delete renderGraph;
+    createRenderGraph();
+
+    renderSystem->resizeGBuffer(extent,
+                                renderGraph->getImage(gbufferDepthStencil));
+    setGBufferImages();
+    lightCulling->resize(renderSystem->getGBuffer().depthRT, extent);
+    writeTargetDescriptors();
+
+    if (mergedPass != nullptr) {
+      mergedPass->resize(getOutputImageViews(), extent);
+    }
+    debugUI->setViewportSize(static_cast<float>(extent.width),
+                             static_cast<float>(extent.height));
+  }
+
+  void setGBufferImages() {
+    const GBuffer &gbuffer = renderSystem->getGBuffer();
+    VulkanImage *targets[] = {gbuffer.colorRT, gbuffer.normalRT,
+                              gbuffer.depthRT, gbuffer.materialRT};
+    for (uint32_t i = 0; i < 4; i++) {
+      renderGraph->setImage(gbufferTargets[i], targets[i]->getImage());
+    }
+  }
+
+  // The final passes' target: the swapchain, or the offscreen images when
+  // headless
+  VkExtent2D getOutputExtent() const {
+    return headless ? offscreen->getExtent() : swapchain->getExtent();
+  }
+  VkFormat getOutputFormat() const {
+    return headless ? offscreen->getImageFormat() : swapchain->getImageFormat();
+  }
+  const std::vector<VkImage> &getOutputImages() const {
+    return headless ? offscreen->getImages() : swapchain->getImages();
+  }
+  const std::vector<VkImageView> &getOutputImageViews() const {
+    return headless ? offscreen->getImageViews() : swapchain->getImageViews();
+  }
+  VkFramebuffer getOutputFramebuffer() const {
+    return headless ? offscreen->getFramebuffers()[currentImageIndex]
+                    : swapchain->getFramebuffers()[currentImageIndex];
+  }
+
+  // World units covered by the window: one per pixel at zoom 1
+  glm::vec2 getViewSize() const {
+    VkExtent2D extent = getOutputExtent();
+    return glm::vec2(static_cast<float>(extent.width),
+                     static_cast<float>(extent.height));
+  }
+
+  // Picks this frame's internal resolution from the render scale, which the
+  // controller drives from the GPU time of finished frames while enabled
+  void updateRenderExtent() {
+    PROFILE_SCOPE("updateRenderExtent");
+    bool measured = gpuProfiler->readResults(currentFrame);
+    float gpuTime = gpuProfiler->getLastFrame().milliseconds;
+    if (measured) {
+      gpuFrameTime = gpuTime;
+      gpuProfileLog.addFrame(gpuProfiler->getLastFrame());
+      // The results are of the frame this slot rendered last
+      if (runOptions.bench &&
+          frameNumber >= runOptions.warmupFrames + framesInFlight) {
+        benchReport.addGpuFrame(gpuProfiler->getLastFrame());
+      }
+    }
+
+    if (config.dynamicResolution && gpuProfiler->isSupported()) {
+      if (!dynamicResolutionActive) {
+        dynamicResolution.reset(config.renderScale);
+        dynamicResolutionActive = true;
+      }
+      if (measured) {
+        dynamicResolution.update(gpuTime, config.targetFrameRate,
+                                 config.minRenderScale);
+      }
+      config.renderScale = dynamicResolution.getScale();
+    } else {
+      dynamicResolutionActive = false;
+    }
+    config.renderScale = std::clamp(config.renderScale, 0.25f, 1.0f);
+
+    VkExtent2D extent = getOutputExtent();
+    renderExtent.width = std::clamp(
+        static_cast<uint32_t>(std::lround(extent.width * config.renderScale)),
+        1u, extent.width);
+    renderExtent.height = std::clamp(
+        static_cast<uint32_t>(std::lround(extent.height * config.renderScale)),
+        1u, extent.height);
+    lightCulling->setRenderExtent(renderExtent);
+
+    debugUI->setFrameStats(gpuFrameTime, static_cast<int>(renderExtent.width),
+                           static_cast<int>(renderExtent.height));
+  }
+
+  void createRenderGraph() {
+    renderGraph = new VulkanRenderGraph(*vulkanContext);
+    renderGraph->setProfiler(gpuProfiler);
+    VkExtent2D extent = getOutputExtent();
+
+    // Kept between frames, in the layout their descriptors were written with
+    const char *targetNames[] = {"gbuffer.color", "gbuffer.normal",
+                                 "gbuffer.depth", "gbuffer.material"};
+    for (uint32_t i = 0; i < 4; i++) {
+      gbufferTargets[i] = renderGraph->importImage(
+          targetNames[i], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    ssaoResult = renderGraph->importImage(
+        "ssao.output", VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    renderGraph->setImage(ssaoResult, ssao->ssaoOutput->getImage());
+    for (uint32_t i = 0; i < 2; i++) {
+      ssaoHistory[i] = renderGraph->importImage(
+          i == 0 ? "ssao.history0" : "ssao.history1", VK_IMAGE_LAYOUT_GENERAL);
+      renderGraph->setImage(ssaoHistory[i],
+                            ssao->getHistoryImage(i)->getImage());
+    }
+    // Headless output is copied into its readback buffer after the graph
+    swapchainImage = renderGraph->importSwapchainImage(
+        "swapchain", headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                              : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    tileLists = renderGraph->importBuffer("light_cull.tiles");
+
+    // Only alive during the pass using them, so they can share memory
+    VulkanRenderGraph::ImageDesc depthDesc;
+    depthDesc.width = extent.width;
+    depthDesc.height = extent.height;
+    depthDesc.format = vulkanContext->findDepthFormat();
+    depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    gbufferDepthStencil =
+        renderGraph->createImage("gbuffer.depthStencil", depthDesc);
+    ssaoWork[0] =
+        renderGraph->createImage("ssao.work0", ssao->getWorkImageDesc());
+    ssaoWork[1] =
+        renderGraph->createImage("ssao.work1", ssao->getWorkImageDesc());
+    sceneColor = renderGraph->createImage("upscale.scene",
+                                          upscaler->getSceneColorDesc());
+    upscaledColor = renderGraph->createImage("upscale.output",
+                                             upscaler->getUpscaledDesc());
+
+    // Placed for the configuration with the most passes, every other one
+    // runs a subset of them
+    buildFrameGraph({false, true, true, true});
+  }
+
+  void buildFrameGraph(const FrameGraphConfig &graphConfig) {
+    frameGraphConfig = graphConfig;
+    renderGraph->reset();
+
+    if (graphConfig.merged) {
+      // The G-buffer only exists inside the merged pass, so lights are binned
+      // before it by their screen footprint, without the tiles' depth range
+      renderGraph
+          ->addPass("light_cull",
+                    [this](VkCommandBuffer commandBuffer) {
+                      lightCulling->dispatch(commandBuffer, currentFrame,
+                                             glm::vec2(viewPos),
+                                             getViewSize(), false);
+                    })
+          .write(tileLists, RenderGraphUsage::StorageWrite);
+
+      // G-buffer subpass, then composition through input attachments
+      renderGraph
+          ->addPass("merged",
+                    [this](VkCommandBuffer commandBuffer) {
+                      mergedPass->begin(commandBuffer, currentImageIndex);
+                      renderSystem->drawEntities(commandBuffer, currentFrame);
+                      mergedPass->compose(
+                          commandBuffer, compositePermutation,
+                          lightingUBOOffset,
+                          lightCulling->getDescriptorSet(currentFrame),
+                          config.gammaCorrection,
+                          lightCulling->getTileCountX());
+                      mergedPass->end(commandBuffer);
+                    })
+          .read(tileLists, RenderGraphUsage::StorageRead)
+          .write(swapchainImage, RenderGraphUsage::ColorAttachment);
+
+      // Render ImGui on top, keeping the composed image
+      renderGraph
+          ->addPass("overlay",
+                    [this](VkCommandBuffer commandBuffer) {
+                      recordOverlay(commandBuffer);
+                    })
+          .readWrite(swapchainImage, RenderGraphUsage::ColorAttachment);
+
+      renderGraph->compile();
+      return;
+    }
+
+    // 1. G-Buffer Pass (Off-screen)
+    auto gbufferPass = renderGraph->addPass(
+        "gbuffer", [this](VkCommandBuffer commandBuffer) {
+          renderSystem->renderEntities(commandBuffer, currentFrame,
+                                       renderExtent);
+        });
+    for (RenderGraphResource target : gbufferTargets) {
+      gbufferPass.write(target, RenderGraphUsage::ColorAttachment);
+    }
+    gbufferPass.write(gbufferDepthStencil, RenderGraphUsage::DepthAttachment);
+
+    // Bin lights into screen tiles using the G-buffer depth
+    renderGraph
+        ->addPass("light_cull",
+                  [this](VkCommandBuffer commandBuffer) {
+                    lightCulling->dispatch(commandBuffer, currentFrame,
+                                           glm::vec2(viewPos),
+                                           getViewSize());
+                  })
+        .read(gbufferTargets[2], RenderGraphUsage::SampledCompute)
+        .write(tileLists, RenderGraphUsage::StorageWrite);
+
+    // 2. SSAO Pass (Off-screen), culled by the graph when composition doesn't
+    // read its output
+    auto ssaoPass = renderGraph->addPass(
+        "ssao", [this](VkCommandBuffer commandBuffer) {
+          glm::vec2 viewSize = getViewSize();
+          glm::mat4 projection = glm::ortho(0.0f, viewSize.x, viewSize.y, 0.0f,
+                                            -100.0f, 100.0f);
+          ssao->record(commandBuffer, projection, glm::vec2(viewPos), viewSize,
+                       renderExtent);
+        });
+    ssaoPass.read(gbufferTargets[2], RenderGraphUsage::SampledFragment)
+        .read(gbufferTargets[1], RenderGraphUsage::SampledFragment)
+        .write(ssaoResult, RenderGraphUsage::ColorAttachment);
+    if (graphConfig.reducedSSAO) {
+      // Compute stages, then the upsample's fragment shader
+      ssaoPass.read(gbufferTargets[2], RenderGraphUsage::SampledCompute)
+          .read(gbufferTargets[1], RenderGraphUsage::SampledCompute);
+      for (uint32_t i = 0; i < 2; i++) {
+        ssaoPass.readWrite(ssaoWork[i], RenderGraphUsage::General)
+            .readWrite(ssaoHistory[i], RenderGraphUsage::General);
+      }
+    }
+
+    // 3. Final Composition Pass (To Swapchain)
+    auto compositionPass = renderGraph->addPass(
+        "composition", [this](VkCommandBuffer commandBuffer) {
+          recordComposition(commandBuffer);
+        });
+    for (RenderGraphResource target : gbufferTargets) {
+      compositionPass.read(target, RenderGraphUsage::SampledFragment);
+    }
+    if (graphConfig.ssao) {
+      compositionPass.read(ssaoResult, RenderGraphUsage::SampledFragment);
+    }
+    compositionPass.read(tileLists, RenderGraphUsage::StorageRead);
+    if (!graphConfig.upscale) {
+      compositionPass.write(swapchainImage, RenderGraphUsage::ColorAttachment);
+      renderGraph->compile();
+      return;
+    }
+    compositionPass.write(sceneColor, RenderGraphUsage::ColorAttachment);
+
+    // 4. Upscale the composed scene to the window size
+    renderGraph
+        ->addPass("easu",
+                  [this](VkCommandBuffer commandBuffer) {
+                    upscaler->upscale(commandBuffer, renderExtent);
+                  })
+        .read(sceneColor, RenderGraphUsage::SampledCompute)
+        .write(upscaledColor, RenderGraphUsage::General);
+
+    // 5. Sharpen into the swapchain image, ImGui on top
+    renderGraph
+        ->addPass("rcas",
+                  [this](VkCommandBuffer commandBuffer) {
+                    recordOutput(commandBuffer);
+                  })
+        .read(upscaledColor, RenderGraphUsage::General)
+        .write(swapchainImage, RenderGraphUsage::ColorAttachment);
+
+    renderGraph->compile();
   }
 
   void createCommandBuffers() {
@@ -284,7 +787,7 @@ private:
     init_info.QueueFamily =
         vulkanContext->getQueueFamilies().graphicsFamily.value();
     init_info.Queue = vulkanContext->getGraphicsQueue();
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.PipelineCache = vulkanContext->getPipelineCache().getCache();
     init_info.DescriptorPool = imguiDescriptorPool;
     init_info.Subpass = 0;
     init_info.MinImageCount = 2;
@@ -305,33 +808,66 @@ private:
   }
 
   void initializeLights() {
-    // Initialize default lights using LightingManager
-    lightingManager.initializeDefaultLights();
+    // Initialize default lights using LightingManager (the bench scene
+    // brings its own)
+    if (!runOptions.bench) {
+      lightingManager.initializeDefaultLights();
+    }
 
     // Create DebugUI instance now that entity_manager exists
     debugUI = std::make_unique<dunkan::DebugUI>(config, lightingManager);
+    debugUI->setMemoryAllocator(&vulkanContext->getAllocator());
+    debugUI->setGpuProfileLog(&gpuProfileLog, gpuProfiler->supportsStatistics());
+    VkExtent2D extent = getOutputExtent();
+    debugUI->setViewportSize(static_cast<float>(extent.width),
+                             static_cast<float>(extent.height));
   }
 
   void updateLightingUBO() {
+    PROFILE_SCOPE("updateLightingUBO");
     // Update SSAO parameters from config
     ssao->updateParameters(config.ssaoRadius, config.ssaoBias,
-                           config.ssaoPower);
-
-    // Update lighting UBO using LightingManager
-    glm::vec3 viewPos = glm::vec3(960.0f, 540.0f, 10.0f);
-    lightingManager.updateLightingUBO(renderSystem->getLightingUBO(),
-                                      config.ambientLight, viewPos);
+                           config.ssaoPower, config.ssaoKernelSize,
+                           config.ssaoDownscale, config.ssaoTemporal);
+
+    // Update lighting UBO using LightingManager; composition samples the
+    // rendered part of the window-sized targets
+    VkExtent2D extent = getOutputExtent();
+    glm::vec2 renderSize(static_cast<float>(renderExtent.width),
+                         static_cast<float>(renderExtent.height));
+    glm::vec4 renderArea(renderSize.x / static_cast<float>(extent.width),
+                         renderSize.y / static_cast<float>(extent.height),
+                         renderSize);
+    lightingUBOOffset = lightingManager.updateLightingUBO(
+        *frameAllocator, config.ambientLight, viewPos, getViewSize(),
+        renderArea);
+
+    // Upload this frame's lights for culling and composition
+    static_assert(sizeof(dunkan::Light) == VulkanLightCulling::LIGHT_SIZE);
+    const auto &lightCounts = lightingManager.getPackedLightCounts();
+    lightCulling->updateLights(currentFrame,
+                               lightingManager.getPackedLights().data(),
+                               lightCounts[0], lightCounts[1], lightCounts[2]);
   }
 
   void renderDebugUI() {
+    PROFILE_SCOPE("renderDebugUI");
+
     // Start ImGui frame
     ImGui_ImplVulkan_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    // F11 captures CPU markers, also with the debug window hidden
+    if (ImGui::IsKeyPressed(ImGuiKey_F11, false)) {
+      CpuProfiler::requestCapture(
+          static_cast<uint32_t>(config.cpuCaptureFrames), "cpu_trace.json");
+    }
+
     // Rebuild entity cache only when needed (on first frame or after entity
     // changes)
     if (entityCacheNeedsRebuild) {
+      PROFILE_SCOPE("rebuildEntityCache");
       entityEditCache.clear();
       entity_manager.foreach<VulkanRenderSystem_c, VulkanRenderSystem_t>(
           [&](Entity &, RenderComponent &renderComp,
@@ -343,6 +879,7 @@ private:
     }
 
     // Render debug UI using component
+    debugUI->setFramePacingStats(getFramePacingStats());
     debugUI->render(m_fps, entity_manager.get_entities_count(),
                     entityEditCache);
 
@@ -350,36 +887,51 @@ private:
     ImGui::Render();
   }
 
-  void loadGameEntities() {
-    // Mark cache for rebuild after loading entities
-    std::cout << "Loading game entities..." << std::endl;
-
-    try {
-      // Load all textures first
-      std::cout << "Loading textures from data folder..." << std::endl;
-
-      // Abbey textures (albedo, depth, normal, no material)
-      std::cout << "Loading Abbey textures..." << std::endl;
-      renderSystem->loadTexture("abbey_albedo", "data/abbey_albedo.png",
-                                "data/abbey_height.png", "data/abbey_normal.png", "");
+  // Queues the materials of data/ the game and bench scenes use; they decode
+  // in the background and entities render with the default texture until
+  // their maps are resident
+  void loadSceneTextures() {
+    std::cout << "Loading textures from data folder..." << std::endl;
+
+    // Abbey textures (albedo, depth, normal, no material)
+    std::cout << "Loading Abbey textures..." << std::endl;
+    renderSystem->loadTexture("abbey_albedo", "data/abbey_albedo.png",
+                              "data/abbey_height.png", "data/abbey_normal.png", "");
+
+    // Props (tree, teapot, torus) share one atlas page: one descriptor set
+    // and one draw for all of them. Uses the cooked atlas if there is one
+    // (texture_cooker --atlas data/props data/tree data/teapot data/torus)
+    if (std::filesystem::exists("data/props.atlas")) {
+      renderSystem->loadAtlas("data/props.atlas");
+    } else {
+      renderSystem->buildAtlas("props", {"data/tree", "data/teapot", "data/torus"});
+    }
 
-      // Tree textures (albedo, depth, normal, material)
-      renderSystem->loadTexture("tree_albedo", "data/tree_albedo.png",
-                                "data/tree_height.png", "data/tree_normal.png", "data/tree_material.png");
+    // Ground (wetsand) textures (albedo, depth, normal, material)
+    renderSystem->loadTexture("wetsand_albedo", "data/wetsand_albedo.png",
+                              "data/wetsand_height.png", "data/wetsand_normal.png", "data/wetsand_material.png");
 
-      // Teapot textures (albedo, depth, normal, no material)
-      renderSystem->loadTexture("teapot_albedo", "data/teapot_albedo.png",
-                                "data/teapot_height.png", "data/teapot_normal.png", "");
+    std::cout << "Texture loads queued!" << std::endl;
+  }
 
-      // Torus textures (albedo, depth, normal, material)
-      renderSystem->loadTexture("torus_albedo", "data/torus_albedo.png",
-                                "data/torus_height.png", "data/torus_normal.png", "data/torus_material.png");
+  void loadGameEntities() {
+    PROFILE_SCOPE("loadGameEntities");
 
-      // Ground (wetsand) textures (albedo, depth, normal, material)
-      renderSystem->loadTexture("wetsand_albedo", "data/wetsand_albedo.png",
-                                "data/wetsand_height.png", "data/wetsand_normal.png", "data/wetsand_material.png");
+    // Mark cache for rebuild after loading entities
+    std::cout << "Loading game entities..." << std::endl;
 
-      std::cout << "Textures loaded successfully!" << std::endl;
+    try {
+      loadSceneTextures();
+
+      if (runOptions.bench) {
+        dunkan::generateBenchScene(runOptions.benchScene, getViewSize(),
+                                   entity_manager, lightingManager);
+        std::cout << "Bench scene created: "
+                  << entity_manager.get_entities_count() << " sprites, "
+                  << lightingManager.getLightCount() << " lights"
+                  << std::endl;
+        return;
+      }
 
       // Create Abbey entity
       Entity &abbey = entity_manager.create_entity();
@@ -449,6 +1001,8 @@ private:
   }
 
   void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+    PROFILE_SCOPE("recordCommandBuffer");
+
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -456,49 +1010,98 @@ private:
       throw std::runtime_error("failed to begin recording command buffer!");
     }
 
-    // 1. G-Buffer Pass (Off-screen)
-    renderSystem->prepareFrame(commandBuffer, currentFrame);
-    renderSystem->renderEntities(commandBuffer, currentFrame);
+    gpuProfiler->setStatisticsEnabled(config.gpuPipelineStatistics);
+    gpuProfiler->beginFrame(commandBuffer, currentFrame);
+
+    // Take ownership of anything the transfer queue finished uploading
+    vulkanContext->getUploadManager().recordAcquireBarriers(commandBuffer);
+
+    renderSystem->prepareFrame(commandBuffer, currentFrame, getViewSize());
+
+    // Debug view and SSAO select a composition permutation, compiled the
+    // first time it is used
+    compositePermutation = {static_cast<uint32_t>(config.currentDebugView),
+                            config.enableSSAO ? 1u : 0u};
+
+    // Nothing outside the frame's passes reads the G-buffer without SSAO, so
+    // it can stay inside one render pass; its input attachments are read at
+    // the same pixel, so only at full resolution
+    VkExtent2D extent = getOutputExtent();
+    bool fullResolution = renderExtent.width == extent.width &&
+                          renderExtent.height == extent.height;
+    FrameGraphConfig graphConfig;
+    graphConfig.merged =
+        mergedPass != nullptr && !config.enableSSAO && fullResolution;
+    graphConfig.ssao = config.enableSSAO;
+    graphConfig.reducedSSAO = ssao->getDownscale() > 1;
+    graphConfig.upscale = config.upscaling && !fullResolution;
+    if (!(graphConfig == frameGraphConfig)) {
+      PROFILE_SCOPE("buildFrameGraph");
+      // The SSAO history stopped updating when its pass was culled
+      if (graphConfig.ssao && !frameGraphConfig.ssao) {
+        ssao->invalidateHistory();
+      }
+      buildFrameGraph(graphConfig);
+    }
 
-    // 2. SSAO Pass (Off-screen) - Only if enabled
-    if (config.enableSSAO) {
-      VkRenderPassBeginInfo ssaoPassInfo{};
-      ssaoPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-      ssaoPassInfo.renderPass = renderPass->getSSAORenderPass();
-      ssaoPassInfo.framebuffer = ssao->framebuffer;
-      ssaoPassInfo.renderArea.offset = {0, 0};
-      ssaoPassInfo.renderArea.extent = swapchain->getExtent();
+    currentImageIndex = imageIndex;
+    renderGraph->setImage(swapchainImage, getOutputImages()[imageIndex]);
+    {
+      PROFILE_SCOPE("renderGraph.execute");
+      renderGraph->execute(commandBuffer);
+    }
 
-      VkClearValue clearValue = {{0.0f, 0.0f, 0.0f, 1.0f}};
-      ssaoPassInfo.clearValueCount = 1;
-      ssaoPassInfo.pClearValues = &clearValue;
+    // Read back after the fence, the next time this frame slot comes round
+    if (headless && !runOptions.outputDir.empty()) {
+      offscreen->recordReadback(commandBuffer, imageIndex);
+      pendingReadbacks[currentFrame] = frameNumber;
+    }
 
-      vkCmdBeginRenderPass(commandBuffer, &ssaoPassInfo,
-                           VK_SUBPASS_CONTENTS_INLINE);
+    gpuProfiler->endFrame(commandBuffer);
 
-      vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                        ssao->pipeline);
-      vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                              ssao->pipelineLayout, 0, 1, &ssao->descriptorSet,
-                              0, nullptr);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to record command buffer!");
+    }
+  }
 
-      // Update SSAO uniforms (projection matrix)
-      glm::mat4 projection =
-          glm::ortho(0.0f, 1920.0f, 1080.0f, 0.0f, -100.0f, 100.0f);
-      ssao->update(commandBuffer, projection);
+  // Inside the render pass of whichever pass writes the swapchain image last;
+  // timed on its own as well as within that pass
+  void recordImGui(VkCommandBuffer commandBuffer) {
+    if (headless) {
+      return;
+    }
+    uint32_t scope = gpuProfiler->beginScope(commandBuffer, "imgui");
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    gpuProfiler->endScope(commandBuffer, scope);
+  }
 
-      vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Full screen triangle
+  void recordOverlay(VkCommandBuffer commandBuffer) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass->getOverlayRenderPass();
+    renderPassInfo.framebuffer = getOutputFramebuffer();
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = getOutputExtent();
 
-      vkCmdEndRenderPass(commandBuffer);
-    }
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                         VK_SUBPASS_CONTENTS_INLINE);
+    recordImGui(commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
+  }
 
-    // 3. Final Composition Pass (To Swapchain)
+  // Composes into the swapchain image, or into the upscaler's scene color at
+  // the internal resolution
+  void recordComposition(VkCommandBuffer commandBuffer) {
+    bool upscale = frameGraphConfig.upscale;
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = renderPass->getFinalRenderPass();
-    renderPassInfo.framebuffer = swapchain->getFramebuffers()[imageIndex];
+    renderPassInfo.framebuffer =
+        upscale ? upscaler->getSceneFramebuffer()
+                : getOutputFramebuffer();
     renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = swapchain->getExtent();
+    renderPassInfo.renderArea.extent =
+        upscale ? renderExtent : getOutputExtent();
 
     VkClearValue clearColor = {{{0.1f, 0.1f, 0.15f, 1.0f}}};
     renderPassInfo.clearValueCount = 1;
@@ -509,59 +1112,132 @@ private:
 
     // Render full screen quad combining G-Buffer attachments
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                      compPipeline->getPipeline());
+                      compPipeline->getPipeline(compositePermutation));
+    VulkanPipeline::setViewport(commandBuffer, renderPassInfo.renderArea.extent);
 
     vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                             compPipeline->getLayout(), 0, 1, &compDescriptorSet,
-                            0, nullptr);
+                            1, &lightingUBOOffset);
+
+    // Set 1: light buffer and per-tile light lists
+    VkDescriptorSet lightSet = lightCulling->getDescriptorSet(currentFrame);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                            compPipeline->getLayout(), 1, 1, &lightSet, 0,
+                            nullptr);
 
-    // Push constants for debug view mode, SSAO enable, and gamma
+    // Push constants: gamma, and the tile grid's row length at the internal
+    // resolution
     struct {
-      int debugViewMode;
-      int enableSSAO;
       float gamma;
-    } pushConstants;
-    pushConstants.debugViewMode = static_cast<int>(config.currentDebugView);
-    pushConstants.enableSSAO = config.enableSSAO ? 1 : 0;
-    pushConstants.gamma = config.gammaCorrection;
-
+      uint32_t tilesPerRow;
+    } push = {config.gammaCorrection, lightCulling->getTileCountX()};
     vkCmdPushConstants(commandBuffer, compPipeline->getLayout(),
-                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants),
-                       &pushConstants);
+                       VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
 
     vkCmdDraw(commandBuffer, 3, 1, 0, 0); // Full screen triangle
 
-    // Render ImGui on top
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+    // Render ImGui on top, after upscaling when there is one
+    if (!upscale) {
+      recordImGui(commandBuffer);
+    }
 
     vkCmdEndRenderPass(commandBuffer);
+  }
 
-    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-      throw std::runtime_error("failed to record command buffer!");
-    }
+  void recordOutput(VkCommandBuffer commandBuffer) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass->getFinalRenderPass();
+    renderPassInfo.framebuffer = getOutputFramebuffer();
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = getOutputExtent();
+
+    VkClearValue clearColor = {{{0.1f, 0.1f, 0.15f, 1.0f}}};
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearColor;
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                         VK_SUBPASS_CONTENTS_INLINE);
+    upscaler->sharpen(commandBuffer, config.upscaleSharpness);
+    recordImGui(commandBuffer);
+    vkCmdEndRenderPass(commandBuffer);
   }
 
   void drawFrame() {
-    vkWaitForFences(vulkanContext->getDevice(), 1,
-                    &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    PROFILE_SCOPE("drawFrame");
+
+    {
+      PROFILE_SCOPE("waitForFence");
+      auto wait_start = std::chrono::high_resolution_clock::now();
+      vkWaitForFences(vulkanContext->getDevice(), 1,
+                      &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+      lastFenceWaitTime = std::chrono::duration<float, std::milli>(
+                              std::chrono::high_resolution_clock::now() -
+                              wait_start)
+                              .count();
+    }
 
     uint32_t imageIndex;
-    VkResult result = vkAcquireNextImageKHR(
-        vulkanContext->getDevice(), swapchain->getSwapchain(), UINT64_MAX,
-        imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    if (headless) {
+      // The fence also covers the copy this slot's last frame was read back
+      // with; each slot renders into its own offscreen image
+      writePendingReadback(currentFrame);
+      imageIndex = currentFrame;
+      if (sampleInputLate) {
+        sampleInput();
+      }
+    } else {
+      {
+        PROFILE_SCOPE("acquireNextImage");
+        result = vkAcquireNextImageKHR(
+            vulkanContext->getDevice(), swapchain->getSwapchain(), UINT64_MAX,
+            imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE,
+            &imageIndex);
+      }
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-      swapchain->recreate();
-      swapchain->createFramebuffers(renderPass->getFinalRenderPass());
-      return;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-      throw std::runtime_error("failed to acquire swap chain image!");
+      if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        recreateSwapchain();
+        // The window's events are still to be handled this frame
+        if (sampleInputLate) {
+          sampleInput();
+        }
+        return;
+      } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        throw std::runtime_error("failed to acquire swap chain image!");
+      }
+
+      // Nothing left to block on before recording, so the frame is built
+      // from the newest input
+      if (sampleInputLate) {
+        sampleInput();
+      }
     }
 
     vkResetFences(vulkanContext->getDevice(), 1, &inFlightFences[currentFrame]);
 
+    // The fence guarantees the GPU is done with this frame's allocator
+    // partition, so it can be recycled
+    frameAllocator->beginFrame(currentFrame);
+
+    // The fence also covers this slot's timestamps
+    updateRenderExtent();
+
+    // Swap in materials that became resident and queue freshly decoded ones,
+    // then submit queued uploads and retire finished ones (never blocks)
+    {
+      PROFILE_SCOPE("streaming");
+      renderSystem->updateStreaming();
+      vulkanContext->getUploadManager().update();
+    }
+
     // Build ImGui UI for this frame
-    renderDebugUI();
+    if (!headless) {
+      renderDebugUI();
+    }
+
+    // After the UI, so light and ambient edits reach this frame
+    updateLightingUBO();
 
     vkResetCommandBuffer(commandBuffers[currentFrame], 0);
     recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
@@ -569,22 +1245,36 @@ private:
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+    // Nothing to acquire or present headless: the fence alone orders frames
     VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
     VkPipelineStageFlags waitStages[] = {
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
     VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(vulkanContext->getGraphicsQueue(), 1, &submitInfo,
-                      inFlightFences[currentFrame]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to submit draw command buffer!");
+    {
+      PROFILE_SCOPE("queueSubmit");
+      if (vkQueueSubmit(vulkanContext->getGraphicsQueue(), 1, &submitInfo,
+                        inFlightFences[currentFrame]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit draw command buffer!");
+      }
+    }
+    inputLatency.markSubmitted();
+
+    frameAllocatorPeak =
+        std::max(frameAllocatorPeak, frameAllocator->getUsedBytes());
+    frameNumber++;
+
+    if (headless) {
+      currentFrame = (currentFrame + 1) % framesInFlight;
+      return;
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -597,16 +1287,18 @@ private:
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
 
-    result = vkQueuePresentKHR(vulkanContext->getPresentQueue(), &presentInfo);
+    {
+      PROFILE_SCOPE("queuePresent");
+      result = vkQueuePresentKHR(vulkanContext->getPresentQueue(), &presentInfo);
+    }
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-      swapchain->recreate();
-      swapchain->createFramebuffers(renderPass->getFinalRenderPass());
+      recreateSwapchain();
     } else if (result != VK_SUCCESS) {
       throw std::runtime_error("failed to present swap chain image!");
     }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
   }
 
   void mainLoop() {
@@ -616,7 +1308,20 @@ private:
     int frame_count = 0;
 
     while (!glfwWindowShouldClose(window)) {
-      glfwPollEvents();
+      // Captures start and end between frames
+      CpuProfiler::frameBoundary();
+      PROFILE_SCOPE("frame");
+
+      applyFramePacing();
+      {
+        PROFILE_SCOPE("frameLimiter");
+        frameLimiter.wait(config.frameRateLimit);
+      }
+
+      sampleInputLate = config.lateInputSampling;
+      if (!sampleInputLate) {
+        sampleInput();
+      }
       
       // Calculate delta time for animations
       auto current_time = std::chrono::high_resolution_clock::now();
@@ -626,9 +1331,6 @@ private:
       // Update animated lights (spotlights)
       lightingManager.updateAnimatedLights(deltaTime);
 
-      // Update lighting UBO each frame from ImGui state
-      updateLightingUBO();
-
       drawFrame();
 
       frame_count++;
@@ -645,13 +1347,197 @@ private:
     vkDeviceWaitIdle(vulkanContext->getDevice());
   }
 
+  // Polls window input for the frame being built; its input-to-submit
+  // latency is measured from here, also headless where there is none
+  void sampleInput() {
+    PROFILE_SCOPE("pollEvents");
+    if (!headless) {
+      glfwPollEvents();
+    }
+    inputLatency.markInputSampled();
+  }
+
+  // Applies frame pacing settings changed since the last frame
+  void applyFramePacing() {
+    config.framesInFlight =
+        std::clamp(config.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
+    if (static_cast<uint32_t>(config.framesInFlight) != framesInFlight) {
+      // Slots leaving or joining the cycle may hold a submitted frame's
+      // timestamps; read them now rather than as a later frame's
+      vkDeviceWaitIdle(vulkanContext->getDevice());
+      for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) {
+        if (gpuProfiler->readResults(slot)) {
+          gpuProfileLog.addFrame(gpuProfiler->getLastFrame());
+        }
+      }
+      framesInFlight = static_cast<uint32_t>(config.framesInFlight);
+      currentFrame = 0;
+    }
+
+    // Unsupported modes stay requested, so they aren't retried every frame
+    VkPresentModeKHR presentMode =
+        PRESENT_MODES[static_cast<int>(config.presentMode)];
+    if (presentMode != swapchain->getRequestedPresentMode()) {
+      swapchain->setPresentMode(presentMode);
+      recreateSwapchain();
+    }
+  }
+
+  dunkan::FramePacingStats getFramePacingStats() const {
+    dunkan::FramePacingStats stats;
+    for (int i = 0; i < 4; i++) {
+      stats.presentModeSupported[i] =
+          swapchain->supportsPresentMode(PRESENT_MODES[i]);
+      if (PRESENT_MODES[i] == swapchain->getPresentMode()) {
+        stats.presentMode =
+            static_cast<dunkan::ApplicationConfig::PresentMode>(i);
+      }
+    }
+    stats.inputLatency = inputLatency.getLast();
+    stats.averageInputLatency = inputLatency.getAverage();
+    stats.maxInputLatency = inputLatency.getMax();
+    stats.limiterWait = frameLimiter.getLastWait();
+    return stats;
+  }
+
+  // Renders runOptions.frames frames with a fixed timestep, so the same scene
+  // gives the same images whatever the machine (e.g. lavapipe in CI). Headless
+  // unless render_bench was asked for a window
+  void renderFixedFrames() {
+    const float FIXED_TIMESTEP = 1.0f / 60.0f;
+
+    // The render scale would otherwise follow the measured GPU time
+    config.dynamicResolution = false;
+
+    if (!runOptions.outputDir.empty()) {
+      std::filesystem::create_directories(runOptions.outputDir);
+    }
+
+    // Frames show the scene's textures, not the placeholders streamed in
+    // over the first frames
+    while (renderSystem->getPendingTextureCount() > 0) {
+      renderSystem->updateStreaming();
+      vulkanContext->getUploadManager().update();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    vulkanContext->getUploadManager().waitIdle();
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < runOptions.frames; i++) {
+      CpuProfiler::frameBoundary();
+      PROFILE_SCOPE("frame");
+
+      // Paced like the main loop, so render_bench measures the settings'
+      // latency; the limiter's wait is not part of the frame time
+      {
+        PROFILE_SCOPE("frameLimiter");
+        frameLimiter.wait(config.frameRateLimit);
+      }
+      auto frame_start = std::chrono::high_resolution_clock::now();
+      sampleInputLate = config.lateInputSampling;
+      if (!sampleInputLate) {
+        sampleInput();
+      }
+      if (!headless && glfwWindowShouldClose(window)) {
+        break;
+      }
+
+      // The bench scene's lights stay where they were generated
+      if (!runOptions.bench) {
+        lightingManager.updateAnimatedLights(FIXED_TIMESTEP);
+      }
+      drawFrame();
+
+      if (runOptions.bench && i >= runOptions.warmupFrames) {
+        float frameTime = std::chrono::duration<float, std::milli>(
+                              std::chrono::high_resolution_clock::now() -
+                              frame_start)
+                              .count();
+        benchReport.addFrame(frameTime, frameTime - lastFenceWaitTime,
+                             renderSystem->getDrawCallCount(),
+                             inputLatency.getLast(),
+                             frameLimiter.getLastWait());
+      }
+    }
+
+    vkDeviceWaitIdle(vulkanContext->getDevice());
+    uint32_t failed = 0;
+    if (headless) {
+      for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; slot++) {
+        writePendingReadback(slot);
+      }
+      failed = offscreen->waitForWrites();
+    }
+
+    float seconds = std::chrono::duration<float>(
+                        std::chrono::high_resolution_clock::now() - start_time)
+                        .count();
+    std::cout << "Rendered " << frameNumber << (headless ? " headless" : "")
+              << " frames in " << seconds << " s" << std::endl;
+    if (runOptions.bench) {
+      writeBenchReport();
+    }
+    if (failed > 0) {
+      throw std::runtime_error("failed to write " + std::to_string(failed) +
+                               " frame images to " + runOptions.outputDir);
+    }
+  }
+
+  void writeBenchReport() {
+    // The last frames' GPU results, oldest first; the device is idle
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+      uint32_t slot = (currentFrame + i) % framesInFlight;
+      if (gpuProfiler->readResults(slot) &&
+          frameNumber >= runOptions.warmupFrames + framesInFlight - i) {
+        benchReport.addGpuFrame(gpuProfiler->getLastFrame());
+      }
+    }
+
+    dunkan::BenchPacingConfig pacing;
+    pacing.framesInFlight = framesInFlight;
+    if (!headless) {
+      int presentMode = static_cast<int>(getFramePacingStats().presentMode);
+      pacing.presentMode = PRESENT_MODE_NAMES[presentMode];
+    }
+    pacing.frameRateLimit = config.frameRateLimit;
+    pacing.lateInputSampling = config.lateInputSampling;
+
+    VkExtent2D extent = getOutputExtent();
+    if (!benchReport.write(runOptions.reportPath, runOptions.benchScene,
+                           extent.width, extent.height, headless, pacing,
+                           vulkanContext->getAllocator().getStats(),
+                           frameAllocatorPeak)) {
+      throw std::runtime_error("failed to write bench report to " +
+                               runOptions.reportPath);
+    }
+    std::cout << "Bench report written: " << runOptions.reportPath << " ("
+              << benchReport.getFrameCount() << " frames measured)"
+              << std::endl;
+  }
+
+  // Queues the PNG of the frame last read back in slot; its fence must have
+  // signaled
+  void writePendingReadback(uint32_t slot) {
+    if (pendingReadbacks[slot] == UINT32_MAX) {
+      return;
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%04u.png", pendingReadbacks[slot]);
+    offscreen->writePng(
+        slot, (std::filesystem::path(runOptions.outputDir) / name).string());
+    pendingReadbacks[slot] = UINT32_MAX;
+  }
+
   void cleanup() {
     vkDeviceWaitIdle(vulkanContext->getDevice());
 
     // Cleanup ImGui
-    ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    if (!headless) {
+      ImGui_ImplVulkan_Shutdown();
+      ImGui_ImplGlfw_Shutdown();
+      ImGui::DestroyContext();
+    }
 
     if (imguiDescriptorPool != VK_NULL_HANDLE) {
       vkDestroyDescriptorPool(vulkanContext->getDevice(), imguiDescriptorPool,
@@ -666,25 +1552,178 @@ private:
       vkDestroyFence(vulkanContext->getDevice(), inFlightFences[i], nullptr);
     }
 
+    // Before the G-buffer and SSAO that use its images, and the allocator
+    delete renderGraph;
+    delete gpuProfiler;
+    delete upscaler;
+    delete mergedPass;
+    delete lightCulling;
     delete ssao;
     delete renderSystem;
+    delete frameAllocator;
     delete descriptorManager;
     delete pipeline;
     delete compPipeline;
     delete renderPass;
     delete swapchain;
+    delete offscreen;
     delete vulkanContext;
 
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    if (!headless) {
+      glfwDestroyWindow(window);
+      glfwTerminate();
+    }
   }
 };
 
-int main() {
-  VulkanApplication app;
+// Present mode by its command line name
+bool parsePresentMode(const std::string &name,
+                      dunkan::ApplicationConfig::PresentMode &mode) {
+  for (int i = 0; i < 4; i++) {
+    if (name == PRESENT_MODE_NAMES[i]) {
+      mode = static_cast<dunkan::ApplicationConfig::PresentMode>(i);
+      return true;
+    }
+  }
+  std::cerr << "Unknown present mode: " << name
+            << " (fifo, fifo-relaxed, mailbox or immediate)" << std::endl;
+  return false;
+}
+
+#ifdef DUNKAN_RENDER_BENCH
+
+// render_bench: renders the seeded stress scene for a fixed number of frames
+// (headless unless --window) and writes the measurements as JSON
+bool parseArguments(int argc, char **argv, RunOptions &options) {
+  options.bench = true;
+  options.headless = true;
+  options.frames = 300;
+  options.warmupFrames = 30;
+  options.reportPath = "render_bench.json";
+
+  dunkan::BenchSceneConfig &scene = options.benchScene;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--seed" && hasValue) {
+      scene.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--sprites" && hasValue) {
+      scene.spriteCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--point-lights" && hasValue) {
+      scene.pointLights = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--spot-lights" && hasValue) {
+      scene.spotLights = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--directional-lights" && hasValue) {
+      scene.directionalLights = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--ssao") {
+      scene.ssao = true;
+    } else if (arg == "--frames" && hasValue) {
+      options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--warmup" && hasValue) {
+      options.warmupFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else if (arg == "--report" && hasValue) {
+      options.reportPath = argv[++i];
+    } else if (arg == "--window") {
+      options.headless = false;
+    } else if (arg == "--frames-in-flight" && hasValue) {
+      options.framesInFlight = std::stoi(argv[++i]);
+    } else if (arg == "--present-mode" && hasValue) {
+      dunkan::ApplicationConfig::PresentMode mode;
+      if (!parsePresentMode(argv[++i], mode)) {
+        return false;
+      }
+      options.presentMode = mode;
+    } else if (arg == "--fps-limit" && hasValue) {
+      options.frameRateLimit = std::stof(argv[++i]);
+    } else if (arg == "--no-late-input") {
+      options.lateInputSampling = false;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      std::cerr << "Usage: " << argv[0]
+                << " [--seed N] [--sprites N] [--point-lights N]"
+                   " [--spot-lights N] [--directional-lights N] [--ssao]"
+                   " [--frames N] [--warmup N] [--report file] [--window]"
+                   " [--frames-in-flight N] [--present-mode mode]"
+                   " [--fps-limit N] [--no-late-input]"
+                << std::endl;
+      return false;
+    }
+  }
+
+  if (scene.spriteCount > DUNKAN_MAX_ENTITIES) {
+    std::cerr << "At most " << DUNKAN_MAX_ENTITIES << " sprites" << std::endl;
+    return false;
+  }
+  if (options.frames <= options.warmupFrames) {
+    std::cerr << "--frames must be greater than --warmup" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+#else
+
+bool parseArguments(int argc, char **argv, RunOptions &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+      options.headless = true;
+    } else if (arg == "--out" && i + 1 < argc) {
+      // Only offscreen frames are read back
+      options.outputDir = argv[++i];
+      options.headless = true;
+    } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+      options.framesInFlight = std::stoi(argv[++i]);
+    } else if (arg == "--present-mode" && i + 1 < argc) {
+      dunkan::ApplicationConfig::PresentMode mode;
+      if (!parsePresentMode(argv[++i], mode)) {
+        return false;
+      }
+      options.presentMode = mode;
+    } else if (arg == "--fps-limit" && i + 1 < argc) {
+      options.frameRateLimit = std::stof(argv[++i]);
+    } else if (arg == "--no-late-input") {
+      options.lateInputSampling = false;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      std::cerr << "Usage: " << argv[0]
+                << " [--headless] [--frames N] [--out dir]"
+                   " [--frames-in-flight N] [--present-mode mode]"
+                   " [--fps-limit N] [--no-late-input]"
+                << std::endl;
+      return false;
+    }
+  }
+  if (options.headless && options.frames == 0) {
+    options.frames = 1;
+  }
+  return true;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+  PROFILE_THREAD("main");
+
+  RunOptions options;
+  try {
+    if (!parseArguments(argc, argv, options)) {
+      return EXIT_FAILURE;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Invalid number: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // On the heap: the entity manager's component arrays are large, and huge
+  // in render_bench
+  auto app = std::make_unique<VulkanApplication>();
 
   try {
-    app.run();
+    app->run(options);
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     return EXIT_FAILURE;
@@ -0,0 +1,319 @@
+#include "BlockCompression.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BC_USE_SSE2 1
+#endif
+
+namespace BlockCompression {
+
+namespace {
+
+constexpr int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+constexpr int REFINE_ITERATIONS = 3;
+
+// Mode 6 endpoints: 7 bits per channel plus one shared p-bit per endpoint
+struct Endpoints {
+    int q[2][4] = {};
+    int p[2] = {};
+};
+
+class BitWriter {
+public:
+    explicit BitWriter(uint8_t* out, size_t bytes) : m_out(out) { memset(out, 0, bytes); }
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t i = 0; i < bits; i++, m_position++) {
+            if ((value >> i) & 1) {
+                m_out[m_position >> 3] |= static_cast<uint8_t>(1 << (m_position & 7));
+            }
+        }
+    }
+
+private:
+    uint8_t* m_out;
+    uint32_t m_position = 0;
+};
+
+void quantizeEndpoint(const float color[4], int q[4], int& p) {
+    float bestError = INFINITY;
+    for (int pbit = 0; pbit < 2; pbit++) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            candidate[c] = std::clamp(static_cast<int>(std::lround((color[c] - pbit) * 0.5f)), 0, 127);
+            float delta = static_cast<float>((candidate[c] << 1) | pbit) - color[c];
+            error += delta * delta;
+        }
+        if (error < bestError) {
+            bestError = error;
+            std::copy(candidate, candidate + 4, q);
+            p = pbit;
+        }
+    }
+}
+
+Endpoints quantize(const float e0[4], const float e1[4]) {
+    Endpoints endpoints;
+    quantizeEndpoint(e0, endpoints.q[0], endpoints.p[0]);
+    quantizeEndpoint(e1, endpoints.q[1], endpoints.p[1]);
+    return endpoints;
+}
+
+void buildPalette(const Endpoints& endpoints, int16_t palette[16][4]) {
+    for (int c = 0; c < 4; c++) {
+        int e0 = (endpoints.q[0][c] << 1) | endpoints.p[0];
+        int e1 = (endpoints.q[1][c] << 1) | endpoints.p[1];
+        for (int i = 0; i < 16; i++) {
+            int w = BC7_WEIGHTS[i];
+            palette[i][c] = static_cast<int16_t>(((64 - w) * e0 + w * e1 + 32) >> 6);
+        }
+    }
+}
+
+// Squared RGBA distance from one texel to each of the 16 palette entries.
+// Integer math, so the SSE2 and scalar paths agree bit for bit
+void paletteErrors(const uint8_t* texel, const int16_t palette[16][4], int32_t errors[16]) {
+#ifdef BC_USE_SSE2
+    __m128i texelRG = _mm_set1_epi32(texel[0] | (texel[1] << 16));
+    __m128i texelBA = _mm_set1_epi32(texel[2] | (texel[3] << 16));
+
+    for (int k = 0; k < 4; k++) {
+        const int16_t* e = palette[k * 4];
+        // (r,g) and (b,a) pairs of four palette entries; madd squares and sums each pair
+        __m128i rg = _mm_setr_epi16(e[0], e[1], e[4], e[5], e[8], e[9], e[12], e[13]);
+        __m128i ba = _mm_setr_epi16(e[2], e[3], e[6], e[7], e[10], e[11], e[14], e[15]);
+        __m128i dRG = _mm_sub_epi16(rg, texelRG);
+        __m128i dBA = _mm_sub_epi16(ba, texelBA);
+        __m128i error = _mm_add_epi32(_mm_madd_epi16(dRG, dRG), _mm_madd_epi16(dBA, dBA));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(errors + k * 4), error);
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        int32_t error = 0;
+        for (int c = 0; c < 4; c++) {
+            int32_t delta = palette[i][c] - texel[c];
+            error += delta * delta;
+        }
+        errors[i] = error;
+    }
+#endif
+}
+
+// Nearest palette entry per texel (lowest index wins ties); returns the block's total error
+uint32_t selectIndices(const uint8_t* texels, const Endpoints& endpoints, uint8_t indices[16]) {
+    int16_t palette[16][4];
+    buildPalette(endpoints, palette);
+
+    uint32_t total = 0;
+    for (int t = 0; t < 16; t++) {
+        int32_t errors[16];
+        paletteErrors(texels + t * 4, palette, errors);
+
+        int best = 0;
+        for (int i = 1; i < 16; i++) {
+            if (errors[i] < errors[best]) {
+                best = i;
+            }
+        }
+        indices[t] = static_cast<uint8_t>(best);
+        total += static_cast<uint32_t>(errors[best]);
+    }
+    return total;
+}
+
+// Initial endpoints: extent of the texels along their principal axis
+void principalAxisEndpoints(const uint8_t* texels, float e0[4], float e1[4]) {
+    float mean[4] = {};
+    for (int t = 0; t < 16; t++) {
+        for (int c = 0; c < 4; c++) {
+            mean[c] += texels[t * 4 + c];
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int t = 0; t < 16; t++) {
+        float d[4];
+        for (int c = 0; c < 4; c++) {
+            d[c] = texels[t * 4 + c] - mean[c];
+        }
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                covariance[i][j] += d[i] * d[j];
+            }
+        }
+    }
+
+    // Power iteration
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        float largest = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+            largest = std::max(largest, std::fabs(next[i]));
+        }
+        if (largest < 1e-6f) {
+            // Solid block (or close enough)
+            std::copy(mean, mean + 4, e0);
+            std::copy(mean, mean + 4, e1);
+            return;
+        }
+        for (int i = 0; i < 4; i++) {
+            axis[i] = next[i] / largest;
+        }
+    }
+
+    float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+    for (int c = 0; c < 4; c++) {
+        axis[c] /= length;
+    }
+
+    float minProjection = INFINITY;
+    float maxProjection = -INFINITY;
+    for (int t = 0; t < 16; t++) {
+        float projection = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            projection += (texels[t * 4 + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    for (int c = 0; c < 4; c++) {
+        e0[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+        e1[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+    }
+}
+
+// Least-squares endpoints for a fixed set of indices; false if the system is degenerate
+bool fitEndpoints(const uint8_t* texels, const uint8_t indices[16], float e0[4], float e1[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ap[4] = {}, bp[4] = {};
+    for (int t = 0; t < 16; t++) {
+        float a = BC7_WEIGHTS[indices[t]] / 64.0f;
+        float b = 1.0f - a;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < 4; c++) {
+            ap[c] += a * texels[t * 4 + c];
+            bp[c] += b * texels[t * 4 + c];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+        return false;
+    }
+
+    for (int c = 0; c < 4; c++) {
+        e0[c] = std::clamp((aa * bp[c] - ab * ap[c]) / determinant, 0.0f, 255.0f);
+        e1[c] = std::clamp((bb * ap[c] - ab * bp[c]) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+void encodeBC4Channel(const uint8_t* values, uint8_t* out) {
+    int low = 255;
+    int high = 0;
+    for (int t = 0; t < 16; t++) {
+        low = std::min<int>(low, values[t]);
+        high = std::max<int>(high, values[t]);
+    }
+
+    // high > low selects the 8-value mode: endpoints followed by 6 interpolated steps
+    int palette[8] = {high, low};
+    for (int i = 1; i < 7; i++) {
+        palette[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+    }
+
+    uint64_t bits = 0;
+    for (int t = 0; t < 16; t++) {
+        int best = 0;
+        int bestError = std::abs(values[t] - palette[0]);
+        for (int i = 1; i < 8; i++) {
+            int error = std::abs(values[t] - palette[i]);
+            if (error < bestError) {
+                bestError = error;
+                best = i;
+            }
+        }
+        bits |= static_cast<uint64_t>(best) << (t * 3);
+    }
+
+    out[0] = static_cast<uint8_t>(high);
+    out[1] = static_cast<uint8_t>(low);
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+}
+
+} // namespace
+
+void encodeBC7(const uint8_t* texels, uint8_t* out) {
+    float e0[4], e1[4];
+    principalAxisEndpoints(texels, e0, e1);
+
+    Endpoints best = quantize(e0, e1);
+    uint8_t bestIndices[16];
+    uint32_t bestError = selectIndices(texels, best, bestIndices);
+
+    for (int iteration = 0; iteration < REFINE_ITERATIONS && bestError > 0; iteration++) {
+        if (!fitEndpoints(texels, bestIndices, e0, e1)) {
+            break;
+        }
+
+        Endpoints candidate = quantize(e0, e1);
+        uint8_t indices[16];
+        uint32_t error = selectIndices(texels, candidate, indices);
+        if (error >= bestError) {
+            break;
+        }
+
+        best = candidate;
+        bestError = error;
+        std::copy(indices, indices + 16, bestIndices);
+    }
+
+    // The first index is stored with its top bit implied zero; swap endpoints if it's set
+    if (bestIndices[0] & 8) {
+        std::swap(best.q[0], best.q[1]);
+        std::swap(best.p[0], best.p[1]);
+        for (uint8_t& index : bestIndices) {
+            index = static_cast<uint8_t>(15 - index);
+        }
+    }
+
+    BitWriter writer(out, 16);
+    writer.write(1 << 6, 7);                    // Mode 6
+    for (int c = 0; c < 4; c++) {
+        writer.write(best.q[0][c], 7);
+        writer.write(best.q[1][c], 7);
+    }
+    writer.write(best.p[0], 1);
+    writer.write(best.p[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (int t = 1; t < 16; t++) {
+        writer.write(bestIndices[t], 4);
+    }
+}
+
+void encodeBC4(const uint8_t* values, uint8_t* out) {
+    encodeBC4Channel(values, out);
+}
+
+void encodeBC5(const uint8_t* red, const uint8_t* green, uint8_t* out) {
+    encodeBC4Channel(red, out);
+    encodeBC4Channel(green, out + 8);
+}
+
+} // namespace BlockCompression
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// Block encoders used by the texture cooker. Every function takes one 4x4 block in
+// row-major order and is deterministic: the same input always produces the same bits,
+// regardless of thread count or whether the SSE2 path is compiled in.
+namespace BlockCompression {
+
+// BC7 using mode 6 only (single subset, 7.7.7.7 endpoints + p-bit, 4-bit indices).
+// texels: 16 RGBA8 texels, out: 16 bytes
+void encodeBC7(const uint8_t* texels, uint8_t* out);
+
+// BC4 with the 8-value interpolation mode. values: 16 bytes, out: 8 bytes
+void encodeBC4(const uint8_t* values, uint8_t* out);
+
+// BC5 = one BC4 block for red followed by one for green. out: 16 bytes
+void encodeBC5(const uint8_t* red, const uint8_t* green, uint8_t* out);
+
+} // namespace BlockCompression
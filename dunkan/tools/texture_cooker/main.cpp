@@ -0,0 +1,397 @@
+// texture_cooker: converts the engine's PNG material maps into block-compressed KTX2
+// files with full mip chains, written next to the source (data/foo_albedo.png ->
+// data/foo_albedo.ktx2). The engine picks the .ktx2 up when the GPU supports BC formats.
+//
+//   texture_cooker [-j threads] [-f] <file.png | directory>...
+//   texture_cooker [-j threads] [-f] --atlas <out prefix> <material base>...
+//
+// Map roles come from the file name suffix:
+//   _albedo   -> BC7 sRGB
+//   _normal   -> BC5 (X/Y only, Z is reconstructed in color.frag), renormalized per mip
+//   _height   -> BC4 (red channel)
+//   _material -> BC7 linear (roughness/metalness/AO need all three channels)
+//
+// --atlas packs every map of the given materials (data/tree -> data/tree_albedo.png, ...)
+// into shared pages: <prefix>_<page>_<role>.ktx2 plus a <prefix>.atlas manifest that
+// VulkanRenderSystem::loadAtlas reads. Sprite cells sit on 8-texel boundaries, so BC blocks
+// never straddle two sprites, and mips stop before neighbouring sprites would bleed.
+
+#include "BlockCompression.hpp"
+#include "utils/Atlas.hpp"
+#include "utils/Ktx2.hpp"
+#include "utils/MipChain.hpp"
+#include "utils/ThreadPool.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+enum class MapRole {
+    Albedo,
+    Normal,
+    Height,
+    Material,
+    Unknown
+};
+
+static const char* const ROLE_SUFFIXES[] = {"_albedo", "_normal", "_height", "_material"};
+
+// Page fill where a sprite lacks a map; matches the runtime atlas builder
+static const uint8_t ROLE_NEUTRAL[][4] = {
+    {0, 0, 0, 0},           // Transparent, discarded
+    {128, 128, 255, 255},   // Flat normal
+    {0, 0, 0, 0},           // No height
+    {128, 0, 255, 255}      // Default roughness/metalness/AO
+};
+
+constexpr uint32_t ATLAS_PAGE_SIZE = 2048;
+constexpr uint32_t ATLAS_PADDING = 8;
+
+static MapRole roleFromPath(const fs::path& path) {
+    std::string stem = path.stem().string();
+    auto endsWith = [&stem](const std::string& suffix) {
+        return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+
+    if (endsWith("_albedo")) return MapRole::Albedo;
+    if (endsWith("_normal")) return MapRole::Normal;
+    if (endsWith("_height")) return MapRole::Height;
+    if (endsWith("_material")) return MapRole::Material;
+    return MapRole::Unknown;
+}
+
+static uint32_t formatForRole(MapRole role) {
+    switch (role) {
+        case MapRole::Albedo: return Ktx2::FORMAT_BC7_SRGB;
+        case MapRole::Normal: return Ktx2::FORMAT_BC5_UNORM;
+        case MapRole::Height: return Ktx2::FORMAT_BC4_UNORM;
+        default: return Ktx2::FORMAT_BC7_UNORM;
+    }
+}
+
+static const char* formatName(uint32_t format) {
+    switch (format) {
+        case Ktx2::FORMAT_BC4_UNORM: return "BC4";
+        case Ktx2::FORMAT_BC5_UNORM: return "BC5";
+        case Ktx2::FORMAT_BC7_SRGB: return "BC7 sRGB";
+        default: return "BC7";
+    }
+}
+
+// Box filtering shortens normals; put them back on the unit sphere
+static void renormalize(std::vector<uint8_t>& rgba) {
+    for (size_t i = 0; i + 3 < rgba.size(); i += 4) {
+        float n[3];
+        for (int c = 0; c < 3; c++) {
+            n[c] = rgba[i + c] / 255.0f * 2.0f - 1.0f;
+        }
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length < 1e-4f) {
+            continue;
+        }
+        for (int c = 0; c < 3; c++) {
+            rgba[i + c] = static_cast<uint8_t>(std::clamp((n[c] / length * 0.5f + 0.5f) * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+    }
+}
+
+// Compresses one mip level; block rows are split across the pool. Each job writes a
+// disjoint range of the output, so the result does not depend on scheduling
+static std::vector<uint8_t> compressLevel(ThreadPool& pool, const std::vector<uint8_t>& rgba,
+                                          uint32_t width, uint32_t height, uint32_t format) {
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint32_t blockSize = Ktx2::blockBytes(format);
+    std::vector<uint8_t> out(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+    auto encodeRows = [&](uint32_t firstRow, uint32_t lastRow) {
+        uint8_t texels[64];
+        uint8_t red[16];
+        uint8_t green[16];
+
+        for (uint32_t by = firstRow; by < lastRow; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                // Partial blocks at the right/bottom edge replicate the last texel
+                for (uint32_t y = 0; y < 4; y++) {
+                    uint32_t sy = std::min(by * 4 + y, height - 1);
+                    for (uint32_t x = 0; x < 4; x++) {
+                        uint32_t sx = std::min(bx * 4 + x, width - 1);
+                        const uint8_t* src = rgba.data() + (static_cast<size_t>(sy) * width + sx) * 4;
+                        std::copy(src, src + 4, texels + (y * 4 + x) * 4);
+                        red[y * 4 + x] = src[0];
+                        green[y * 4 + x] = src[1];
+                    }
+                }
+
+                uint8_t* dst = out.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+                switch (format) {
+                    case Ktx2::FORMAT_BC4_UNORM: BlockCompression::encodeBC4(red, dst); break;
+                    case Ktx2::FORMAT_BC5_UNORM: BlockCompression::encodeBC5(red, green, dst); break;
+                    default: BlockCompression::encodeBC7(texels, dst); break;
+                }
+            }
+        }
+    };
+
+    uint32_t rowsPerJob = std::max(1u, blocksY / (pool.getThreadCount() * 4));
+    std::vector<std::future<void>> jobs;
+    for (uint32_t row = 0; row < blocksY; row += rowsPerJob) {
+        uint32_t last = std::min(blocksY, row + rowsPerJob);
+        jobs.push_back(pool.submit([&encodeRows, row, last] { encodeRows(row, last); }));
+    }
+    for (auto& job : jobs) {
+        job.get();
+    }
+
+    return out;
+}
+
+static bool loadRGBA(const fs::path& source, Atlas::Image& image) {
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(source.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cerr << "failed to load " << source.string() << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    image.width = static_cast<uint32_t>(width);
+    image.height = static_cast<uint32_t>(height);
+    image.channels = 4;
+    image.pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+// Builds the mip chain (at most maxLevels) of an RGBA image and compresses every level
+static Ktx2::Image encode(ThreadPool& pool, std::vector<uint8_t> level, uint32_t width, uint32_t height,
+                          MapRole role, uint32_t maxLevels = UINT32_MAX) {
+    Ktx2::Image image;
+    image.vkFormat = formatForRole(role);
+    image.width = width;
+    image.height = height;
+
+    uint32_t levelCount = std::min(MipChain::levelCount(width, height), maxLevels);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        uint32_t levelWidth = MipChain::levelSize(image.width, i);
+        uint32_t levelHeight = MipChain::levelSize(image.height, i);
+        image.levels.push_back(compressLevel(pool, level, levelWidth, levelHeight, image.vkFormat));
+
+        if (i + 1 < levelCount) {
+            std::vector<uint8_t> next(static_cast<size_t>(MipChain::levelSize(image.width, i + 1)) *
+                                      MipChain::levelSize(image.height, i + 1) * 4);
+            MipChain::downsample(level.data(), levelWidth, levelHeight, 4, role == MapRole::Albedo, next.data());
+            if (role == MapRole::Normal) {
+                renormalize(next);
+            }
+            level = std::move(next);
+        }
+    }
+    return image;
+}
+
+static size_t compressedSize(const Ktx2::Image& image) {
+    size_t bytes = 0;
+    for (const auto& data : image.levels) {
+        bytes += data.size();
+    }
+    return bytes;
+}
+
+static bool cook(ThreadPool& pool, const fs::path& source, bool force) {
+    MapRole role = roleFromPath(source);
+    if (role == MapRole::Unknown) {
+        return true;
+    }
+
+    fs::path target = source;
+    target.replace_extension(".ktx2");
+    if (!force && fs::exists(target) && fs::last_write_time(target) >= fs::last_write_time(source)) {
+        std::cout << "up to date: " << target.string() << std::endl;
+        return true;
+    }
+
+    Atlas::Image pixels;
+    if (!loadRGBA(source, pixels)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t width = pixels.width;
+    uint32_t height = pixels.height;
+    Ktx2::Image image = encode(pool, std::move(pixels.pixels), width, height, role);
+
+    if (!Ktx2::write(target.string(), image)) {
+        std::cerr << "failed to write " << target.string() << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << source.string() << " -> " << target.string() << " (" << formatName(image.vkFormat) << ", "
+              << width << "x" << height << ", " << image.levels.size() << " mips, "
+              << static_cast<size_t>(width) * height * 4 / 1024 << " KB -> " << compressedSize(image) / 1024 << " KB, "
+              << seconds << " s)" << std::endl;
+    return true;
+}
+
+static bool cookAtlas(ThreadPool& pool, const std::string& prefix, const std::vector<std::string>& materials, bool force) {
+    std::string manifestPath = prefix + ".atlas";
+
+    if (!force && fs::exists(manifestPath)) {
+        bool upToDate = true;
+        for (const std::string& material : materials) {
+            for (const char* suffix : ROLE_SUFFIXES) {
+                fs::path source = material + suffix + ".png";
+                if (fs::exists(source) && fs::last_write_time(source) > fs::last_write_time(manifestPath)) {
+                    upToDate = false;
+                }
+            }
+        }
+        if (upToDate) {
+            std::cout << "up to date: " << manifestPath << std::endl;
+            return true;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // sources[sprite][role]; the albedo map sets the sprite size, the others are resampled to it
+    Atlas::Layout layout;
+    layout.pageSize = ATLAS_PAGE_SIZE;
+    layout.padding = ATLAS_PADDING;
+    std::vector<std::array<Atlas::Image, 4>> sources;
+    for (const std::string& material : materials) {
+        std::array<Atlas::Image, 4> maps;
+        for (int role = 0; role < 4; role++) {
+            fs::path source = material + ROLE_SUFFIXES[role] + ".png";
+            if (fs::exists(source) && !loadRGBA(source, maps[role])) {
+                return false;
+            }
+        }
+        if (!maps[0].isValid()) {
+            std::cerr << "missing " << material << ROLE_SUFFIXES[0] << ".png" << std::endl;
+            return false;
+        }
+
+        Atlas::Sprite sprite;
+        sprite.name = fs::path(material).filename().string() + ROLE_SUFFIXES[0];
+        sprite.source = material;
+        sprite.width = maps[0].width;
+        sprite.height = maps[0].height;
+        layout.sprites.push_back(sprite);
+        sources.push_back(std::move(maps));
+    }
+
+    std::string error;
+    if (!Atlas::pack(layout, error)) {
+        std::cerr << error << std::endl;
+        return false;
+    }
+
+    uint32_t mipLevels = Atlas::mipLevels(layout.padding);
+    for (uint32_t page = 0; page < layout.pageCount; page++) {
+        for (int role = 0; role < 4; role++) {
+            std::vector<const Atlas::Image*> images(layout.sprites.size(), nullptr);
+            bool used = false;
+            for (size_t i = 0; i < layout.sprites.size(); i++) {
+                if (layout.sprites[i].page == page && sources[i][role].isValid()) {
+                    images[i] = &sources[i][role];
+                    used = true;
+                }
+            }
+            // No file: the engine binds its default texture for maps no sprite on the page has
+            std::string target = Atlas::pagePath(manifestPath, page, ROLE_SUFFIXES[role]);
+            if (!used) {
+                fs::remove(target);
+                continue;
+            }
+
+            Atlas::Image composed = Atlas::composePage(layout, page, images, 4, ROLE_NEUTRAL[role]);
+            Ktx2::Image image = encode(pool, std::move(composed.pixels), layout.pageSize, layout.pageSize,
+                                       static_cast<MapRole>(role), mipLevels);
+            if (!Ktx2::write(target, image)) {
+                std::cerr << "failed to write " << target << std::endl;
+                return false;
+            }
+            std::cout << "  " << target << " (" << formatName(image.vkFormat) << ", "
+                      << image.levels.size() << " mips, " << compressedSize(image) / 1024 << " KB)" << std::endl;
+        }
+    }
+
+    // Written last: its timestamp marks the pages as up to date
+    if (!Atlas::writeManifest(manifestPath, layout)) {
+        std::cerr << "failed to write " << manifestPath << std::endl;
+        return false;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << manifestPath << ": " << layout.sprites.size() << " sprites on " << layout.pageCount
+              << " page(s) of " << layout.pageSize << "x" << layout.pageSize << " (" << seconds << " s)" << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    uint32_t threadCount = ThreadPool::defaultThreadCount();
+    bool force = false;
+    std::string atlasPrefix;
+    std::vector<fs::path> sources;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threadCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "-f") {
+            force = true;
+        } else if (arg == "--atlas" && i + 1 < argc) {
+            atlasPrefix = argv[++i];
+        } else if (!atlasPrefix.empty()) {
+            sources.push_back(arg);
+        } else if (fs::is_directory(arg)) {
+            for (const auto& entry : fs::directory_iterator(arg)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".png") {
+                    sources.push_back(entry.path());
+                }
+            }
+        } else {
+            sources.push_back(arg);
+        }
+    }
+
+    if (sources.empty()) {
+        std::cerr << "usage: texture_cooker [-j threads] [-f] <file.png | directory>...\n"
+                  << "       texture_cooker [-j threads] [-f] --atlas <out prefix> <material base>..." << std::endl;
+        return 1;
+    }
+
+    if (!atlasPrefix.empty()) {
+        // Sprite order is kept as given: it decides the packing tiebreaks
+        ThreadPool pool(threadCount);
+        std::vector<std::string> materials;
+        for (const auto& source : sources) {
+            materials.push_back(source.string());
+        }
+        return cookAtlas(pool, atlasPrefix, materials, force) ? 0 : 1;
+    }
+
+    // Stable order so logs and timings are comparable between runs
+    std::sort(sources.begin(), sources.end());
+
+    ThreadPool pool(threadCount);
+    bool ok = true;
+    for (const auto& source : sources) {
+        ok = cook(pool, source, force) && ok;
+    }
+    return ok ? 0 : 1;
+}
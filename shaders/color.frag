@@ -4,30 +4,43 @@ layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 layout(location = 2) in vec3 vertex;
 layout(location = 3) in vec3 fragNormal;
+layout(location = 4) flat in vec4 fragParams;   // z position, height, roughness, metalness
+layout(location = 5) flat in vec4 fragFlags;    // translucency, unused
 
+// G-buffer encoding, shared by both layouts (GBufferLayout); only the target precision differs
 layout(location = 0) out vec4 outColor;      // Albedo
-layout(location = 1) out vec4 outNormal;     // Normal + Roughness
-layout(location = 2) out vec4 outDepth;      // Heightmap RGB + calculated depth
-layout(location = 3) out vec4 outMaterial;   // Material (Roughness, Metalness, AO)
+layout(location = 1) out vec4 outNormal;     // Octahedral normal in RG
+layout(location = 2) out vec4 outDepth;      // Linear depth / DEPTH_RANGE in R
+layout(location = 3) out vec4 outMaterial;   // Roughness, Metalness, AO, Translucency
 
 layout(binding = 1) uniform sampler2D color_map;
 layout(binding = 2) uniform sampler2D depth_map;
 layout(binding = 3) uniform sampler2D normal_map;
 layout(binding = 4) uniform sampler2D material_map;
 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-    float z_position;
-    float height;
-    bool useDepthMap;
-    float roughness;
-    float metalness;
-    float translucency;
-    bool useMaterialMap; // Whether to use material texture or push constant values
-} pushConstants;
+// Permutation: which maps the material has, constant_id = MaterialMap index.
+// Set when the pipeline is compiled, so unused maps cost neither a branch nor a fetch
+layout(constant_id = 1) const bool USE_HEIGHT_MAP = false;
+layout(constant_id = 2) const bool USE_NORMAL_MAP = false;
+layout(constant_id = 3) const bool USE_MATERIAL_MAP = false;
+
+const float DEPTH_RANGE = 100.0;
+
+// Octahedral encoding: projects the unit normal onto an octahedron and unfolds it into [-1, 1]^2
+vec2 octEncode(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signs;
+}
 
 void main()
 {
+    float z_position = fragParams.x;
+    float height = fragParams.y;
+    float roughness = fragParams.z;
+    float metalness = fragParams.w;
+    
     vec4 color_pixel = texture(color_map, fragTexCoord);
     
     // Discard transparent pixels
@@ -37,30 +50,24 @@ void main()
     outColor = color_pixel;
     
     // Heightmap sampling
-    vec4 heightmap_pixel = vec4(0.0);
     float height_pixel = 0.0;
-    if(pushConstants.useDepthMap){
-        heightmap_pixel = texture(depth_map, fragTexCoord);
-        height_pixel = heightmap_pixel.r * pushConstants.height;
+    if (USE_HEIGHT_MAP) {
+        height_pixel = texture(depth_map, fragTexCoord).r * height;
     }
-    float z_pixel = height_pixel + pushConstants.z_position;
+    float z_pixel = height_pixel + z_position;
     
     // Set fragment depth for proper sprite ordering
     // Higher red channel in depth map + higher z_position = closer to camera (lower depth value)
     // Depth range [0, 1] where 0 = near, 1 = far
     gl_FragDepth = 1.0 - color_pixel.a * (0.5 + z_pixel * 0.001);
     
-    // Sample normal map
-    vec3 normalMapSample = texture(normal_map, fragTexCoord).rgb;
     vec3 normal = fragNormal;
     
-    // Check if normal map has meaningful data (not default flat normal)
-    // Default/flat normal map would be (0.5, 0.5, 1.0) in [0,1] or (0, 0, 1) in [-1,1]
-    bool hasNormalMap = length(normalMapSample - vec3(0.5, 0.5, 1.0)) > 0.01;
-    
-    if (hasNormalMap) {
-        // Transform normal from [0,1] to [-1,1]
-        vec3 tangentNormal = normalize(normalMapSample * 2.0 - 1.0);
+    if (USE_NORMAL_MAP) {
+        // Only X/Y are read: cooked normal maps are two-channel (BC5),
+        // Z is reconstructed since tangent-space normals always point out of the surface
+        vec2 normalXY = texture(normal_map, fragTexCoord).rg * 2.0 - 1.0;
+        vec3 tangentNormal = normalize(vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
         
         // Build TBN matrix (approximation for 2.5D sprite rendering)
         vec3 N = normal;
@@ -75,20 +82,21 @@ void main()
         normal = normalize(TBN * tangentNormal);
     }
     
-    // Output 1: Store normal in [0,1] range
-    outNormal = vec4(normal * 0.5 + 0.5, 0.5);
+    // Output 1: Octahedral normal, two signed channels
+    outNormal = vec4(octEncode(normalize(normal)), 0.0, 0.0);
     
-    // Output 2: Store ACTUAL heightmap RGB in rgb, linear depth in alpha
-    outDepth = vec4(heightmap_pixel.rgb, z_pixel / 100.0);
+    // Output 2: Linear depth, normalised so it keeps its precision in a half float
+    outDepth = vec4(z_pixel / DEPTH_RANGE, 0.0, 0.0, 1.0);
     
-    // Output 3: Material Properties (R: Roughness, G: Metalness, B: AO)
-    if (pushConstants.useMaterialMap) {
+    // Output 3: Material Properties (R: Roughness, G: Metalness, B: AO, A: Translucency)
+    float translucency = clamp(fragFlags.x, 0.0, 1.0);
+    if (USE_MATERIAL_MAP) {
         // Use material map texture values
         vec4 materialSample = texture(material_map, fragTexCoord);
-        outMaterial = vec4(materialSample.rgb, 1.0);
+        outMaterial = vec4(materialSample.rgb, translucency);
     } else {
-        // Use PBR values from push constants (set in Entity Editor UI)
+        // Use PBR values from the instance data (set in Entity Editor UI)
         // R: Roughness, G: Metalness, B: AO (always 1.0 for now)
-        outMaterial = vec4(pushConstants.roughness, pushConstants.metalness, 1.0, 1.0);
+        outMaterial = vec4(roughness, metalness, 1.0, translucency);
     }
 }
\ No newline at end of file
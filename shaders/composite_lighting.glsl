@@ -0,0 +1,192 @@
+// Lighting shared by composite.frag and composite_subpass.frag, which only differ in how they read
+// the G-buffer. Included through GL_GOOGLE_include_directive; not a shader stage of its own
+
+// Light structure matching C++ (LightingManager packs and precomputes it)
+struct Light {
+    vec4 position;    // xyz = position, w = range (0 for directional)
+    vec4 direction;   // xyz = normalised direction towards the light, w = 1 / radius^2
+    vec4 color;       // rgb = color * intensity
+    vec4 params;      // x = cone scale, y = cone offset, z = 1 / range^2
+};
+
+// Lighting uniform buffer
+layout (binding = 5) uniform LightingUBO {
+    vec4 ambientLight;
+    vec3 viewPos;
+    vec4 viewRect;            // xy = world position of the screen's top-left corner, zw = world units it covers
+    vec4 renderArea;          // xy = rendered area / G-buffer size (UV scale), zw = rendered area in pixels
+    uvec4 lightCounts;        // x = directional, y = point, z = spot
+} lighting;
+
+// All lights (directional, then point, then spot), and the lights reaching each screen tile (VulkanLightCulling)
+layout (std430, set = 1, binding = 0) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+layout (std430, set = 1, binding = 1) readonly buffer TileLightBuffer {
+    uint tileLights[];    // Per tile: point light count, spot light count, then point and spot light indices
+};
+
+const uint TILE_SIZE = 16;
+const uint TILE_STRIDE = 256;
+
+layout(push_constant) uniform PushConstants {
+    float gamma;        // Gamma correction value
+    uint tilesPerRow;   // Light culling tiles per row, for the rendered area
+} push;
+
+const float PI = 3.14159265359;
+const float DEPTH_RANGE = 100.0;
+
+// Inverse of color.frag's octEncode
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// ACES Filmic Tone Mapping
+// Approximation by Krzysztof Narkowicz
+vec3 ACESFilmic(vec3 x) {
+    float a = 2.51f;
+    float b = 0.03f;
+    float c = 2.43f;
+    float d = 0.59f;
+    float e = 0.14f;
+    return clamp((x*(a*x+b))/(x*(c*x+d)+e), 0.0, 1.0);
+}
+
+// PBR Functions
+vec3 fresnelSchlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+    float a = roughness * roughness;
+    float a2 = a * a;
+    float NdotH = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float num = a2;
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+
+    return num / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness) {
+    float r = (roughness + 1.0);
+    float k = (r * r) / 8.0;
+
+    float num = NdotV;
+    float denom = NdotV * (1.0 - k) + k;
+
+    return num / denom;
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
+    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+
+    return ggx1 * ggx2;
+}
+
+// Smoothly reaches zero at the light's range, so tiles outside it can skip the light
+float rangeFade(float distanceSq, float invRangeSq) {
+    float x = distanceSq * invRangeSq;
+    float fade = clamp(1.0 - x * x, 0.0, 1.0);
+    return fade * fade;
+}
+
+// Cook-Torrance BRDF for one light with direction L and incoming radiance
+vec3 shadeLight(vec3 L, vec3 radiance, vec3 N, vec3 V, vec3 albedo, float roughness, float metallic, vec3 F0) {
+    vec3 H = normalize(V +  L);
+
+    float NDF = DistributionGGX(N, H, roughness);
+    float G = GeometrySmith(N, V, L, roughness);
+    vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
+
+    vec3 kS = F;
+    vec3 kD = vec3(1.0) - kS;
+    kD *= 1.0 - metallic;
+
+    vec3 numerator = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    vec3 specular = numerator / denominator;
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
+// Inverse-square style falloff 1 / (1 + d^2 / radius^2), faded out at the light's range.
+// Returns the attenuation and writes the direction towards the light to L
+float pointAttenuation(Light light, vec3 fragPos, out vec3 L) {
+    vec3 toLight = light.position.xyz - fragPos;
+    float distanceSq = dot(toLight, toLight);
+    L = toLight * inversesqrt(max(distanceSq, 1e-8));
+    return rangeFade(distanceSq, light.params.z) / (1.0 + distanceSq * light.direction.w);
+}
+
+// Lit, tone mapped and gamma corrected color of an opaque G-buffer texel.
+// screenUV: the pixel's position on the screen (0-1), tile: its light culling tile,
+// occlusion: the SSAO term (1 without)
+vec3 composeLighting(vec3 albedo, vec3 normal, vec3 material, float linearDepth, vec2 screenUV, uvec2 tile,
+                     float occlusion) {
+    float roughness = clamp(material.r, 0.04, 1.0);
+    float metallic = clamp(material.g, 0.0, 1.0);
+    float ao = material.b;
+
+    // Fragment position for isometric 2.5D - linear depth (height + z position)
+    float depth = linearDepth * DEPTH_RANGE;
+
+    // Convert screen-space UV to world-space position with view offset
+    // This ensures point lights render circularly in isometric view
+    vec3 fragPos = vec3(screenUV * lighting.viewRect.zw + lighting.viewRect.xy, depth);
+
+    // Eye high above the centre of the visible area, so specular follows the camera and window size
+    vec3 eyePos = vec3(lighting.viewRect.xy + 0.5 * lighting.viewRect.zw, 500.0);
+    vec3 V = normalize(eyePos - fragPos);
+
+    // Calculate F0 (base reflectivity)
+    vec3 F0 = vec3(0.04);
+    F0 = mix(F0, albedo, metallic);
+
+    // Lighting accumulation, only over the lights binned into this pixel's tile
+    uint tileBase = (tile.y * push.tilesPerRow + tile.x) * TILE_STRIDE;
+    uint tilePointCount = tileLights[tileBase];
+    uint tileSpotCount = tileLights[tileBase + 1];
+
+    // One loop per light type, so no light branches on its type
+    vec3 Lo = vec3(0.0);
+    for (uint i = 0; i < lighting.lightCounts.x; i++) {
+        Light light = lights[i];
+        Lo += shadeLight(light.direction.xyz, light.color.rgb, normal, V, albedo, roughness, metallic, F0);
+    }
+    for (uint i = 0; i < tilePointCount; i++) {
+        Light light = lights[tileLights[tileBase + 2 + i]];
+        vec3 L;
+        float attenuation = pointAttenuation(light, fragPos, L);
+        Lo += shadeLight(L, light.color.rgb * attenuation, normal, V, albedo, roughness, metallic, F0);
+    }
+    for (uint i = 0; i < tileSpotCount; i++) {
+        Light light = lights[tileLights[tileBase + 2 + tilePointCount + i]];
+        vec3 L;
+        float attenuation = pointAttenuation(light, fragPos, L);
+        attenuation *= clamp(dot(L, light.direction.xyz) * light.params.x + light.params.y, 0.0, 1.0);
+        Lo += shadeLight(L, light.color.rgb * attenuation, normal, V, albedo, roughness, metallic, F0);
+    }
+
+    // Ambient + SSAO (only on opaque pixels)
+    vec3 ambient = lighting.ambientLight.rgb * albedo * ao * occlusion;
+    vec3 color = ambient + Lo;
+
+    // ACES Filmic Tone Mapping - superior to Reinhard for color reproduction
+    color = ACESFilmic(color);
+
+    // Gamma correction - configurable via ImGui
+    return pow(color, vec3(1.0 / push.gamma));
+}
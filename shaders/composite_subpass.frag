@@ -0,0 +1,62 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// composite.frag as the second subpass of the merged render pass (VulkanMergedPass): the G-buffer
+// is read through input attachments, the texel under this pixel only, while it is still in tile
+// memory. Only used with SSAO off, which needs the G-buffer sampled by a separate pass.
+// The lighting itself is shared through composite_lighting.glsl
+layout (location = 0) in vec2 inUV;
+layout (location = 0) out vec4 outColor;
+
+// G-Buffer inputs, written by the previous subpass
+layout (input_attachment_index = 0, binding = 0) uniform subpassInput inputColor;     // Albedo
+layout (input_attachment_index = 1, binding = 1) uniform subpassInput inputNormal;    // Octahedral normal (RG)
+layout (input_attachment_index = 2, binding = 2) uniform subpassInput inputDepth;     // Linear depth / DEPTH_RANGE (R)
+layout (input_attachment_index = 3, binding = 3) uniform subpassInput inputMaterial;  // Material (R=roughness, G=metalness, B=AO, A=translucency)
+
+#include "composite_lighting.glsl"
+
+// Permutation, one pipeline per combination (5=ssao shows no occlusion, there is none here)
+layout(constant_id = 0) const int DEBUG_VIEW = 0;       // 0=composite, 1=albedo, 2=normals, 3=depth, 4=material, 5=ssao
+
+void main() 
+{
+    // Debug views
+    if (DEBUG_VIEW == 1) {
+        outColor = subpassLoad(inputColor);
+        return;
+    } else if (DEBUG_VIEW == 2) {
+        vec3 normal = octDecode(subpassLoad(inputNormal).rg);
+        outColor = vec4(normal * 0.5 + 0.5, 1.0);
+        return;
+    } else if (DEBUG_VIEW == 3) {
+        float depth = subpassLoad(inputDepth).r;
+        outColor = vec4(vec3(depth), 1.0);
+        return;
+    } else if (DEBUG_VIEW == 4) {
+        outColor = subpassLoad(inputMaterial);
+        return;
+    } else if (DEBUG_VIEW == 5) {
+        outColor = vec4(1.0);
+        return;
+    }
+    
+    // PBR Lighting Composition
+    vec4 albedoSample = subpassLoad(inputColor);
+    
+    // Skip lighting for fully transparent pixels
+    if (albedoSample.a < 0.01) {
+        outColor = vec4(0.0, 0.0, 0.0, 0.0);
+        return;
+    }
+    
+    vec3 normal = octDecode(subpassLoad(inputNormal).rg);
+    vec3 material = subpassLoad(inputMaterial).rgb;
+    float depth = subpassLoad(inputDepth).r;
+    
+    // Always full resolution, so tiles are binned over the output's pixels
+    uvec2 tile = uvec2(gl_FragCoord.xy) / TILE_SIZE;
+    
+    vec3 color = composeLighting(albedoSample.rgb, normal, material, depth, inUV, tile, 1.0);
+    outColor = vec4(color, albedoSample.a);
+}
@@ -5,30 +5,36 @@ layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) in vec3 inColor;
 layout(location = 3) in vec3 inNormal;
 
+// Per-instance sprite data (SpriteInstance)
+layout(location = 4) in mat4 inModel;
+layout(location = 8) in vec4 inUvRect;     // u0, v0, u1, v1
+layout(location = 9) in vec4 inParams;     // z position, height, roughness, metalness
+layout(location = 10) in vec4 inFlags;     // translucency, unused
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out vec3 vertex;
 layout(location = 3) out vec3 fragNormal;
+layout(location = 4) flat out vec4 fragParams;
+layout(location = 5) flat out vec4 fragFlags;
 
 layout(binding = 0) uniform UniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-    float z_position;
-} pushConstants;
-
 void main() {
-    vec4 worldPos = pushConstants.model * vec4(inPosition, 0.0, 1.0);
-    worldPos.y -= pushConstants.z_position;  // SUBTRACT - higher Z = lower Y = farther back  
+    vec4 worldPos = inModel * vec4(inPosition, 0.0, 1.0);
+    worldPos.y -= inParams.x;  // SUBTRACT - higher Z = lower Y = farther back  
     gl_Position = ubo.proj * ubo.view * worldPos;
     vertex = worldPos.xyz;
     fragColor = inColor;
-    fragTexCoord = inTexCoord;
+    // Quad UVs cover [0,1]; map them onto the sprite's rect in the atlas page
+    fragTexCoord = mix(inUvRect.xy, inUvRect.zw, inTexCoord);
+    fragParams = inParams;
+    fragFlags = inFlags;
     
     // Transform normal to world space (assuming uniform scaling)
-    mat3 normalMatrix = mat3(pushConstants.model);
+    mat3 normalMatrix = mat3(inModel);
     fragNormal = normalize(normalMatrix * inNormal);
 }
\ No newline at end of file
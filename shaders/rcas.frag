@@ -0,0 +1,61 @@
+#version 450
+
+// Robust contrast-adaptive sharpening (RCAS, after AMD FidelityFX Super Resolution 1) of the
+// upscaled scene, written to the swapchain image. Each pixel is sharpened with a negative lobe on
+// its four neighbours, limited so the result can't leave the neighbours' range (no clipping or
+// ringing) and reduced where the neighbourhood looks like noise
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout (binding = 2) uniform sampler2D upscaledColor;
+
+layout (push_constant) uniform PushConstants {
+    ivec2 inputSize;
+    ivec2 outputSize;
+    float sharpness;    // 0 = none, 1 = strongest
+} push;
+
+// Largest negative lobe that stays stable
+const float RCAS_LIMIT = 0.25 - 1.0 / 16.0;
+
+vec3 fetch(ivec2 pixel)
+{
+    return texelFetch(upscaledColor, clamp(pixel, ivec2(0), push.outputSize - 1), 0).rgb;
+}
+
+float luma(vec3 color)
+{
+    return color.r * 0.5 + color.g + color.b * 0.5;
+}
+
+void main()
+{
+    //   b
+    // d e f
+    //   h
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec3 b = fetch(pixel + ivec2(0, -1));
+    vec3 d = fetch(pixel + ivec2(-1, 0));
+    vec3 e = fetch(pixel);
+    vec3 f = fetch(pixel + ivec2(1, 0));
+    vec3 h = fetch(pixel + ivec2(0, 1));
+
+    // Lobe that keeps e + lobe * (b + d + f + h) within [min, max] of the ring, per channel
+    vec3 ringMin = min(min(b, d), min(f, h));
+    vec3 ringMax = max(max(b, d), max(f, h));
+    vec3 hitMin = ringMin / max(4.0 * ringMax, vec3(1e-5));
+    vec3 hitMax = (1.0 - ringMax) / min(4.0 * ringMin - 4.0, vec3(-1e-5));
+    vec3 lobeRGB = max(-hitMin, hitMax);
+    float lobe = max(-RCAS_LIMIT, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0.0)) * push.sharpness;
+
+    // Noise: the centre stands out from a flat ring
+    float bL = luma(b), dL = luma(d), eL = luma(e), fL = luma(f), hL = luma(h);
+    float noise = 0.25 * (bL + dL + fL + hL) - eL;
+    float range = max(max(max(bL, dL), max(eL, fL)), hL) - min(min(min(bL, dL), min(eL, fL)), hL);
+    noise = clamp(abs(noise) / max(range, 1e-5), 0.0, 1.0);
+    lobe *= 1.0 - 0.5 * noise;
+
+    vec3 color = (lobe * (b + d + f + h) + e) / (4.0 * lobe + 1.0);
+    outFragColor = vec4(color, 1.0);
+}
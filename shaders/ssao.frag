@@ -15,20 +15,50 @@ layout (binding = 3) uniform UBO {
     float bias;
     float power;
     float _padding;
+    vec2 uvScale;       // Rendered area / G-buffer size: the targets are only partly used below full resolution
+    vec2 renderSize;    // Rendered area in pixels
 } uboSSAOKernel;
 
-const int kernelSize = 64;
+// Sample count, one pipeline per size; the UBO holds at most 64 samples
+layout (constant_id = 0) const int kernelSize = 64;
+
+const float DEPTH_RANGE = 100.0;
+
+// Inverse of color.frag's octEncode
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// Position in the projection's space from a G-buffer UV and its linear depth: the
+// projection is orthographic, so x/y invert directly and z is the stored depth
+vec3 reconstructPosition(vec2 uv, float depth)
+{
+    mat4 P = uboSSAOKernel.projection;
+    vec2 ndc = uv * 2.0 - 1.0;
+    vec2 xy = (ndc - vec2(P[3][0], P[3][1])) / vec2(P[0][0], P[1][1]);
+    return vec3(xy, depth * DEPTH_RANGE);
+}
 
 void main() 
 {
+    // inUV spans the rendered area, the top-left uvScale of the G-buffer. Taps stay half a texel
+    // inside it, the rest of the targets holds stale pixels
+    vec2 uvScale = uboSSAOKernel.uvScale;
+    vec2 uvMax = uvScale * (1.0 - 0.5 / uboSSAOKernel.renderSize);
+    vec2 uv = min(inUV * uvScale, uvMax);
+
     // Get G-Buffer values
-    vec3 fragPos = texture(samplerPositionDepth, inUV).rgb;
-    vec3 normal = normalize(texture(samplerNormal, inUV).rgb * 2.0 - 1.0);
+    vec3 fragPos = reconstructPosition(inUV, texture(samplerPositionDepth, uv).r);
+    vec3 normal = octDecode(texture(samplerNormal, uv).rg);
 
     // Get Random Vector
-    ivec2 texDim = textureSize(samplerPositionDepth, 0); 
+    vec2 texDim = uboSSAOKernel.renderSize;
     ivec2 noiseDim = textureSize(ssaoNoise, 0);
-    const vec2 noiseScale = vec2(float(texDim.x) / float(noiseDim.x), float(texDim.y) / float(noiseDim.y));
+    const vec2 noiseScale = vec2(texDim.x / float(noiseDim.x), texDim.y / float(noiseDim.y));
     vec3 randomVec = texture(ssaoNoise, inUV * noiseScale).xyz;
 
     // Create TBN Change-of-Basis Matrix: from Tangent-Space to View-Space
@@ -50,7 +80,7 @@ void main()
         offset.xyz = offset.xyz * 0.5 + 0.5; 
         
         // get sample depth
-        float sampleDepth = texture(samplerPositionDepth, offset.xy).z; 
+        float sampleDepth = texture(samplerPositionDepth, min(offset.xy * uvScale, uvMax)).r * DEPTH_RANGE;
         
         // range check & accumulate
         float rangeCheck = smoothstep(0.0, 1.0, uboSSAOKernel.radius / abs(fragPos.z - sampleDepth));
@@ -0,0 +1,46 @@
+#version 450
+
+// Bilateral upsample of the blurred reduced-resolution SSAO into the full-resolution SSAO target:
+// the four nearest low-resolution pixels are weighted bilinearly and by how close their depth is
+// to this pixel's
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out float outFragColor;
+
+layout (binding = 0) uniform sampler2D samplerPositionDepth;
+layout (binding = 4) uniform sampler2D inputAO;     // r = occlusion, g = depth
+
+layout (push_constant) uniform PushConstants {
+    ivec2 targetSize;   // Low-resolution pixels in use
+    ivec2 direction;
+    int downscale;
+} push;
+
+const float DEPTH_EPSILON = 0.01;
+const float DEPTH_RANGE = 100.0;     // G-buffer depth scale, as in ssao.comp
+
+void main()
+{
+    // Pixel positions rather than UVs: the rendered area may only cover part of the targets
+    float depth = texelFetch(samplerPositionDepth, ivec2(gl_FragCoord.xy), 0).r * DEPTH_RANGE;
+
+    vec2 lowPos = gl_FragCoord.xy / float(push.downscale) - 0.5;
+    ivec2 base = ivec2(floor(lowPos));
+    vec2 f = fract(lowPos);
+
+    float occlusion = 0.0;
+    float weightSum = 0.0;
+    for (int y = 0; y <= 1; ++y) {
+        for (int x = 0; x <= 1; ++x) {
+            ivec2 tap = clamp(base + ivec2(x, y), ivec2(0), push.targetSize - 1);
+            vec2 value = texelFetch(inputAO, tap, 0).rg;
+            float bilinear = (x == 1 ? f.x : 1.0 - f.x) * (y == 1 ? f.y : 1.0 - f.y);
+            float weight = bilinear / (DEPTH_EPSILON + abs(value.g - depth));
+            occlusion += value.r * weight;
+            weightSum += weight;
+        }
+    }
+
+    // The bilinear weights sum to one, so at least one tap has a positive weight
+    outFragColor = occlusion / weightSum;
+}